@@ -7,6 +7,8 @@
 
 #include "CallGraph.h"
 
+#include <algorithm>
+#include <limits>
 #include <utility>
 
 #include "ConcurrentContainers.h"
@@ -382,4 +384,115 @@ CallgraphStats get_num_nodes_edges(const Graph& graph) {
   return CallgraphStats(visited_node.size(), num_edge, num_callsites);
 }
 
+SccDag::SccDag(const Graph& graph,
+               const std::vector<const DexMethod*>& methods,
+               const std::function<bool(const DexMethod*)>& is_dependency) {
+  constexpr size_t NONE = std::numeric_limits<size_t>::max();
+  size_t n = methods.size();
+  std::unordered_map<const DexMethod*, size_t> ids;
+  for (size_t i = 0; i < n; ++i) {
+    ids.emplace(methods[i], i);
+  }
+
+  std::vector<std::vector<size_t>> succs(n);
+  for (size_t i = 0; i < n; ++i) {
+    if (!graph.has_node(methods[i])) {
+      continue;
+    }
+    for (const auto& edge : graph.node(methods[i])->callees()) {
+      auto it = ids.find(edge->callee()->method());
+      if (it != ids.end() && (!is_dependency || is_dependency(it->first))) {
+        succs[i].push_back(it->second);
+      }
+    }
+    std::sort(succs[i].begin(), succs[i].end());
+    succs[i].erase(std::unique(succs[i].begin(), succs[i].end()),
+                   succs[i].end());
+  }
+
+  // Tarjan's algorithm, with an explicit stack of (node, next successor)
+  // frames, as call chains can get too deep for native recursion. It emits
+  // each component after all the components reachable from it.
+  std::vector<size_t> index(n, NONE);
+  std::vector<size_t> lowlink(n);
+  std::vector<bool> on_stack(n);
+  std::vector<size_t> stack;
+  std::vector<std::pair<size_t, size_t>> frames;
+  std::vector<size_t> scc_of(n);
+  std::vector<std::vector<size_t>> sccs;
+  size_t next_index = 0;
+  auto visit = [&](size_t v) {
+    index[v] = lowlink[v] = next_index++;
+    stack.push_back(v);
+    on_stack[v] = true;
+    frames.emplace_back(v, 0);
+  };
+  for (size_t root = 0; root < n; ++root) {
+    if (index[root] != NONE) {
+      continue;
+    }
+    visit(root);
+    while (!frames.empty()) {
+      size_t v = frames.back().first;
+      if (frames.back().second < succs[v].size()) {
+        size_t w = succs[v][frames.back().second++];
+        if (index[w] == NONE) {
+          visit(w);
+        } else if (on_stack[w]) {
+          lowlink[v] = std::min(lowlink[v], index[w]);
+        }
+        continue;
+      }
+      frames.pop_back();
+      if (!frames.empty()) {
+        size_t u = frames.back().first;
+        lowlink[u] = std::min(lowlink[u], lowlink[v]);
+      }
+      if (lowlink[v] != index[v]) {
+        continue;
+      }
+      std::vector<size_t> members;
+      size_t w;
+      do {
+        w = stack.back();
+        stack.pop_back();
+        on_stack[w] = false;
+        scc_of[w] = sccs.size();
+        members.push_back(w);
+      } while (w != v);
+      std::sort(members.begin(), members.end());
+      sccs.push_back(std::move(members));
+    }
+  }
+
+  m_sccs.resize(sccs.size());
+  m_callers.resize(sccs.size());
+  m_num_callees.resize(sccs.size());
+  for (size_t scc = 0; scc < sccs.size(); ++scc) {
+    std::vector<size_t> callees;
+    for (auto v : sccs[scc]) {
+      m_sccs[scc].push_back(methods[v]);
+      for (auto w : succs[v]) {
+        if (scc_of[w] != scc) {
+          callees.push_back(scc_of[w]);
+        }
+      }
+    }
+    std::sort(callees.begin(), callees.end());
+    callees.erase(std::unique(callees.begin(), callees.end()), callees.end());
+    m_num_callees[scc] = callees.size();
+    for (auto callee : callees) {
+      m_callers[callee].push_back(scc);
+    }
+  }
+}
+
+size_t SccDag::largest_scc_size() const {
+  size_t largest = 0;
+  for (const auto& members : m_sccs) {
+    largest = std::max(largest, members.size());
+  }
+  return largest;
+}
+
 } // namespace call_graph
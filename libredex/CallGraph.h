@@ -7,12 +7,16 @@
 
 #pragma once
 
+#include <atomic>
+#include <functional>
 #include <unordered_map>
+#include <vector>
 
 #include "DexClass.h"
 #include "IRCode.h"
 #include "MonotonicFixpointIterator.h"
 #include "Resolver.h"
+#include "WorkQueue.h"
 
 namespace method_override_graph {
 class Graph;
@@ -238,4 +242,78 @@ struct CallgraphStats {
 
 CallgraphStats get_num_nodes_edges(const Graph& graph);
 
+/*
+ * The strongly connected components of a call graph, restricted to a given
+ * list of methods, and the DAG that they form. Components are numbered
+ * bottom-up: a component comes after all the components it calls into. The
+ * members of each component keep the order of the given list, so as long as
+ * that order is deterministic, so is the order in which bottom-up analyses see
+ * the members of a cycle.
+ */
+class SccDag {
+ public:
+  /*
+   * Calls into methods that are not in the list, or for which `is_dependency`
+   * returns false -- e.g. because their summary is already known -- are not
+   * edges of the DAG.
+   */
+  SccDag(const Graph& graph,
+         const std::vector<const DexMethod*>& methods,
+         const std::function<bool(const DexMethod*)>& is_dependency = nullptr);
+
+  size_t size() const { return m_sccs.size(); }
+
+  const std::vector<const DexMethod*>& members(size_t scc) const {
+    return m_sccs.at(scc);
+  }
+
+  // The distinct components that call into the given one.
+  const std::vector<size_t>& callers(size_t scc) const {
+    return m_callers.at(scc);
+  }
+
+  // The number of distinct components that the given one calls into.
+  size_t num_callees(size_t scc) const { return m_num_callees.at(scc); }
+
+  size_t largest_scc_size() const;
+
+  /*
+   * Call `fn` with the members of each component, as soon as all the
+   * components it calls into are done. Independent components run in
+   * parallel; the work queue steals work across threads, so a long chain of
+   * components doesn't hold up the others.
+   */
+  template <typename Fn>
+  void run_bottom_up(
+      const Fn& fn,
+      size_t num_threads = redex_parallel::default_num_threads()) const {
+    std::vector<std::atomic<size_t>> pending(m_sccs.size());
+    for (size_t scc = 0; scc < m_sccs.size(); ++scc) {
+      pending[scc] = m_num_callees[scc];
+    }
+    auto wq = workqueue_foreach<size_t>(
+        [&](sparta::SpartaWorkerState<size_t>* state, size_t scc) {
+          fn(m_sccs[scc]);
+          for (auto caller : m_callers[scc]) {
+            if (--pending[caller] == 0) {
+              state->push_task(caller);
+            }
+          }
+        },
+        num_threads,
+        /* push_tasks_while_running */ true);
+    for (size_t scc = 0; scc < m_sccs.size(); ++scc) {
+      if (m_num_callees[scc] == 0) {
+        wq.add_item(scc);
+      }
+    }
+    wq.run_all();
+  }
+
+ private:
+  std::vector<std::vector<const DexMethod*>> m_sccs;
+  std::vector<std::vector<size_t>> m_callers;
+  std::vector<size_t> m_num_callees;
+};
+
 } // namespace call_graph
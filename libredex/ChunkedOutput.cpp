@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "ChunkedOutput.h"
+
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+#include "WorkQueue.h"
+
+namespace chunked_output {
+
+namespace {
+
+// Number of chunks formatted per thread before the batch is written out.
+constexpr size_t CHUNKS_PER_THREAD = 4;
+
+} // namespace
+
+void write(size_t num_items,
+           const FormatFn& format,
+           const WriteFn& write,
+           size_t items_per_chunk) {
+  if (num_items == 0) {
+    return;
+  }
+  auto num_threads = redex_parallel::default_num_threads();
+  auto num_chunks = (num_items + items_per_chunk - 1) / items_per_chunk;
+  if (num_threads <= 1 || num_chunks == 1) {
+    std::ostringstream os;
+    format(0, num_items, os);
+    write(os.str());
+    return;
+  }
+  auto batch_size = num_threads * CHUNKS_PER_THREAD;
+  std::vector<std::string> formatted(batch_size);
+  for (size_t batch_begin = 0; batch_begin < num_chunks;
+       batch_begin += batch_size) {
+    auto batch_end = std::min(num_chunks, batch_begin + batch_size);
+    auto wq = workqueue_foreach<size_t>(
+        [&](size_t chunk) {
+          std::ostringstream os;
+          auto begin = chunk * items_per_chunk;
+          format(begin, std::min(num_items, begin + items_per_chunk), os);
+          formatted[chunk - batch_begin] = os.str();
+        },
+        num_threads);
+    for (auto chunk = batch_begin; chunk < batch_end; ++chunk) {
+      wq.add_item(chunk);
+    }
+    wq.run_all();
+    for (size_t i = 0; i < batch_end - batch_begin; ++i) {
+      write(formatted[i]);
+      std::string().swap(formatted[i]);
+    }
+  }
+}
+
+void write(std::ostream& os,
+           size_t num_items,
+           const FormatFn& format,
+           size_t items_per_chunk) {
+  write(
+      num_items, format, [&](const std::string& s) { os << s; },
+      items_per_chunk);
+}
+
+} // namespace chunked_output
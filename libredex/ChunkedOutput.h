@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <functional>
+#include <ostream>
+#include <string>
+
+namespace chunked_output {
+
+// Callers that format item by item group this many items into a chunk.
+constexpr size_t DEFAULT_ITEMS_PER_CHUNK = 256;
+
+using FormatFn = std::function<void(size_t begin, size_t end, std::ostream&)>;
+using WriteFn = std::function<void(const std::string&)>;
+
+/*
+ * Formats the items [0, num_items) in chunks on the work queue and hands the
+ * formatted chunks to `write` in item order. Chunks are formatted a batch at
+ * a time, so only a bounded number of them is held in memory before being
+ * streamed out.
+ *
+ * `format` is called concurrently for disjoint ranges and must only write
+ * to the given stream.
+ */
+void write(size_t num_items,
+           const FormatFn& format,
+           const WriteFn& write,
+           size_t items_per_chunk = DEFAULT_ITEMS_PER_CHUNK);
+
+void write(std::ostream& os,
+           size_t num_items,
+           const FormatFn& format,
+           size_t items_per_chunk = DEFAULT_ITEMS_PER_CHUNK);
+
+} // namespace chunked_output
@@ -2037,7 +2037,7 @@ void ControlFlowGraph::cleanup_deleted_edges(const EdgeSet& edges) {
     if (last_it != pred_block->end()) {
       auto last_insn = last_it->insn;
       auto op = last_insn->opcode();
-      auto remaining_forward_edges = pred_block->succs();
+      const auto& remaining_forward_edges = pred_block->succs();
       if ((opcode::is_a_conditional_branch(op) || opcode::is_switch(op)) &&
           remaining_forward_edges.size() == 1) {
         pred_block->m_entries.erase_and_dispose(last_it);
@@ -981,6 +981,11 @@ class ControlFlowGraph {
                        }),
         reverse_edges.end());
 
+    // Several removed edges may share a source block. Visit each one once, or
+    // removing many edges between the same two blocks becomes quadratic.
+    std::sort(source_blocks.begin(), source_blocks.end());
+    source_blocks.erase(std::unique(source_blocks.begin(), source_blocks.end()),
+                        source_blocks.end());
     for (Block* source_block : source_blocks) {
       auto& forward_edges = source_block->m_succs;
       forward_edges.erase(
@@ -1017,6 +1022,10 @@ class ControlFlowGraph {
                        }),
         forward_edges.end());
 
+    // E.g. many cases of a switch may share a target block, see above.
+    std::sort(target_blocks.begin(), target_blocks.end());
+    target_blocks.erase(std::unique(target_blocks.begin(), target_blocks.end()),
+                        target_blocks.end());
     for (Block* target_block : target_blocks) {
       auto& reverse_edges = target_block->m_preds;
       reverse_edges.erase(
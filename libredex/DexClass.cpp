@@ -25,6 +25,7 @@
 #include "Util.h"
 #include "Walkers.h"
 #include "Warning.h"
+#include "WorkQueue.h"
 
 #include <algorithm>
 #include <boost/functional/hash.hpp>
@@ -37,7 +38,7 @@ uint32_t DexString::length() const {
   if (is_simple()) {
     return size();
   }
-  return length_of_utf8_string(c_str());
+  return mutf8::utf16_length(c_str(), size());
 }
 
 int32_t DexString::java_hashcode() const {
@@ -1510,14 +1511,42 @@ void gather_components(std::vector<DexString*>& lstring,
                        std::vector<DexMethodHandle*>& lmethodhandle,
                        const DexClasses& classes,
                        bool exclude_loads) {
-  // Gather references reachable from each class.
+  // Gather references reachable from each class. Every worker accumulates
+  // into its own set of vectors, which are merged afterwards; the order in
+  // which they are merged does not matter as everything gets sorted below.
+  struct Components {
+    std::vector<DexString*> strings;
+    std::vector<DexType*> types;
+    std::vector<DexFieldRef*> fields;
+    std::vector<DexMethodRef*> methods;
+    std::vector<DexCallSite*> callsites;
+    std::vector<DexMethodHandle*> methodhandles;
+  };
+  auto num_threads = redex_parallel::default_num_threads();
+  std::vector<Components> per_worker(num_threads);
+  auto wq = workqueue_foreach<DexClass*>(
+      [&](sparta::SpartaWorkerState<DexClass*>* state, DexClass* cls) {
+        auto& c = per_worker[state->worker_id()];
+        cls->gather_strings(c.strings, exclude_loads);
+        cls->gather_types(c.types);
+        cls->gather_fields(c.fields);
+        cls->gather_methods(c.methods);
+        cls->gather_callsites(c.callsites);
+        cls->gather_methodhandles(c.methodhandles);
+      },
+      num_threads);
   for (auto const& cls : classes) {
-    cls->gather_strings(lstring, exclude_loads);
-    cls->gather_types(ltype);
-    cls->gather_fields(lfield);
-    cls->gather_methods(lmethod);
-    cls->gather_callsites(lcallsite);
-    cls->gather_methodhandles(lmethodhandle);
+    wq.add_item(cls);
+  }
+  wq.run_all();
+  for (auto& c : per_worker) {
+    lstring.insert(lstring.end(), c.strings.begin(), c.strings.end());
+    ltype.insert(ltype.end(), c.types.begin(), c.types.end());
+    lfield.insert(lfield.end(), c.fields.begin(), c.fields.end());
+    lmethod.insert(lmethod.end(), c.methods.begin(), c.methods.end());
+    lcallsite.insert(lcallsite.end(), c.callsites.begin(), c.callsites.end());
+    lmethodhandle.insert(lmethodhandle.end(), c.methodhandles.begin(),
+                         c.methodhandles.end());
   }
 
   // Remove duplicates to speed up the later loops.
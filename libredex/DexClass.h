@@ -123,7 +123,7 @@ class DexString {
 
   void encode(uint8_t* output) const {
     output = write_uleb128(output, m_utfsize);
-    strcpy((char*)output, c_str());
+    memcpy(output, c_str(), size() + 1);
   }
 };
 
@@ -144,28 +144,7 @@ inline bool compare_dexstrings(const DexString* a, const DexString* b) {
    * Bother, need to do code-point character-by-character
    * comparison.
    */
-  const char* sa = a->c_str();
-  const char* sb = b->c_str();
-  /* Equivalence test first, so we don't worry about walking
-   * off the end.
-   */
-  if (strcmp(sa, sb) == 0) return false;
-  if (strlen(sa) == 0) {
-    return true;
-  }
-  if (strlen(sb) == 0) {
-    return false;
-  }
-  while (1) {
-    uint32_t cpa = mutf8_next_code_point(sa);
-    uint32_t cpb = mutf8_next_code_point(sb);
-    if (cpa == cpb) {
-      if (*sa == '\0') return true;
-      if (*sb == '\0') return false;
-      continue;
-    }
-    return (cpa < cpb);
-  }
+  return mutf8::compare(a->c_str(), a->size(), b->c_str(), b->size()) < 0;
 }
 
 struct dexstrings_comparator {
@@ -8,8 +8,10 @@
 #include "DexHasher.h"
 
 #include "DexAccess.h"
+#include "DexCallSite.h"
 #include "DexClass.h"
 #include "DexInstruction.h"
+#include "DexMethodHandle.h"
 #include "DexPosition.h"
 #include "DexUtil.h"
 #include "IRCode.h"
@@ -123,6 +125,55 @@ void DexClassHasher::hash(const IRInstruction* insn) {
   }
 }
 
+void DexClassHasher::hash(const DexInstruction* insn) {
+  auto op = insn->opcode();
+  hash((uint16_t)op);
+
+  auto old_hash = m_hash;
+  m_hash = 0;
+  if (insn->has_dest()) {
+    hash(insn->dest());
+  }
+  for (unsigned i = 0; i < insn->srcs_size(); i++) {
+    hash(insn->src(i));
+  }
+  if (insn->has_range()) {
+    hash(insn->range_base());
+    hash(insn->range_size());
+  }
+  boost::hash_combine(m_registers_hash, m_hash);
+  m_hash = old_hash;
+
+  if (dex_opcode::has_arg_word_count(op)) {
+    hash(insn->arg_word_count());
+  }
+  if (insn->has_literal()) {
+    hash((uint64_t)insn->get_literal());
+  }
+  if (insn->has_offset()) {
+    hash((uint32_t)insn->offset());
+  }
+  if (insn->has_string()) {
+    hash(static_cast<const DexOpcodeString*>(insn)->get_string());
+  } else if (insn->has_type()) {
+    hash(static_cast<const DexOpcodeType*>(insn)->get_type());
+  } else if (insn->has_field()) {
+    hash(static_cast<const DexOpcodeField*>(insn)->get_field());
+  } else if (insn->has_method()) {
+    hash(static_cast<const DexOpcodeMethod*>(insn)->get_method());
+  } else if (insn->has_callsite()) {
+    hash(static_cast<const DexOpcodeCallSite*>(insn)->get_callsite());
+  } else if (insn->has_methodhandle()) {
+    hash(static_cast<const DexOpcodeMethodHandle*>(insn)->get_methodhandle());
+  } else if (dex_opcode::is_fopcode(op)) {
+    auto data = static_cast<const DexOpcodeData*>(insn);
+    hash(data->data_size());
+    for (auto i = 0; i < data->data_size(); i++) {
+      hash(data->data()[i]);
+    }
+  }
+}
+
 void DexClassHasher::hash(const IRCode* c) {
   if (!c) {
     return;
@@ -150,6 +201,9 @@ void DexClassHasher::hash(const IRCode* c) {
     case MFLOW_OPCODE:
       hash(mie.insn);
       break;
+    case MFLOW_DEX_OPCODE:
+      hash(mie.dex_insn);
+      break;
     case MFLOW_TRY:
       hash((uint8_t)mie.tentry->type);
       hash(get_id(mie.tentry->catch_start));
@@ -214,6 +268,22 @@ void DexClassHasher::hash(const DexFieldRef* f) {
 
 void DexClassHasher::hash(const DexType* t) { hash(t->get_name()); }
 
+void DexClassHasher::hash(const DexCallSite* c) {
+  hash(c->method_handle());
+  hash(c->method_name());
+  hash(c->method_type());
+  hash(c->args());
+}
+
+void DexClassHasher::hash(const DexMethodHandle* h) {
+  hash((uint8_t)h->type());
+  if (DexMethodHandle::isInvokeType(h->type())) {
+    hash(h->methodref());
+  } else {
+    hash(h->fieldref());
+  }
+}
+
 void DexClassHasher::hash(const DexTypeList* l) { hash(l->get_type_list()); }
 
 void DexClassHasher::hash(const ParamAnnotations* m) {
@@ -25,6 +25,10 @@
 #include "IRInstruction.h"
 #include "Sha1.h"
 
+class DexCallSite;
+class DexInstruction;
+class DexMethodHandle;
+
 namespace hashing {
 
 std::string hash_to_string(size_t hash);
@@ -59,6 +63,7 @@ class DexClassHasher final {
   void hash(bool value);
   void hash(const IRCode* c);
   void hash(const IRInstruction* insn);
+  void hash(const DexInstruction* insn);
   void hash(const EncodedAnnotations* a);
   void hash(const ParamAnnotations* m);
   void hash(const DexAnnotation* a);
@@ -73,6 +78,8 @@ class DexClassHasher final {
   void hash(const DexType* t);
   void hash(const DexTypeList* l);
   void hash(const DexString* s);
+  void hash(const DexCallSite* c);
+  void hash(const DexMethodHandle* h);
   template <class T>
   void hash(const std::vector<T>& l) {
     hash((uint64_t)l.size());
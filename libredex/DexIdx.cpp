@@ -127,7 +127,12 @@ DexString* DexIdx::get_stringidx_fromdex(uint32_t stridx) {
                     "String data offset out of range");
   const uint8_t* dstr = m_dexbase + stroff;
   /* Strip off uleb128 size encoding */
-  int utfsize = read_uleb128(&dstr);
+  uint32_t utfsize = read_uleb128(&dstr);
+  uint32_t length = 0;
+  always_assert_log(
+      mutf8::validate((const char*)dstr, strlen((const char*)dstr), &length) &&
+          length == utfsize,
+      "Malformed MUTF-8 string data at offset %u", stroff);
   return DexString::make_string((const char*)dstr, utfsize);
 }
 
@@ -8,6 +8,7 @@
 #include "DexOutput.h"
 
 #include <algorithm>
+#include <array>
 #include <assert.h>
 #include <exception>
 #include <fcntl.h>
@@ -32,12 +33,14 @@
 #define O_WRONLY _O_WRONLY
 #endif
 
+#include "ChunkedOutput.h"
 #include "Debug.h"
 #include "DexCallSite.h"
 #include "DexClass.h"
 #include "DexInstruction.h"
 #include "DexLimits.h"
 #include "DexMethodHandle.h"
+#include "DexOutputCache.h"
 #include "DexPosition.h"
 #include "DexUtil.h"
 #include "IODIMetadata.h"
@@ -90,6 +93,101 @@ class CustomSort {
   }
 };
 
+namespace {
+
+// Below this size, sorting on a single thread is faster than farming out the
+// chunks.
+constexpr size_t MIN_PARALLEL_SORT_SIZE = 4096;
+
+/*
+ * Sorts the chunks of the vector in parallel, then merges adjacent runs in
+ * parallel rounds. For a strict total order, which all the dex item orders
+ * are, the result is identical to std::sort.
+ */
+template <class T, class Compare>
+void parallel_sort(std::vector<T>& vec, const Compare& cmp) {
+  auto num_chunks = std::min<size_t>(redex_parallel::default_num_threads(),
+                                     vec.size() / MIN_PARALLEL_SORT_SIZE);
+  if (num_chunks <= 1) {
+    std::sort(vec.begin(), vec.end(), cmp);
+    return;
+  }
+  std::vector<size_t> bounds;
+  for (size_t i = 0; i < num_chunks; ++i) {
+    bounds.push_back(vec.size() * i / num_chunks);
+  }
+  bounds.push_back(vec.size());
+  auto sort_wq = workqueue_foreach<size_t>(
+      [&](size_t i) {
+        std::sort(vec.begin() + bounds[i], vec.begin() + bounds[i + 1], cmp);
+      },
+      num_chunks);
+  for (size_t i = 0; i < num_chunks; ++i) {
+    sort_wq.add_item(i);
+  }
+  sort_wq.run_all();
+  while (bounds.size() > 2) {
+    auto num_merges = (bounds.size() - 1) / 2;
+    auto merge_wq = workqueue_foreach<size_t>(
+        [&](size_t i) {
+          std::inplace_merge(vec.begin() + bounds[2 * i],
+                             vec.begin() + bounds[2 * i + 1],
+                             vec.begin() + bounds[2 * i + 2], cmp);
+        },
+        num_merges);
+    for (size_t i = 0; i < num_merges; ++i) {
+      merge_wq.add_item(i);
+    }
+    merge_wq.run_all();
+    std::vector<size_t> merged_bounds;
+    for (size_t i = 0; i < bounds.size(); i += 2) {
+      merged_bounds.push_back(bounds[i]);
+    }
+    if (merged_bounds.back() != vec.size()) {
+      merged_bounds.push_back(vec.size());
+    }
+    bounds = std::move(merged_bounds);
+  }
+}
+
+/*
+ * Sorts the items by precomputed, flat sort keys instead of following
+ * pointers in the comparator. Returns false without touching the items if a
+ * key cannot be computed, in which case the caller falls back to the regular
+ * comparator.
+ */
+template <class T, class Key, class KeyFn>
+bool sort_by_key(std::vector<T*>& items, const KeyFn& key_of) {
+  std::vector<std::pair<Key, T*>> keyed;
+  keyed.reserve(items.size());
+  for (auto* item : items) {
+    keyed.emplace_back(Key(), item);
+    if (!key_of(item, &keyed.back().first)) {
+      return false;
+    }
+  }
+  parallel_sort(keyed,
+                [](const std::pair<Key, T*>& a, const std::pair<Key, T*>& b) {
+                  return a.first < b.first;
+                });
+  for (size_t i = 0; i < keyed.size(); ++i) {
+    items[i] = keyed[i].second;
+  }
+  return true;
+}
+
+template <class T, class IdxMap>
+bool lookup_idx(const IdxMap& idx_map, T* item, uint32_t* idx) {
+  auto it = idx_map.find(item);
+  if (it == idx_map.end()) {
+    return false;
+  }
+  *idx = it->second;
+  return true;
+}
+
+} // namespace
+
 GatheredTypes::GatheredTypes(DexClasses* classes,
                              PostLowering const* post_lowering)
     : m_classes(classes) {
@@ -200,10 +298,15 @@ DexOutputIdx* GatheredTypes::get_dodx(const uint8_t* base) {
    * dependency on ordering.
    */
   dexstring_to_idx* string = get_string_index();
-  dextype_to_idx* type = get_type_index();
-  dexproto_to_idx* proto = get_proto_index();
-  dexfield_to_idx* field = get_field_index();
-  dexmethod_to_idx* method = get_method_index();
+  dextype_to_idx* type = get_type_index(compare_dextypes, string);
+  // Type indices are 16 bits wide; an oversized table is reported later on,
+  // but cannot serve as sort keys.
+  const dextype_to_idx* type_keys = type->size() <= (1u << 16) ? type : nullptr;
+  dexproto_to_idx* proto = get_proto_index(compare_dexprotos, type_keys);
+  dexfield_to_idx* field =
+      get_field_index(compare_dexfields, string, type_keys);
+  dexmethod_to_idx* method =
+      get_method_index(compare_dexmethods, string, type_keys, proto);
   std::vector<DexTypeList*>* typelist = get_typelist_list(proto);
   dexcallsite_to_idx* callsite = get_callsite_index();
   dexmethodhandle_to_idx* methodhandle = get_methodhandle_index();
@@ -212,8 +315,9 @@ DexOutputIdx* GatheredTypes::get_dodx(const uint8_t* base) {
 }
 
 dexstring_to_idx* GatheredTypes::get_string_index(cmp_dstring cmp) {
-  std::sort(m_lstring.begin(), m_lstring.end(), cmp);
+  parallel_sort(m_lstring, cmp);
   dexstring_to_idx* sidx = new dexstring_to_idx();
+  sidx->reserve(m_lstring.size());
   uint32_t idx = 0;
   for (auto it = m_lstring.begin(); it != m_lstring.end(); it++) {
     sidx->insert(std::make_pair(*it, idx++));
@@ -221,9 +325,21 @@ dexstring_to_idx* GatheredTypes::get_string_index(cmp_dstring cmp) {
   return sidx;
 }
 
-dextype_to_idx* GatheredTypes::get_type_index(cmp_dtype cmp) {
-  std::sort(m_ltype.begin(), m_ltype.end(), cmp);
+dextype_to_idx* GatheredTypes::get_type_index(
+    cmp_dtype cmp, const dexstring_to_idx* string_keys) {
+  // The default order is the order of the type names, so sort by their
+  // string indices.
+  bool sorted =
+      cmp == compare_dextypes && string_keys &&
+      sort_by_key<DexType, uint32_t>(
+          m_ltype, [&](DexType* t, uint32_t* key) {
+            return lookup_idx(*string_keys, t->get_name(), key);
+          });
+  if (!sorted) {
+    parallel_sort(m_ltype, cmp);
+  }
   dextype_to_idx* sidx = new dextype_to_idx();
+  sidx->reserve(m_ltype.size());
   uint32_t idx = 0;
   for (auto it = m_ltype.begin(); it != m_ltype.end(); it++) {
     sidx->insert(std::make_pair(*it, idx++));
@@ -231,9 +347,24 @@ dextype_to_idx* GatheredTypes::get_type_index(cmp_dtype cmp) {
   return sidx;
 }
 
-dexfield_to_idx* GatheredTypes::get_field_index(cmp_dfield cmp) {
-  std::sort(m_lfield.begin(), m_lfield.end(), cmp);
+dexfield_to_idx* GatheredTypes::get_field_index(
+    cmp_dfield cmp,
+    const dexstring_to_idx* string_keys,
+    const dextype_to_idx* type_keys) {
+  // The default order is by class, name and type.
+  bool sorted =
+      cmp == compare_dexfields && string_keys && type_keys &&
+      sort_by_key<DexFieldRef, std::array<uint32_t, 3>>(
+          m_lfield, [&](DexFieldRef* f, std::array<uint32_t, 3>* key) {
+            return lookup_idx(*type_keys, f->get_class(), &(*key)[0]) &&
+                   lookup_idx(*string_keys, f->get_name(), &(*key)[1]) &&
+                   lookup_idx(*type_keys, f->get_type(), &(*key)[2]);
+          });
+  if (!sorted) {
+    parallel_sort(m_lfield, cmp);
+  }
   dexfield_to_idx* sidx = new dexfield_to_idx();
+  sidx->reserve(m_lfield.size());
   uint32_t idx = 0;
   for (auto it = m_lfield.begin(); it != m_lfield.end(); it++) {
     sidx->insert(std::make_pair(*it, idx++));
@@ -241,9 +372,25 @@ dexfield_to_idx* GatheredTypes::get_field_index(cmp_dfield cmp) {
   return sidx;
 }
 
-dexmethod_to_idx* GatheredTypes::get_method_index(cmp_dmethod cmp) {
-  std::sort(m_lmethod.begin(), m_lmethod.end(), cmp);
+dexmethod_to_idx* GatheredTypes::get_method_index(
+    cmp_dmethod cmp,
+    const dexstring_to_idx* string_keys,
+    const dextype_to_idx* type_keys,
+    const dexproto_to_idx* proto_keys) {
+  // The default order is by class, name and proto.
+  bool sorted =
+      cmp == compare_dexmethods && string_keys && type_keys && proto_keys &&
+      sort_by_key<DexMethodRef, std::array<uint32_t, 3>>(
+          m_lmethod, [&](DexMethodRef* m, std::array<uint32_t, 3>* key) {
+            return lookup_idx(*type_keys, m->get_class(), &(*key)[0]) &&
+                   lookup_idx(*string_keys, m->get_name(), &(*key)[1]) &&
+                   lookup_idx(*proto_keys, m->get_proto(), &(*key)[2]);
+          });
+  if (!sorted) {
+    parallel_sort(m_lmethod, cmp);
+  }
   dexmethod_to_idx* sidx = new dexmethod_to_idx();
+  sidx->reserve(m_lmethod.size());
   uint32_t idx = 0;
   for (auto it = m_lmethod.begin(); it != m_lmethod.end(); it++) {
     sidx->insert(std::make_pair(*it, idx++));
@@ -251,7 +398,8 @@ dexmethod_to_idx* GatheredTypes::get_method_index(cmp_dmethod cmp) {
   return sidx;
 }
 
-dexproto_to_idx* GatheredTypes::get_proto_index(cmp_dproto cmp) {
+dexproto_to_idx* GatheredTypes::get_proto_index(
+    cmp_dproto cmp, const dextype_to_idx* type_keys) {
   std::vector<DexProto*> protos;
   for (auto const& m : m_lmethod) {
     protos.push_back(m->get_proto());
@@ -268,8 +416,29 @@ dexproto_to_idx* GatheredTypes::get_proto_index(cmp_dproto cmp) {
   }
   std::sort(protos.begin(), protos.end());
   protos.erase(std::unique(protos.begin(), protos.end()), protos.end());
-  std::sort(protos.begin(), protos.end(), cmp);
+  // The default order is by return type, then lexicographically by argument
+  // types, which is exactly how vectors of type indices compare.
+  bool sorted =
+      cmp == compare_dexprotos && type_keys &&
+      sort_by_key<DexProto, std::vector<uint32_t>>(
+          protos, [&](DexProto* p, std::vector<uint32_t>* key) {
+            const auto& args = p->get_args()->get_type_list();
+            key->resize(args.size() + 1);
+            if (!lookup_idx(*type_keys, p->get_rtype(), &(*key)[0])) {
+              return false;
+            }
+            for (size_t i = 0; i < args.size(); ++i) {
+              if (!lookup_idx(*type_keys, args[i], &(*key)[i + 1])) {
+                return false;
+              }
+            }
+            return true;
+          });
+  if (!sorted) {
+    std::sort(protos.begin(), protos.end(), cmp);
+  }
   dexproto_to_idx* sidx = new dexproto_to_idx();
+  sidx->reserve(protos.size());
   uint32_t idx = 0;
   for (auto const& proto : protos) {
     sidx->insert(std::make_pair(proto, idx++));
@@ -450,8 +619,11 @@ DexOutput::DexOutput(
     std::unordered_map<DexMethod*, uint64_t>* method_to_id,
     std::unordered_map<DexCode*, std::vector<DebugLineItem>>* code_debug_lines,
     PostLowering const* post_lowering,
-    int min_sdk)
-    : m_config_files(config_files), m_min_sdk(min_sdk) {
+    int min_sdk,
+    DexOutputCache* output_cache)
+    : m_config_files(config_files),
+      m_min_sdk(min_sdk),
+      m_output_cache(output_cache) {
   m_classes = classes;
   m_iodi_metadata = iodi_metadata;
   // Required because the BytecodeDebugger setting creates huge amounts
@@ -937,6 +1109,36 @@ static void sync_all(const Scope& scope) {
   wq.run_all();
 }
 
+/*
+ * Computes the output cache key of every method of the given classes. The keys
+ * are taken on the IR, so this must run before syncing.
+ */
+static std::unordered_map<DexMethod*, DexOutputCache::Key>
+compute_output_cache_keys(const DexClasses& classes, const DexOutputIdx* dodx) {
+  std::vector<std::vector<std::pair<DexMethod*, DexOutputCache::Key>>>
+      class_keys(classes.size());
+  auto wq = workqueue_foreach<size_t>([&](size_t i) {
+    DexClass* cls = classes.at(i);
+    for (const auto* methods : {&cls->get_dmethods(), &cls->get_vmethods()}) {
+      for (auto* m : *methods) {
+        if (m->get_code() != nullptr) {
+          class_keys[i].emplace_back(m, DexOutputCache::make_key(m, dodx));
+        }
+      }
+    }
+  });
+  for (size_t i = 0; i < classes.size(); i++) {
+    wq.add_item(i);
+  }
+  wq.run_all();
+
+  std::unordered_map<DexMethod*, DexOutputCache::Key> keys;
+  for (auto& v : class_keys) {
+    keys.insert(v.begin(), v.end());
+  }
+  return keys;
+}
+
 void DexOutput::generate_code_items(const std::vector<SortMode>& mode) {
   TRACE(MAIN, 2, "generate_code_items");
   /*
@@ -944,6 +1146,10 @@ void DexOutput::generate_code_items(const std::vector<SortMode>& mode) {
    * emitlist to optimize pagecache efficiency.
    */
   uint32_t ci_start = align(m_offset);
+  std::unordered_map<DexMethod*, DexOutputCache::Key> cache_keys;
+  if (m_output_cache != nullptr) {
+    cache_keys = compute_output_cache_keys(*m_classes, dodx);
+  }
   sync_all(*m_classes);
 
   // Get all methods.
@@ -990,7 +1196,22 @@ void DexOutput::generate_code_items(const std::vector<SortMode>& mode) {
         "Undefined method in generate_code_items()\n\t prototype: %s\n",
         SHOW(meth));
     align_output();
-    int size = code->encode(dodx, (uint32_t*)(m_output + m_offset));
+    int size;
+    auto key_it = cache_keys.find(meth);
+    const std::string* cached = key_it == cache_keys.end()
+                                    ? nullptr
+                                    : m_output_cache->get(key_it->second);
+    if (cached != nullptr) {
+      memcpy(m_output + m_offset, cached->data(), cached->size());
+      size = (int)cached->size();
+    } else {
+      size = code->encode(dodx, (uint32_t*)(m_output + m_offset));
+      if (key_it != cache_keys.end()) {
+        // Debug info offsets are patched in later, so this is still the
+        // pristine encoding.
+        m_output_cache->put(key_it->second, m_output + m_offset, size);
+      }
+    }
     check_method_instruction_size_limit(m_config_files, size, SHOW(meth));
     m_method_bytecode_offsets.emplace_back(meth->get_name()->c_str(), m_offset);
     m_code_item_emits.emplace_back(meth, code,
@@ -2048,10 +2269,15 @@ void write_method_mapping(const std::string& filename,
              strerror(errno));
   std::unordered_set<DexClass*> classes_in_dex(classes->begin(),
                                                classes->end());
-  for (auto& it : dodx->method_to_idx()) {
-    auto method = it.first;
-    auto idx = it.second;
-
+  // Turns out, the checksum can change on-device. (damn you dexopt)
+  // The signature, however, is never recomputed. Let's log the top 4 bytes,
+  // in little-endian (since that's faster to compute on-device).
+  uint32_t signature = *reinterpret_cast<uint32_t*>(dex_signature);
+
+  std::vector<std::pair<DexMethodRef*, uint32_t>> methods(
+      dodx->method_to_idx().begin(), dodx->method_to_idx().end());
+  auto format_method = [&](DexMethodRef* method, uint32_t idx,
+                           std::ostream& os) {
     // Types (and methods) internal to our app have a cached deobfuscated name
     // that comes from the proguard map.  If we don't have one, it's a
     // system/framework class, so we can just return the name.
@@ -2060,7 +2286,7 @@ void write_method_mapping(const std::string& filename,
     if (classes_in_dex.count(cls) == 0) {
       // We only want to emit IDs for the methods that are defined in this dex,
       // and not for references to methods in other dexes.
-      continue;
+      return;
     }
     auto deobf_class = [&] {
       if (cls) {
@@ -2099,14 +2325,19 @@ void write_method_mapping(const std::string& filename,
     auto end = deobf_method.rfind(':');
     auto deobf_method_name = deobf_method.substr(begin, end - begin);
 
-    // Turns out, the checksum can change on-device. (damn you dexopt)
-    // The signature, however, is never recomputed. Let's log the top 4 bytes,
-    // in little-endian (since that's faster to compute on-device).
-    uint32_t signature = *reinterpret_cast<uint32_t*>(dex_signature);
-
-    fprintf(fd, "%u %u %s %s\n", idx, signature, deobf_method_name.c_str(),
-            deobf_class.c_str());
-  }
+    os << idx << ' ' << signature << ' ' << deobf_method_name << ' '
+       << deobf_class << '\n';
+  };
+  chunked_output::write(
+      methods.size(),
+      [&](size_t begin, size_t end, std::ostream& os) {
+        for (auto i = begin; i < end; ++i) {
+          format_method(methods[i].first, methods[i].second, os);
+        }
+      },
+      [&](const std::string& chunk) {
+        fwrite(chunk.data(), 1, chunk.size(), fd);
+      });
   fclose(fd);
 }
 
@@ -2117,23 +2348,28 @@ void write_class_mapping(const std::string& filename,
   always_assert(!filename.empty());
   FILE* fd = fopen(filename.c_str(), "a");
 
-  for (uint32_t idx = 0; idx < class_defs_size; idx++) {
-
-    DexClass* cls = classes->at(idx);
-    auto deobf_class = [&] {
-      if (cls) {
-        auto deobname = cls->get_deobfuscated_name();
-        if (!deobname.empty()) return deobname;
-      }
-      return show(cls);
-    }();
-
-    //
-    // See write_method_mapping above for why checksum is insufficient.
-    //
-    uint32_t signature = *reinterpret_cast<uint32_t*>(dex_signature);
-    fprintf(fd, "%u %u %s\n", idx, signature, deobf_class.c_str());
-  }
+  //
+  // See write_method_mapping above for why checksum is insufficient.
+  //
+  uint32_t signature = *reinterpret_cast<uint32_t*>(dex_signature);
+  chunked_output::write(
+      class_defs_size,
+      [&](size_t begin, size_t end, std::ostream& os) {
+        for (auto idx = begin; idx < end; idx++) {
+          DexClass* cls = classes->at(idx);
+          auto deobf_class = [&] {
+            if (cls) {
+              auto deobname = cls->get_deobfuscated_name();
+              if (!deobname.empty()) return deobname;
+            }
+            return show(cls);
+          }();
+          os << idx << ' ' << signature << ' ' << deobf_class << '\n';
+        }
+      },
+      [&](const std::string& chunk) {
+        fwrite(chunk.data(), 1, chunk.size(), fd);
+      });
 
   fclose(fd);
 }
@@ -2269,56 +2505,69 @@ void write_pg_mapping(const std::string& filename, DexClasses* classes) {
     return show(field);
   };
 
-  std::ofstream ofs(filename.c_str(), std::ofstream::out | std::ofstream::app);
-
-  for (auto cls : *classes) {
+  auto format_class = [&](DexClass* cls, std::ostream& os) {
     auto deobf_cls = deobf_class(cls);
-    ofs << java_names::internal_to_external(deobf_cls) << " -> "
-        << java_names::internal_to_external(cls->get_type()->c_str()) << ":"
-        << std::endl;
+    os << java_names::internal_to_external(deobf_cls) << " -> "
+       << java_names::internal_to_external(cls->get_type()->c_str()) << ":"
+       << '\n';
     for (auto field : cls->get_ifields()) {
       auto deobf = deobf_field(field);
-      ofs << "    " << deobf << " -> " << field->c_str() << std::endl;
+      os << "    " << deobf << " -> " << field->c_str() << '\n';
     }
     for (auto field : cls->get_sfields()) {
       auto deobf = deobf_field(field);
-      ofs << "    " << deobf << " -> " << field->c_str() << std::endl;
+      os << "    " << deobf << " -> " << field->c_str() << '\n';
     }
     for (auto meth : cls->get_dmethods()) {
       auto deobf = deobf_meth(meth);
-      ofs << "    " << deobf << " -> " << meth->c_str() << std::endl;
+      os << "    " << deobf << " -> " << meth->c_str() << '\n';
     }
     for (auto meth : cls->get_vmethods()) {
       auto deobf = deobf_meth(meth);
-      ofs << "    " << deobf << " -> " << meth->c_str() << std::endl;
+      os << "    " << deobf << " -> " << meth->c_str() << '\n';
     }
-  }
+  };
+
+  std::ofstream ofs(filename.c_str(), std::ofstream::out | std::ofstream::app);
+  chunked_output::write(
+      ofs, classes->size(), [&](size_t begin, size_t end, std::ostream& os) {
+        for (auto i = begin; i < end; ++i) {
+          format_class(classes->at(i), os);
+        }
+      });
 }
 
 void write_full_mapping(const std::string& filename, DexClasses* classes) {
   if (filename.empty()) return;
 
-  std::ofstream ofs(filename.c_str(), std::ofstream::out | std::ofstream::app);
-  for (auto cls : *classes) {
-    ofs << "type " << cls->get_deobfuscated_name() << " -> " << show(cls)
-        << std::endl;
+  auto format_class = [](DexClass* cls, std::ostream& os) {
+    os << "type " << cls->get_deobfuscated_name() << " -> " << show(cls)
+       << '\n';
     for (auto field : cls->get_ifields()) {
-      ofs << "ifield " << field->get_deobfuscated_name() << " -> "
-          << show(field) << std::endl;
+      os << "ifield " << field->get_deobfuscated_name() << " -> "
+         << show(field) << '\n';
     }
     for (auto field : cls->get_sfields()) {
-      ofs << "sfield " << field->get_deobfuscated_name() << " -> "
-          << show(field) << std::endl;
+      os << "sfield " << field->get_deobfuscated_name() << " -> "
+         << show(field) << '\n';
     }
     for (auto method : cls->get_dmethods()) {
-      ofs << "dmethod " << method->get_deobfuscated_name() << " -> "
-          << show(method) << std::endl;
+      os << "dmethod " << method->get_deobfuscated_name() << " -> "
+         << show(method) << '\n';
     }
     for (auto method : cls->get_vmethods()) {
-      ofs << "vmethod " << method->get_deobfuscated_name() << " -> "
-          << show(method) << std::endl;
+      os << "vmethod " << method->get_deobfuscated_name() << " -> "
+         << show(method) << '\n';
     }
-  }
+  };
+
+  std::ofstream ofs(filename.c_str(), std::ofstream::out | std::ofstream::app);
+  chunked_output::write(
+      ofs, classes->size(), [&](size_t begin, size_t end, std::ostream& os) {
+        for (auto i = begin; i < end; ++i) {
+          format_class(classes->at(i), os);
+        }
+      });
 }
 
 void write_bytecode_offset_mapping(
@@ -2332,9 +2581,17 @@ void write_bytecode_offset_mapping(
   assert_log(fd, "Can't open bytecode offset file %s: %s\n", filename.c_str(),
              strerror(errno));
 
-  for (const auto& item : method_offsets) {
-    fprintf(fd, "%u %s\n", item.second, item.first.c_str());
-  }
+  chunked_output::write(
+      method_offsets.size(),
+      [&](size_t begin, size_t end, std::ostream& os) {
+        for (auto i = begin; i < end; ++i) {
+          os << method_offsets[i].second << ' ' << method_offsets[i].first
+             << '\n';
+        }
+      },
+      [&](const std::string& chunk) {
+        fwrite(chunk.data(), 1, chunk.size(), fd);
+      });
 
   fclose(fd);
 }
@@ -2518,7 +2775,8 @@ dex_stats_t write_classes_to_dex(
     IODIMetadata* iodi_metadata,
     const std::string& dex_magic,
     PostLowering const* post_lowering,
-    int min_sdk) {
+    int min_sdk,
+    DexOutputCache* output_cache) {
   const JsonWrapper& json_cfg = conf.get_json_config();
   bool force_single_dex = json_cfg.get("force_single_dex", false);
   if (force_single_dex) {
@@ -2554,7 +2812,8 @@ dex_stats_t write_classes_to_dex(
   DexOutput dout = DexOutput(
       filename.c_str(), classes, locator_index, normal_primary_dex,
       store_number, dex_number, redex_options.debug_info_kind, iodi_metadata,
-      conf, pos_mapper, method_to_id, code_debug_lines, post_lowering, min_sdk);
+      conf, pos_mapper, method_to_id, code_debug_lines, post_lowering, min_sdk,
+      output_cache);
 
   dout.prepare(string_sort_mode, code_sort_mode, conf, dex_magic);
   dout.write();
@@ -26,6 +26,7 @@
 using facebook::Locator;
 
 class DexCallSite;
+class DexOutputCache;
 
 using dexstring_to_idx = std::unordered_map<DexString*, uint32_t>;
 using dextype_to_idx = std::unordered_map<DexType*, uint16_t>;
@@ -140,7 +141,8 @@ dex_stats_t write_classes_to_dex(
     IODIMetadata* iodi_metadata,
     const std::string& dex_magic,
     PostLowering const* post_lowering = nullptr,
-    int min_sdk = 0);
+    int min_sdk = 0,
+    DexOutputCache* output_cache = nullptr);
 
 using cmp_dstring = bool (*)(const DexString*, const DexString*);
 using cmp_dtype = bool (*)(const DexType*, const DexType*);
@@ -227,11 +229,24 @@ class GatheredTypes {
   bool m_legacy_order{true};
 
   void gather_components(PostLowering const* post_lowering);
+  // The tables that are ordered by their components can take the indices of
+  // those components as precomputed sort keys, when they were built with the
+  // default order.
   dexstring_to_idx* get_string_index(cmp_dstring cmp = compare_dexstrings);
-  dextype_to_idx* get_type_index(cmp_dtype cmp = compare_dextypes);
-  dexproto_to_idx* get_proto_index(cmp_dproto cmp = compare_dexprotos);
-  dexfield_to_idx* get_field_index(cmp_dfield cmp = compare_dexfields);
-  dexmethod_to_idx* get_method_index(cmp_dmethod cmp = compare_dexmethods);
+  dextype_to_idx* get_type_index(
+      cmp_dtype cmp = compare_dextypes,
+      const dexstring_to_idx* string_keys = nullptr);
+  dexproto_to_idx* get_proto_index(cmp_dproto cmp = compare_dexprotos,
+                                   const dextype_to_idx* type_keys = nullptr);
+  dexfield_to_idx* get_field_index(
+      cmp_dfield cmp = compare_dexfields,
+      const dexstring_to_idx* string_keys = nullptr,
+      const dextype_to_idx* type_keys = nullptr);
+  dexmethod_to_idx* get_method_index(
+      cmp_dmethod cmp = compare_dexmethods,
+      const dexstring_to_idx* string_keys = nullptr,
+      const dextype_to_idx* type_keys = nullptr,
+      const dexproto_to_idx* proto_keys = nullptr);
   std::vector<DexTypeList*>* get_typelist_list(
       dexproto_to_idx* protos, cmp_dtypelist cmp = compare_dextypelists);
   dexcallsite_to_idx* get_callsite_index(
@@ -328,6 +343,7 @@ class DexOutput {
   const ConfigFiles& m_config_files;
   bool m_force_class_data_end_of_file;
   int m_min_sdk;
+  DexOutputCache* m_output_cache;
 
   void insert_map_item(uint16_t typeidx,
                        uint32_t size,
@@ -392,7 +408,8 @@ class DexOutput {
             std::unordered_map<DexCode*, std::vector<DebugLineItem>>*
                 code_debug_lines,
             PostLowering const* post_lowering = nullptr,
-            int min_sdk = 0);
+            int min_sdk = 0,
+            DexOutputCache* output_cache = nullptr);
   ~DexOutput();
   void prepare(SortMode string_mode,
                const std::vector<SortMode>& code_mode,
@@ -0,0 +1,264 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "DexOutputCache.h"
+
+#include <fstream>
+#include <type_traits>
+#include <vector>
+
+#include "BinarySerialization.h"
+#include "DexInstruction.h"
+#include "DexOutput.h"
+#include "IRCode.h"
+#include "Sha1.h"
+#include "Trace.h"
+
+namespace {
+
+constexpr uint32_t CACHE_VERSION = 2;
+
+template <class T>
+bool read(std::istream& is, T* value) {
+  is.read((char*)value, sizeof(T));
+  return is.good();
+}
+
+// Feeds the key material of a code item to SHA-1. Every value has a fixed
+// width and every list is preceded by its length, so that distinct code items
+// never produce the same input.
+class KeyBuilder {
+ public:
+  explicit KeyBuilder(const DexOutputIdx* dodx) : m_dodx(dodx) {
+    sha1_init(&m_context);
+  }
+
+  template <class T>
+  void add(T value) {
+    static_assert(std::is_arithmetic<T>::value, "Only values can be added");
+    sha1_update(&m_context, (const unsigned char*)&value, sizeof(T));
+  }
+
+  void add_instruction(const IRInstruction* insn) {
+    add((uint16_t)insn->opcode());
+    add((uint32_t)insn->srcs_size());
+    for (size_t i = 0; i < insn->srcs_size(); i++) {
+      add(insn->src(i));
+    }
+    if (insn->has_dest()) {
+      add(insn->dest());
+    }
+    if (insn->has_literal()) {
+      add(insn->get_literal());
+    } else if (insn->has_string()) {
+      add(m_dodx->stringidx(insn->get_string()));
+    } else if (insn->has_type()) {
+      add(m_dodx->typeidx(insn->get_type()));
+    } else if (insn->has_field()) {
+      add(m_dodx->fieldidx(insn->get_field()));
+    } else if (insn->has_method()) {
+      add(m_dodx->methodidx(insn->get_method()));
+    } else if (insn->has_callsite()) {
+      add(m_dodx->callsiteidx(insn->get_callsite()));
+    } else if (insn->has_methodhandle()) {
+      add(m_dodx->methodhandleidx(insn->get_methodhandle()));
+    } else if (insn->has_data()) {
+      add_data(insn->get_data());
+    }
+  }
+
+  void add_instruction(const DexInstruction* insn) {
+    auto op = insn->opcode();
+    add((uint16_t)op);
+    if (insn->has_dest()) {
+      add(insn->dest());
+    }
+    add((uint32_t)insn->srcs_size());
+    for (unsigned i = 0; i < insn->srcs_size(); i++) {
+      add(insn->src(i));
+    }
+    if (insn->has_range()) {
+      add(insn->range_base());
+      add(insn->range_size());
+    }
+    if (dex_opcode::has_arg_word_count(op)) {
+      add(insn->arg_word_count());
+    }
+    if (insn->has_literal()) {
+      add(insn->get_literal());
+    }
+    if (insn->has_string()) {
+      add(m_dodx->stringidx(
+          static_cast<const DexOpcodeString*>(insn)->get_string()));
+    } else if (insn->has_type()) {
+      add(m_dodx->typeidx(static_cast<const DexOpcodeType*>(insn)->get_type()));
+    } else if (insn->has_field()) {
+      add(m_dodx->fieldidx(
+          static_cast<const DexOpcodeField*>(insn)->get_field()));
+    } else if (insn->has_method()) {
+      add(m_dodx->methodidx(
+          static_cast<const DexOpcodeMethod*>(insn)->get_method()));
+    } else if (insn->has_callsite()) {
+      add(m_dodx->callsiteidx(
+          static_cast<const DexOpcodeCallSite*>(insn)->get_callsite()));
+    } else if (insn->has_methodhandle()) {
+      add(m_dodx->methodhandleidx(
+          static_cast<const DexOpcodeMethodHandle*>(insn)->get_methodhandle()));
+    } else if (dex_opcode::is_fopcode(op)) {
+      add_data(static_cast<const DexOpcodeData*>(insn));
+    }
+  }
+
+  void add_data(const DexOpcodeData* data) {
+    add(data->data_size());
+    sha1_update(&m_context, (const unsigned char*)data->data(),
+                data->data_size() * sizeof(uint16_t));
+  }
+
+  DexOutputCache::Key finish() {
+    DexOutputCache::Key key;
+    sha1_final(key.digest.data(), &m_context);
+    return key;
+  }
+
+ private:
+  const DexOutputIdx* m_dodx;
+  Sha1Context m_context;
+};
+
+} // namespace
+
+void DexOutputCache::load() {
+  std::ifstream is(m_path, std::ios::binary);
+  if (!is) {
+    TRACE(OPUT, 1, "[dex-output-cache] no cache at %s", m_path.c_str());
+    return;
+  }
+  uint32_t magic, version;
+  uint64_t count;
+  if (!read(is, &magic) || !read(is, &version) || magic != 0xfaceb000 ||
+      version != CACHE_VERSION || !read(is, &count)) {
+    TRACE(OPUT, 1, "[dex-output-cache] ignoring incompatible cache at %s",
+          m_path.c_str());
+    return;
+  }
+  m_entries.reserve(count);
+  for (uint64_t i = 0; i < count; ++i) {
+    Key key;
+    uint32_t size;
+    if (!read(is, &key.digest) || !read(is, &size)) {
+      break;
+    }
+    std::string bytes(size, '\0');
+    is.read(&bytes[0], size);
+    if (!is.good()) {
+      break;
+    }
+    m_entries[key].bytes = std::move(bytes);
+  }
+  TRACE(OPUT, 1, "[dex-output-cache] loaded %zu entries from %s",
+        m_entries.size(), m_path.c_str());
+}
+
+void DexOutputCache::save() const {
+  std::ofstream os(m_path, std::ios::binary | std::ios::trunc);
+  if (!os) {
+    TRACE(OPUT, 1, "[dex-output-cache] cannot write %s", m_path.c_str());
+    return;
+  }
+  uint64_t count = 0;
+  for (const auto& p : m_entries) {
+    count += p.second.live;
+  }
+  binary_serialization::write_header(os, CACHE_VERSION);
+  binary_serialization::write(os, count);
+  for (const auto& p : m_entries) {
+    if (!p.second.live) {
+      continue;
+    }
+    os.write((const char*)p.first.digest.data(), p.first.digest.size());
+    binary_serialization::write<uint32_t>(os, p.second.bytes.size());
+    os.write(p.second.bytes.data(), p.second.bytes.size());
+  }
+  TRACE(OPUT, 1,
+        "[dex-output-cache] saved %lu entries to %s (%zu hits, %zu misses)",
+        count, m_path.c_str(), m_hits, m_misses);
+}
+
+const std::string* DexOutputCache::get(const Key& key) {
+  auto it = m_entries.find(key);
+  if (it == m_entries.end()) {
+    m_misses++;
+    return nullptr;
+  }
+  m_hits++;
+  it->second.live = true;
+  return &it->second.bytes;
+}
+
+void DexOutputCache::put(const Key& key, const uint8_t* data, size_t size) {
+  auto& entry = m_entries[key];
+  entry.bytes.assign((const char*)data, size);
+  entry.live = true;
+}
+
+DexOutputCache::Key DexOutputCache::make_key(const DexMethod* method,
+                                             const DexOutputIdx* dodx) {
+  const IRCode* code = method->get_code();
+  KeyBuilder builder(dodx);
+  builder.add(dodx->protoidx(method->get_proto()));
+  builder.add(is_static(method));
+  builder.add(code->get_registers_size());
+
+  // Branches, tries and catches refer to other entries by their position.
+  std::unordered_map<const MethodItemEntry*, uint32_t> positions;
+  for (const MethodItemEntry& mie : *code) {
+    positions.emplace(&mie, positions.size());
+  }
+  for (const MethodItemEntry& mie : *code) {
+    switch (mie.type) {
+    case MFLOW_OPCODE:
+      builder.add((uint8_t)mie.type);
+      builder.add_instruction(mie.insn);
+      break;
+    case MFLOW_DEX_OPCODE:
+      builder.add((uint8_t)mie.type);
+      builder.add_instruction(mie.dex_insn);
+      break;
+    case MFLOW_TRY:
+      builder.add((uint8_t)mie.type);
+      builder.add((uint8_t)mie.tentry->type);
+      builder.add(positions.at(mie.tentry->catch_start));
+      break;
+    case MFLOW_CATCH:
+      builder.add((uint8_t)mie.type);
+      builder.add(mie.centry->catch_type != nullptr);
+      if (mie.centry->catch_type != nullptr) {
+        builder.add(dodx->typeidx(mie.centry->catch_type));
+      }
+      builder.add(mie.centry->next == nullptr
+                      ? UINT32_MAX
+                      : positions.at(mie.centry->next));
+      break;
+    case MFLOW_TARGET:
+      builder.add((uint8_t)mie.type);
+      builder.add((uint8_t)mie.target->type);
+      builder.add(positions.at(mie.target->src));
+      if (mie.target->type == BRANCH_MULTI) {
+        builder.add(mie.target->case_key);
+      }
+      break;
+    case MFLOW_DEBUG:
+    case MFLOW_POSITION:
+    case MFLOW_FALLTHROUGH:
+      // Debug information is encoded separately, and its offset is patched
+      // into the code item later.
+      break;
+    }
+  }
+  return builder.finish();
+}
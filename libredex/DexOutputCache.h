@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+
+#include "DexClass.h"
+
+class DexOutputIdx;
+
+/*
+ * A persistent, content-addressed cache of encoded code items, shared by all
+ * the dexes written in one run and reused across builds.
+ *
+ * An entry is keyed by the SHA-1 digest of a serialization of everything the
+ * encoding of a code item depends on: the register and argument counts, and
+ * every instruction, try and catch of the method, with all the strings, types,
+ * fields, methods, call sites and method handles that the instructions refer
+ * to replaced by the indices that the final dex assigned to them. When the
+ * digest matches, DexOutput copies the cached bytes instead of encoding the
+ * method.
+ *
+ * Only entries that were looked up or added during the current run are written
+ * back by save(), so stale entries are evicted after one build.
+ *
+ * The cache is not thread-safe; DexOutput uses it from the thread that emits
+ * the code items.
+ */
+class DexOutputCache {
+ public:
+  struct Key {
+    std::array<uint8_t, 20> digest;
+
+    bool operator==(const Key& that) const { return digest == that.digest; }
+  };
+
+  struct KeyHash {
+    size_t operator()(const Key& key) const {
+      size_t hash;
+      memcpy(&hash, key.digest.data(), sizeof(hash));
+      return hash;
+    }
+  };
+
+  explicit DexOutputCache(std::string path) : m_path(std::move(path)) {}
+
+  /*
+   * Read the entries saved by a previous run. A missing or incompatible file
+   * simply leaves the cache empty.
+   */
+  void load();
+
+  void save() const;
+
+  /*
+   * Returns the cached bytes for the given key, or nullptr.
+   */
+  const std::string* get(const Key& key);
+
+  void put(const Key& key, const uint8_t* data, size_t size);
+
+  size_t size() const { return m_entries.size(); }
+  size_t hits() const { return m_hits; }
+  size_t misses() const { return m_misses; }
+
+  /*
+   * The key of the code item of the given method. This must run before the
+   * code of the method is synced.
+   */
+  static Key make_key(const DexMethod* method, const DexOutputIdx* dodx);
+
+ private:
+  struct Entry {
+    std::string bytes;
+    bool live{false};
+  };
+
+  std::string m_path;
+  std::unordered_map<Key, Entry, KeyHash> m_entries;
+  size_t m_hits{0};
+  size_t m_misses{0};
+};
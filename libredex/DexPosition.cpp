@@ -5,13 +5,17 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <zlib.h>
 
 #include "DexClass.h"
 #include "DexPosition.h"
 #include "DexUtil.h"
 #include "Show.h"
+#include "WorkQueue.h"
 
 DexPosition::DexPosition(uint32_t line) : line(line) {}
 
@@ -92,20 +96,56 @@ void RealPositionMapper::write_map_v2() {
    * Each member of the string pool is encoded as follows:
    * string_length (4 bytes)
    * char[string_length]
+   *
+   * Version 3 stores everything after the version as a zlib stream, preceded
+   * by its uncompressed size (8 bytes).
    */
-  std::ostringstream pos_out;
+  struct PositionNames {
+    std::string class_name;
+    std::string method_name;
+  };
+  // Splitting up the method names is the expensive part, so do it up front
+  // in parallel. Interning the strings has to follow the position order.
+  std::vector<PositionNames> names(m_positions.size());
+  constexpr size_t POSITIONS_PER_CHUNK = 1024;
+  auto wq = workqueue_foreach<size_t>([&](size_t begin) {
+    auto end = std::min(m_positions.size(), begin + POSITIONS_PER_CHUNK);
+    for (auto i = begin; i < end; ++i) {
+      // of the form "class_name.method_name:(arg_types)return_type"
+      const auto& full_method_name = m_positions[i]->method->str();
+      // strip out the args and return type
+      auto qualified_method_name =
+          full_method_name.substr(0, full_method_name.find(':'));
+      names[i].class_name = java_names::internal_to_external(
+          qualified_method_name.substr(0, qualified_method_name.rfind('.')));
+      names[i].method_name =
+          qualified_method_name.substr(qualified_method_name.rfind('.') + 1);
+    }
+  });
+  for (size_t begin = 0; begin < m_positions.size();
+       begin += POSITIONS_PER_CHUNK) {
+    wq.add_item(begin);
+  }
+  wq.run_all();
+
+  std::string pos_out;
+  pos_out.reserve(m_positions.size() * 5 * sizeof(uint32_t));
   std::unordered_map<std::string, uint32_t> string_ids;
-  std::vector<std::string> string_pool;
+  std::vector<const std::string*> string_pool;
 
   auto id_of_string = [&](const std::string& s) -> uint32_t {
-    if (string_ids.find(s) == string_ids.end()) {
-      string_ids[s] = string_pool.size();
-      string_pool.push_back(s);
+    auto it = string_ids.emplace(s, string_pool.size()).first;
+    if (it->second == string_pool.size()) {
+      string_pool.push_back(&it->first);
     }
-    return string_ids.at(s);
+    return it->second;
+  };
+  auto append = [](std::string& out, uint32_t value) {
+    out.append((const char*)&value, sizeof(value));
   };
 
-  for (auto pos : m_positions) {
+  for (size_t i = 0; i < m_positions.size(); ++i) {
+    auto pos = m_positions[i];
     uint32_t parent_line = 0;
     try {
       parent_line = pos->parent == nullptr ? 0 : get_line(pos->parent);
@@ -113,51 +153,53 @@ void RealPositionMapper::write_map_v2() {
       std::cerr << "Parent position " << show(pos->parent) << " of "
                 << show(pos) << " was not registered" << std::endl;
     }
-    // of the form "class_name.method_name:(arg_types)return_type"
-    const auto& full_method_name = pos->method->str();
-    // strip out the args and return type
-    auto qualified_method_name =
-        full_method_name.substr(0, full_method_name.find(':'));
-    auto class_name = java_names::internal_to_external(
-        qualified_method_name.substr(0, qualified_method_name.rfind('.')));
-    auto method_name =
-        qualified_method_name.substr(qualified_method_name.rfind('.') + 1);
-    auto class_id = id_of_string(class_name);
-    auto method_id = id_of_string(method_name);
-    auto file_id = id_of_string(pos->file->c_str());
-    pos_out.write((const char*)&class_id, sizeof(class_id));
-    pos_out.write((const char*)&method_id, sizeof(method_id));
-    pos_out.write((const char*)&file_id, sizeof(file_id));
-    pos_out.write((const char*)&pos->line, sizeof(pos->line));
-    pos_out.write((const char*)&parent_line, sizeof(parent_line));
+    append(pos_out, id_of_string(names[i].class_name));
+    append(pos_out, id_of_string(names[i].method_name));
+    append(pos_out, id_of_string(pos->file->str()));
+    append(pos_out, pos->line);
+    append(pos_out, parent_line);
+  }
+
+  std::string payload;
+  append(payload, string_pool.size());
+  for (const auto* s : string_pool) {
+    append(payload, s->size());
+    payload += *s;
   }
+  append(payload, m_positions.size());
 
   std::ofstream ofs(m_filename_v2.c_str(),
                     std::ofstream::out | std::ofstream::trunc);
   uint32_t magic = 0xfaceb000; // serves as endianess check
   ofs.write((const char*)&magic, sizeof(magic));
-  uint32_t version = 2;
+  uint32_t version = m_compress ? 3 : 2;
   ofs.write((const char*)&version, sizeof(version));
-  uint32_t spool_count = string_pool.size();
-  ofs.write((const char*)&spool_count, sizeof(spool_count));
-  for (const auto& s : string_pool) {
-    uint32_t ssize = s.size();
-    ofs.write((const char*)&ssize, sizeof(ssize));
-    ofs << s;
+  if (!m_compress) {
+    ofs << payload << pos_out;
+    return;
   }
-  uint32_t pos_count = m_positions.size();
-  ofs.write((const char*)&pos_count, sizeof(pos_count));
-  ofs << pos_out.str();
+  payload += pos_out;
+  std::string().swap(pos_out);
+  uint64_t payload_size = payload.size();
+  uLongf compressed_size = compressBound(payload_size);
+  std::unique_ptr<Bytef[]> compressed(new Bytef[compressed_size]);
+  auto res = compress(compressed.get(), &compressed_size,
+                      (const Bytef*)payload.data(), payload_size);
+  always_assert_log(res == Z_OK, "Failed to compress line number map: %d",
+                    res);
+  ofs.write((const char*)&payload_size, sizeof(payload_size));
+  ofs.write((const char*)compressed.get(), compressed_size);
 }
 
-PositionMapper* PositionMapper::make(const std::string& map_filename_v2) {
+PositionMapper* PositionMapper::make(const std::string& map_filename_v2,
+                                     bool compress) {
   if (map_filename_v2.empty()) {
     // If no path is provided for the map, just pass the original line numbers
     // through to the output. This does mean that the line numbers will be
     // incorrect for inlined code.
     return new NoopPositionMapper();
   } else {
-    return new RealPositionMapper(map_filename_v2);
+    return new RealPositionMapper(map_filename_v2, compress);
   }
 }
 
@@ -43,7 +43,8 @@ class PositionMapper {
   virtual uint32_t position_to_line(DexPosition*) = 0;
   virtual void register_position(DexPosition* pos) = 0;
   virtual void write_map() = 0;
-  static PositionMapper* make(const std::string& map_filename_v2);
+  static PositionMapper* make(const std::string& map_filename_v2,
+                              bool compress = false);
 };
 
 /*
@@ -55,6 +56,8 @@ class PositionMapper {
  */
 class RealPositionMapper : public PositionMapper {
   std::string m_filename_v2;
+  // Write the map zlib-compressed, as version 3 of the format.
+  bool m_compress;
   std::vector<DexPosition*> m_positions;
   std::unordered_map<DexPosition*, int64_t> m_pos_line_map;
 
@@ -63,8 +66,9 @@ class RealPositionMapper : public PositionMapper {
   void write_map_v2();
 
  public:
-  explicit RealPositionMapper(const std::string& filename_v2)
-      : m_filename_v2(filename_v2) {}
+  explicit RealPositionMapper(const std::string& filename_v2,
+                              bool compress = false)
+      : m_filename_v2(filename_v2), m_compress(compress) {}
   DexString* get_source_file(const DexClass*) override;
   uint32_t position_to_line(DexPosition*) override;
   void register_position(DexPosition* pos) override;
@@ -78,10 +78,12 @@ void GlobalConfig::bind_config() {
   bind("bytecode_sort_mode", {}, string_vector_param);
   bind("legacy_profiled_code_item_sort_order", true, bool_param);
   bind("coldstart_classes", "", string_param);
+  bind("compress_line_number_map", false, bool_param);
   bind("compute_xml_reachability", false, bool_param);
   bind("unused_keep_rule_abort", false, bool_param);
   bind("debug_info_kind", "", string_param);
   bind("default_coldstart_classes", "", string_param);
+  bind("dex_output_cache_file", "", string_param);
   bind("emit_class_method_info_map", false, bool_param);
   bind("emit_locator_strings", {}, bool_param);
   bind("force_single_dex", false, bool_param);
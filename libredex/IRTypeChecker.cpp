@@ -618,13 +618,53 @@ void validate_access(const DexMethod* accessor, const DexMember* accessee) {
   throw TypeCheckingException(out.str());
 }
 
+template <typename Map, typename Key, typename Fn>
+auto memoize(Map* map, const Key& key, const Fn& fn) -> decltype(fn()) {
+  auto cached = map->get(key, boost::none);
+  if (cached) {
+    return *cached;
+  }
+  // Racing threads compute the same value.
+  auto value = fn();
+  map->emplace(key, value);
+  return value;
+}
+
 } // namespace
 
+bool IRTypeCheckerCache::is_assignable_from(const DexType* from,
+                                            const DexType* to,
+                                            bool strict) {
+  return memoize(&m_assignable[strict], std::make_pair(from, to), [&]() {
+    return check_is_assignable_from(from, to, strict);
+  });
+}
+
+DexMethod* IRTypeCheckerCache::resolve_method(DexMethodRef* method,
+                                              MethodSearch search,
+                                              const DexMethod* caller) {
+  if (search != MethodSearch::Super) {
+    caller = nullptr;
+  }
+  return memoize(&m_methods,
+                 std::make_tuple(method, static_cast<int>(search), caller),
+                 [&]() { return ::resolve_method(method, search, caller); });
+}
+
+DexField* IRTypeCheckerCache::resolve_field(DexFieldRef* field,
+                                            FieldSearch search) {
+  return memoize(&m_fields, std::make_pair(field, static_cast<int>(search)),
+                 [&]() { return ::resolve_field(field, search); });
+}
+
 IRTypeChecker::~IRTypeChecker() {}
 
-IRTypeChecker::IRTypeChecker(DexMethod* dex_method, bool validate_access)
+IRTypeChecker::IRTypeChecker(DexMethod* dex_method,
+                             bool validate_access,
+                             IRTypeCheckerCache* cache)
     : m_dex_method(dex_method),
       m_validate_access(validate_access),
+      m_cache(cache),
       m_complete(false),
       m_verify_moves(false),
       m_check_no_overwrite_this(false),
@@ -667,7 +707,11 @@ void IRTypeChecker::run() {
   }
 
   m_type_inference = std::make_unique<TypeInference>(cfg);
-  m_type_inference->run(m_dex_method);
+  // Straight-line code, and more generally code without merge points, doesn't
+  // need the full fixpoint iteration.
+  if (!m_type_inference->run_without_merges(m_dex_method)) {
+    m_type_inference->run(m_dex_method);
+  }
 
   // Finally, we use the inferred types to type-check each instruction in the
   // method. We stop at the first type error encountered.
@@ -726,13 +770,22 @@ void IRTypeChecker::assume_assignable(boost::optional<const DexType*> from,
   // we no longer know anything about the type of the reference. It's
   // in such a case as that that we have to bail out here when the from
   // optional is empty.
-  if (from && !check_is_assignable_from(*from, to, false)) {
+  if (from && !is_assignable_from(*from, to)) {
     std::ostringstream out;
     out << ": " << *from << " is not assignable to " << to << std::endl;
     throw TypeCheckingException(out.str());
   }
 }
 
+bool IRTypeChecker::is_assignable_from(const DexType* from,
+                                       const DexType* to) const {
+  // The trivial cases are cheaper to check than to look up.
+  if (m_cache == nullptr || from == to || to == type::java_lang_Object()) {
+    return check_is_assignable_from(from, to, /* strict */ false);
+  }
+  return m_cache->is_assignable_from(from, to, /* strict */ false);
+}
+
 // This method performs type checking only: the type environment is not updated
 // and the source registers of the instruction are checked against their
 // expected types.
@@ -805,7 +858,7 @@ void IRTypeChecker::check_instruction(IRInstruction* insn,
     if (dtype && !is_inference_fallback_type(*dtype)) {
       // Return type checking is non-strict: it is allowed to return any
       // reference type when `rtype` is an interface.
-      if (!check_is_assignable_from(*dtype, rtype, /*strict=*/false)) {
+      if (!is_assignable_from(*dtype, rtype)) {
         std::ostringstream out;
         out << "Returning " << dtype << ", but expected from declaration "
             << rtype << std::endl;
@@ -1107,8 +1160,10 @@ void IRTypeChecker::check_instruction(IRInstruction* insn,
       assume_double(current_state, insn->src(src_idx++));
     }
     if (m_validate_access) {
+      auto search = opcode_to_search(insn);
       auto resolved =
-          resolve_method(dex_method, opcode_to_search(insn), m_dex_method);
+          m_cache ? m_cache->resolve_method(dex_method, search, m_dex_method)
+                  : resolve_method(dex_method, search, m_dex_method);
       validate_access(m_dex_method, resolved);
     }
     break;
@@ -1275,7 +1330,8 @@ void IRTypeChecker::check_instruction(IRInstruction* insn,
     auto search = opcode::is_an_sfield_op(insn->opcode())
                       ? FieldSearch::Static
                       : FieldSearch::Instance;
-    auto resolved = resolve_field(insn->get_field(), search);
+    auto resolved = m_cache ? m_cache->resolve_field(insn->get_field(), search)
+                            : resolve_field(insn->get_field(), search);
     validate_access(m_dex_method, resolved);
   }
 }
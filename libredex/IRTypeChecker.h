@@ -7,8 +7,45 @@
 
 #pragma once
 
+#include <boost/functional/hash.hpp>
+#include <boost/optional/optional.hpp>
+#include <tuple>
+
+#include "ConcurrentContainers.h"
+#include "Resolver.h"
 #include "TypeInference.h"
 
+/*
+ * Memoizes the queries of the type checker that only depend on the class
+ * hierarchy: the assignability of reference types, and field and method
+ * resolution. The cache is thread-safe, so that all the checkers of a
+ * verification run over a scope can share it; it must not be used across
+ * changes to the class hierarchy.
+ */
+class IRTypeCheckerCache final {
+ public:
+  bool is_assignable_from(const DexType* from, const DexType* to, bool strict);
+
+  DexMethod* resolve_method(DexMethodRef* method,
+                            MethodSearch search,
+                            const DexMethod* caller);
+
+  DexField* resolve_field(DexFieldRef* field, FieldSearch search);
+
+ private:
+  using TypePair = std::pair<const DexType*, const DexType*>;
+  // The caller only matters for MethodSearch::Super.
+  using MethodKey = std::tuple<const DexMethodRef*, int, const DexMethod*>;
+  using FieldKey = std::pair<const DexFieldRef*, int>;
+
+  ConcurrentMap<TypePair, boost::optional<bool>, boost::hash<TypePair>>
+      m_assignable[2];
+  ConcurrentMap<MethodKey, boost::optional<DexMethod*>, boost::hash<MethodKey>>
+      m_methods;
+  ConcurrentMap<FieldKey, boost::optional<DexField*>, boost::hash<FieldKey>>
+      m_fields;
+};
+
 /*
  * This class takes a method, infers the type of all registers and checks that
  * all operations are well typed. The inferred types are available via the
@@ -32,7 +69,12 @@ class IRTypeChecker final {
   // definition must be located after the definition of TypeInference.
   ~IRTypeChecker();
 
-  explicit IRTypeChecker(DexMethod* dex_method, bool validate_access = false);
+  /*
+   * The optional cache is shared with other checkers; see IRTypeCheckerCache.
+   */
+  explicit IRTypeChecker(DexMethod* dex_method,
+                         bool validate_access = false,
+                         IRTypeCheckerCache* cache = nullptr);
 
   IRTypeChecker(const IRTypeChecker&) = delete;
 
@@ -122,11 +164,13 @@ class IRTypeChecker final {
                         bool in_move = false) const;
   void assume_assignable(boost::optional<const DexType*> from,
                          DexType* to) const;
+  bool is_assignable_from(const DexType* from, const DexType* to) const;
   void check_instruction(IRInstruction* insn,
                          TypeEnvironment* current_state) const;
 
   DexMethod* m_dex_method;
   const bool m_validate_access;
+  IRTypeCheckerCache* m_cache;
   bool m_complete;
   bool m_verify_moves;
   bool m_check_no_overwrite_this;
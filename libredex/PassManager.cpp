@@ -213,8 +213,11 @@ struct CheckerConfig {
     Timer t("IRTypeChecker");
     std::atomic<size_t> errors{0};
     boost::optional<std::string> first_error_msg;
+    // The class hierarchy doesn't change while verifying, so all checkers can
+    // share the resolution of types and members.
+    IRTypeCheckerCache cache;
     walk::parallel::methods(scope, [&](DexMethod* dex_method) {
-      IRTypeChecker checker(dex_method, validate_access);
+      IRTypeChecker checker(dex_method, validate_access, &cache);
       if (verify_moves) {
         checker.verify_moves();
       }
@@ -7,11 +7,17 @@
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <boost/optional.hpp>
 #include <chrono>
 #include <condition_variable>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
 #include <mutex>
-#include <queue>
 #include <thread>
 #include <vector>
 
@@ -25,20 +31,65 @@
  * - Priorities are signed integers, allowing flexibility for negative
  *   priorities.
  *
+ * Every thread owns a queue of pending work items. Work items posted from
+ * within a work item go to the queue of the posting thread; other work items
+ * are distributed round-robin. A thread runs the highest priority work item of
+ * its own queue, and when that is empty, steals the highest priority work item
+ * from another thread's queue. Thus priorities are respected per queue, and
+ * threads only contend when they share a queue.
+ *
+ * Work items can be made to wait for a number of dependencies, see
+ * `DependentWorkItem`, and a batch of fine-grained work can be spread over the
+ * pool with `parallel_for`, even from within a running work item.
+ *
  * The thread-pool must be initialized with a positive number of threads to be
  * functional.
  */
 class PriorityThreadPool {
+ public:
+  /*
+   * A work item that gets posted once `signal` has been called for it as many
+   * times as it has dependencies.
+   */
+  class DependentWorkItem {
+   public:
+    DependentWorkItem(size_t dependencies,
+                      int priority,
+                      std::function<void()> f)
+        : m_dependencies(dependencies), m_priority(priority), m_f(std::move(f)) {
+      always_assert(dependencies > 0);
+    }
+
+    size_t get_dependencies() const { return m_dependencies.load(); }
+
+   private:
+    friend class PriorityThreadPool;
+    std::atomic<size_t> m_dependencies;
+    int m_priority;
+    std::function<void()> m_f;
+  };
+
  private:
+  struct Queue {
+    std::mutex mutex;
+    std::map<int, std::deque<std::function<void()>>> items;
+  };
+
   std::vector<std::thread> m_pool;
-  // The following data structures are guarded by this mutex.
+  std::vector<std::unique_ptr<Queue>> m_queues;
+  std::atomic<size_t> m_next_queue{0};
+  // Number of work items that have been posted, but not yet taken by a thread.
+  std::atomic<size_t> m_pending_work_items{0};
+  // Number of work items that have been posted, but not yet finished.
+  std::atomic<size_t> m_unfinished_work_items{0};
+  std::atomic<size_t> m_sleeping_threads{0};
+  std::atomic<size_t> m_stolen_work_items{0};
+  std::atomic<bool> m_shutdown{false};
+  // This mutex is only taken to put threads to sleep and to wake them up.
   std::mutex m_mutex;
   std::condition_variable m_work_condition;
   std::condition_variable m_done_condition;
-  std::map<int, std::queue<std::function<void()>>> m_pending_work_items;
-  size_t m_running_work_items{0};
   std::chrono::duration<double> m_waited_time{0};
-  bool m_shutdown{false};
 
  public:
   // Creates an instance with a default number of threads
@@ -52,10 +103,10 @@ class PriorityThreadPool {
   ~PriorityThreadPool() {
     // If the pool was created (>0 threads), `join` must be manually called
     // before the executor may be destroyed.
-    always_assert(m_pending_work_items.empty());
+    always_assert(m_pending_work_items == 0);
     if (!m_pool.empty()) {
       always_assert(m_shutdown);
-      always_assert(m_running_work_items == 0);
+      always_assert(m_unfinished_work_items == 0);
     }
   }
 
@@ -64,15 +115,23 @@ class PriorityThreadPool {
         .count();
   }
 
+  // Number of work items that a thread took from another thread's queue.
+  size_t get_stolen_work_items() const { return m_stolen_work_items; }
+
+  size_t get_num_threads() const { return m_pool.size(); }
+
   // The number of threads may be set at most once to a positive number
   void set_num_threads(int num_threads) {
     always_assert(m_pool.empty());
     always_assert(!m_shutdown);
     if (num_threads > 0) {
+      for (size_t i = 0; i != (size_t)num_threads; ++i) {
+        m_queues.emplace_back(new Queue());
+      }
       // std::thread cannot be copied, so need to do this in a loop instead of
       // `resize`.
       for (size_t i = 0; i != (size_t)num_threads; ++i) {
-        m_pool.emplace_back(&PriorityThreadPool::run, this);
+        m_pool.emplace_back(&PriorityThreadPool::run, this, i);
       }
     }
   }
@@ -80,10 +139,72 @@ class PriorityThreadPool {
   // Post a work item with a priority. This method is thread safe.
   void post(int priority, const std::function<void()>& f) {
     always_assert(!m_pool.empty());
-    std::unique_lock<std::mutex> lock{m_mutex};
     always_assert(!m_shutdown);
-    m_pending_work_items[priority].push(f);
-    m_work_condition.notify_one();
+    auto& worker = current_worker();
+    size_t index = worker.first == this
+                       ? worker.second
+                       : m_next_queue.fetch_add(1) % m_queues.size();
+    m_unfinished_work_items.fetch_add(1);
+    m_pending_work_items.fetch_add(1);
+    {
+      auto& queue = *m_queues[index];
+      std::lock_guard<std::mutex> lock{queue.mutex};
+      queue.items[priority].push_back(f);
+    }
+    if (m_sleeping_threads.load() > 0) {
+      std::lock_guard<std::mutex> lock{m_mutex};
+      m_work_condition.notify_one();
+    }
+  }
+
+  // Record that one dependency of the given work item is done. When it was
+  // the last one, the work item gets posted, and true is returned. This method
+  // is thread safe.
+  bool signal(DependentWorkItem* item) {
+    if (item->m_dependencies.fetch_sub(1) != 1) {
+      return false;
+    }
+    post(item->m_priority, item->m_f);
+    return true;
+  }
+
+  // Run `f(i)` for all `i` in `[0, n)`, using the threads of this pool, and
+  // return when all are done. The calling thread takes part in the work, so
+  // this may also be invoked from within a work item. Without threads, this
+  // simply runs sequentially.
+  template <class Fn>
+  void parallel_for(size_t n, const Fn& f) {
+    if (m_pool.empty() || m_shutdown || n <= 1) {
+      for (size_t i = 0; i < n; i++) {
+        f(i);
+      }
+      return;
+    }
+    struct Batch {
+      std::atomic<size_t> next{0};
+      std::atomic<size_t> done{0};
+      std::mutex mutex;
+      std::condition_variable done_condition;
+    };
+    auto batch = std::make_shared<Batch>();
+    auto drain = [batch, n, &f]() {
+      for (size_t i; (i = batch->next.fetch_add(1)) < n;) {
+        f(i);
+        if (batch->done.fetch_add(1) + 1 == n) {
+          std::lock_guard<std::mutex> lock{batch->mutex};
+          batch->done_condition.notify_all();
+        }
+      }
+    };
+    // Helpers that only get to run after all indices have been claimed return
+    // right away, without touching `f`.
+    auto helpers = std::min(n - 1, m_pool.size());
+    for (size_t i = 0; i < helpers; i++) {
+      post(std::numeric_limits<int>::max(), drain);
+    }
+    drain();
+    std::unique_lock<std::mutex> lock{batch->mutex};
+    batch->done_condition.wait(lock, [&]() { return batch->done == n; });
   }
 
   // Wait for all work items to be processed.
@@ -93,9 +214,8 @@ class PriorityThreadPool {
     {
       // We wait until *all* work is done, i.e. nothing is running or pending.
       std::unique_lock<std::mutex> lock{m_mutex};
-      m_done_condition.wait(lock, [&]() {
-        return m_running_work_items == 0 && m_pending_work_items.empty();
-      });
+      m_done_condition.wait(lock,
+                            [&]() { return m_unfinished_work_items == 0; });
       if (init_shutdown) {
         m_shutdown = true;
         m_work_condition.notify_all();
@@ -120,50 +240,72 @@ class PriorityThreadPool {
   }
 
  private:
-  void run() {
+  // The pool and queue index of the current thread, if it is a pool thread.
+  static std::pair<const PriorityThreadPool*, size_t>& current_worker() {
+    static thread_local std::pair<const PriorityThreadPool*, size_t> worker{
+        nullptr, 0};
+    return worker;
+  }
+
+  boost::optional<std::function<void()>> take(Queue& queue) {
+    std::lock_guard<std::mutex> lock{queue.mutex};
+    if (queue.items.empty()) {
+      return boost::none;
+    }
+    // Find work item with highest priority
+    auto it = std::prev(queue.items.end());
+    auto f = std::move(it->second.front());
+    it->second.pop_front();
+    if (it->second.empty()) {
+      queue.items.erase(it);
+    }
+    m_pending_work_items.fetch_sub(1);
+    return f;
+  }
+
+  boost::optional<std::function<void()>> take_or_steal(size_t index) {
+    auto f = take(*m_queues[index]);
+    for (size_t i = 1; !f && i < m_queues.size(); i++) {
+      f = take(*m_queues[(index + i) % m_queues.size()]);
+      if (f) {
+        m_stolen_work_items.fetch_add(1);
+      }
+    }
+    return f;
+  }
+
+  void run(size_t index) {
+    current_worker() = std::make_pair(this, index);
     for (;;) {
-      auto highest_priority_f =
-          [&]() -> boost::optional<std::function<void()>> {
+      auto f = take_or_steal(index);
+      if (!f) {
+        // Wait for work or shutdown. A work item posted concurrently either
+        // sees this thread as sleeping and notifies, or is seen as pending.
         std::unique_lock<std::mutex> lock{m_mutex};
-        // Wait for work or shutdown.
+        m_sleeping_threads.fetch_add(1);
         m_work_condition.wait(lock, [&]() {
-          return !m_pending_work_items.empty() || m_shutdown;
+          return m_pending_work_items.load() > 0 || m_shutdown;
         });
-        if (m_pending_work_items.empty()) {
+        m_sleeping_threads.fetch_sub(1);
+        if (m_pending_work_items.load() == 0) {
           redex_assert(m_shutdown);
-          return boost::none;
+          return;
         }
-
-        // Find work item with highest priority
-        auto& p = *m_pending_work_items.rbegin();
-        auto& queue = p.second;
-        auto f = queue.front();
-        queue.pop();
-        if (queue.empty()) {
-          auto highest_priority = p.first;
-          m_pending_work_items.erase(highest_priority);
-        }
-        m_running_work_items++;
-        return f;
-      }();
-      if (!highest_priority_f) {
-        return;
+        continue;
       }
 
       // Run!
       try {
-        (*highest_priority_f)();
+        (*f)();
       } catch (std::exception& e) {
         redex_workqueue_impl::redex_queue_exception_handler(e);
         throw;
       }
 
       // Notify when *all* work is done, i.e. nothing is running or pending.
-      {
-        std::unique_lock<std::mutex> lock{m_mutex};
-        if (--m_running_work_items == 0 && m_pending_work_items.empty()) {
-          m_done_condition.notify_one();
-        }
+      if (m_unfinished_work_items.fetch_sub(1) == 1) {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_done_condition.notify_all();
       }
     }
   }
@@ -8,6 +8,7 @@
 #include <algorithm>
 #include <boost/regex.hpp>
 #include <iostream>
+#include <map>
 #include <mutex>
 #include <sstream>
 #include <thread>
@@ -34,12 +35,36 @@ namespace {
 
 using RegexMap = std::unordered_map<std::string, boost::regex>;
 
-std::unique_ptr<boost::regex> make_rx(const std::string& s,
-                                      bool convert = true) {
+/**
+ * Matches deobfuscated type names against a type pattern. Patterns that only
+ * use simple wildcards are matched without boost::regex.
+ */
+class TypeMatcher {
+ public:
+  explicit TypeMatcher(const std::string& pattern)
+      : m_wildcard(proguard_parser::TypeWildcardMatcher::compile(pattern)) {
+    if (!m_wildcard) {
+      m_regex = boost::regex(proguard_parser::form_type_regex(pattern));
+    }
+  }
+
+  bool match(const std::string& name) const {
+    if (m_wildcard) {
+      return m_wildcard->match(name);
+    }
+    return boost::regex_match(name, m_regex);
+  }
+
+ private:
+  boost::optional<proguard_parser::TypeWildcardMatcher> m_wildcard;
+  boost::regex m_regex;
+};
+
+std::unique_ptr<TypeMatcher> make_rx(const std::string& s,
+                                     bool convert = true) {
   if (s.empty()) return nullptr;
   auto wc = convert ? proguard_parser::convert_wildcard_type(s) : s;
-  auto rx = proguard_parser::form_type_regex(wc);
-  return std::make_unique<boost::regex>(rx);
+  return std::make_unique<TypeMatcher>(wc);
 }
 
 std::string get_deobfuscated_name(const DexType* type) {
@@ -50,11 +75,11 @@ std::string get_deobfuscated_name(const DexType* type) {
   return cls->get_deobfuscated_name();
 }
 
-bool match_annotation_rx(const DexClass* cls, const boost::regex& annorx) {
+bool match_annotation_rx(const DexClass* cls, const TypeMatcher& annorx) {
   const auto* annos = cls->get_anno_set();
   if (!annos) return false;
   for (const auto& anno : annos->get_annotations()) {
-    if (boost::regex_match(get_deobfuscated_name(anno->type()), annorx)) {
+    if (annorx.match(get_deobfuscated_name(anno->type()))) {
       return true;
     }
   }
@@ -97,7 +122,7 @@ struct ClassMatcher {
  private:
   bool match_name(const DexClass* cls) const {
     const auto& deob_name = cls->get_deobfuscated_name();
-    return boost::regex_match(deob_name, *m_cls);
+    return m_cls->match(deob_name);
   }
 
   bool match_access(const DexClass* cls) const {
@@ -124,7 +149,7 @@ struct ClassMatcher {
       }
     }
     const auto& deob_name = cls->get_deobfuscated_name();
-    return boost::regex_match(deob_name, *m_extends);
+    return m_extends->match(deob_name);
   }
 
   bool search_interfaces(const DexClass* cls) {
@@ -172,10 +197,10 @@ struct ClassMatcher {
   DexAccessFlags setFlags_;
   DexAccessFlags unsetFlags_;
   std::string m_class_name;
-  std::unique_ptr<boost::regex> m_cls;
-  std::unique_ptr<boost::regex> m_anno;
-  std::unique_ptr<boost::regex> m_extends;
-  std::unique_ptr<boost::regex> m_extends_anno;
+  std::unique_ptr<TypeMatcher> m_cls;
+  std::unique_ptr<TypeMatcher> m_anno;
+  std::unique_ptr<TypeMatcher> m_extends;
+  std::unique_ptr<TypeMatcher> m_extends_anno;
 
   std::unordered_map<const DexClass*, bool> m_extends_result_cache;
 };
@@ -322,6 +347,52 @@ class KeepRuleMatcher {
   std::unordered_set<std::string> m_already_warned;
 };
 
+/*
+ * A trie of the literal prefixes of class name patterns. Looking up a class
+ * name yields the rules whose prefix the name starts with, which are the only
+ * rules that can possibly match the class.
+ */
+class RulePrefixTrie {
+ public:
+  void insert(const std::string& prefix, size_t rule) {
+    size_t node = 0;
+    for (char ch : prefix) {
+      auto it = m_nodes[node].children.find(ch);
+      if (it == m_nodes[node].children.end()) {
+        it = m_nodes[node].children.emplace(ch, m_nodes.size()).first;
+        m_nodes.emplace_back();
+      }
+      node = it->second;
+    }
+    m_nodes[node].rules.push_back(rule);
+  }
+
+  template <class Fn>
+  void for_each_match(const std::string& name, const Fn& fn) const {
+    size_t node = 0;
+    for (size_t i = 0;; i++) {
+      for (auto rule : m_nodes[node].rules) {
+        fn(rule);
+      }
+      if (i == name.size()) {
+        return;
+      }
+      auto it = m_nodes[node].children.find(name[i]);
+      if (it == m_nodes[node].children.end()) {
+        return;
+      }
+      node = it->second;
+    }
+  }
+
+ private:
+  struct Node {
+    std::map<char, size_t> children;
+    std::vector<size_t> rules;
+  };
+  std::vector<Node> m_nodes{1};
+};
+
 class ProguardMatcher {
  public:
   ProguardMatcher(const ProguardMap& pg_map,
@@ -450,6 +521,19 @@ std::string extract_method_name_and_type(
   return qualified_fieldname.substr(p + 2);
 }
 
+// A member name without wildcards can be compared directly against the name
+// part of "name:descriptor", which rules out most members without running the
+// regex.
+bool member_name_may_match(const std::string& spec_name,
+                           const std::string& dequalified_name) {
+  if (spec_name.empty() || proguard_parser::has_special_char(spec_name)) {
+    return true;
+  }
+  return dequalified_name.size() > spec_name.size() &&
+         dequalified_name[spec_name.size()] == ':' &&
+         dequalified_name.compare(0, spec_name.size(), spec_name) == 0;
+}
+
 bool KeepRuleMatcher::field_level_match(
     const MemberSpecification& fieldSpecification,
     const DexField* field,
@@ -468,6 +552,9 @@ bool KeepRuleMatcher::field_level_match(
   }
   // Match field name against regex.
   auto dequalified_name = extract_field_name(field->get_deobfuscated_name());
+  if (!member_name_may_match(fieldSpecification.name, dequalified_name)) {
+    return false;
+  }
   return boost::regex_match(dequalified_name, fieldname_regex);
 }
 
@@ -520,6 +607,9 @@ bool KeepRuleMatcher::method_level_match(
   }
   auto dequalified_name =
       extract_method_name_and_type(method->get_deobfuscated_name());
+  if (!member_name_may_match(methodSpecification.name, dequalified_name)) {
+    return false;
+  }
   return boost::regex_match(dequalified_name.c_str(), method_regex);
 }
 
@@ -782,25 +872,9 @@ void ProguardMatcher::process_keep(const KeepSpecSet& keep_rules,
     }
   };
 
-  // We only parallelize if keep_rule needs to be applied to all classes.
-  auto wq = workqueue_foreach<const KeepSpec*>([&](const KeepSpec* keep_rule) {
-    RegexMap regex_map;
-    ClassMatcher class_match(*keep_rule);
-    KeepRuleMatcher rule_matcher(rule_type, *keep_rule, regex_map);
-
-    for (const auto& cls : m_classes) {
-      process_single_keep(class_match, rule_matcher, cls);
-    }
-    if (process_external) {
-      for (const auto& cls : m_external_classes) {
-        process_single_keep(class_match, rule_matcher, cls);
-      }
-    }
-
-    if (rule_matcher.is_unused()) {
-      m_unused_rules.insert(keep_rule);
-    }
-  });
+  // Rules that need to be applied to all classes are collected here and
+  // processed in parallel below.
+  std::vector<const KeepSpec*> slow_rules;
 
   RegexMap regex_map;
   for (const auto& keep_rule_ptr : keep_rules) {
@@ -839,10 +913,68 @@ void ProguardMatcher::process_keep(const KeepSpecSet& keep_rules,
     }
 
     TRACE(PGR, 2, "Slow rule: %s", show_keep(keep_rule).c_str());
-    // Otherwise, it might take a longer time. Add to the work queue.
-    wq.add_item(&keep_rule);
+    slow_rules.push_back(&keep_rule);
+  }
+
+  // Index the remaining rules by the literal prefix of their class name
+  // pattern, so that each class is only tested against the rules that can
+  // possibly match it. Rules without a meaningful prefix (e.g. `**`) are
+  // tested against all classes.
+  RulePrefixTrie trie;
+  std::vector<bool> match_all(slow_rules.size(), false);
+  for (size_t i = 0; i < slow_rules.size(); i++) {
+    auto prefix = proguard_parser::get_literal_type_prefix(
+        proguard_parser::convert_wildcard_type(
+            slow_rules[i]->class_spec.className));
+    if (prefix.size() <= 1) {
+      match_all[i] = true;
+    } else {
+      trie.insert(prefix, i);
+    }
+  }
+  std::vector<std::vector<DexClass*>> candidates(slow_rules.size());
+  auto index_classes = [&](const Scope& scope) {
+    for (const auto& cls : scope) {
+      trie.for_each_match(cls->get_deobfuscated_name(),
+                          [&](size_t i) { candidates[i].push_back(cls); });
+    }
+  };
+  index_classes(m_classes);
+  if (process_external) {
+    index_classes(m_external_classes);
   }
+  TRACE(PGR, 2, "%zu slow rules, %zu of them without class name prefix",
+        slow_rules.size(),
+        std::count(match_all.begin(), match_all.end(), true));
 
+  auto wq = workqueue_foreach<size_t>([&](size_t i) {
+    const KeepSpec* keep_rule = slow_rules[i];
+    RegexMap regex_map;
+    ClassMatcher class_match(*keep_rule);
+    KeepRuleMatcher rule_matcher(rule_type, *keep_rule, regex_map);
+
+    if (match_all[i]) {
+      for (const auto& cls : m_classes) {
+        process_single_keep(class_match, rule_matcher, cls);
+      }
+      if (process_external) {
+        for (const auto& cls : m_external_classes) {
+          process_single_keep(class_match, rule_matcher, cls);
+        }
+      }
+    } else {
+      for (const auto& cls : candidates[i]) {
+        process_single_keep(class_match, rule_matcher, cls);
+      }
+    }
+
+    if (rule_matcher.is_unused()) {
+      m_unused_rules.insert(keep_rule);
+    }
+  });
+  for (size_t i = 0; i < slow_rules.size(); i++) {
+    wq.add_item(i);
+  }
   wq.run_all();
 }
 
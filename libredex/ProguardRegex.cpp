@@ -132,6 +132,127 @@ std::string form_type_regex(const std::string& proguard_regex) {
   return r;
 }
 
+std::string get_literal_type_prefix(const std::string& proguard_regex) {
+  const std::string& regex =
+      proguard_regex == "L*;" ? L_STAR_REGEX : proguard_regex;
+  if (regex.find('|') != std::string::npos) {
+    return "";
+  }
+  // Characters that form_type_regex either converts into wildcards or passes
+  // through as regex syntax.
+  auto pos = regex.find_first_of("*?%.]{}\\+^");
+  if (pos == std::string::npos) {
+    return regex;
+  }
+  // Quantifiers make the preceding character optional.
+  if ((regex[pos] == '{' || regex[pos] == '+') && pos > 0) {
+    pos--;
+  }
+  return regex.substr(0, pos);
+}
+
+boost::optional<TypeWildcardMatcher> TypeWildcardMatcher::compile(
+    const std::string& proguard_regex) {
+  const std::string& regex =
+      proguard_regex == "L*;" ? L_STAR_REGEX : proguard_regex;
+  TypeWildcardMatcher matcher;
+  for (size_t i = 0; i < regex.size(); i++) {
+    const char ch = regex[i];
+    switch (ch) {
+    case '*': {
+      size_t stars = 1;
+      while (i + 1 < regex.size() && regex[i + 1] == '*') {
+        stars++;
+        i++;
+      }
+      if (stars > 2) {
+        return boost::none;
+      }
+      matcher.m_tokens.push_back(
+          {stars == 1 ? Kind::STAR : Kind::DOUBLE_STAR, 0});
+      break;
+    }
+    case '?':
+      matcher.m_tokens.push_back({Kind::ANY, 0});
+      break;
+    case '%':
+    case '.':
+    case ']':
+    case '{':
+    case '}':
+    case '\\':
+    case '+':
+    case '|':
+    case '^':
+      return boost::none;
+    default:
+      matcher.m_tokens.push_back({Kind::LITERAL, ch});
+      if (matcher.m_tokens.size() == matcher.m_literal_prefix.size() + 1) {
+        matcher.m_literal_prefix += ch;
+      }
+      break;
+    }
+  }
+  // One bit per position in the token sequence, including the final one.
+  if (matcher.m_tokens.size() >= 64) {
+    return boost::none;
+  }
+  return matcher;
+}
+
+uint64_t TypeWildcardMatcher::closure(uint64_t states) const {
+  // Wildcards may match the empty string.
+  for (size_t i = 0; i < m_tokens.size(); i++) {
+    if (((states >> i) & 1) && (m_tokens[i].kind == Kind::STAR ||
+                                m_tokens[i].kind == Kind::DOUBLE_STAR)) {
+      states |= uint64_t(1) << (i + 1);
+    }
+  }
+  return states;
+}
+
+bool TypeWildcardMatcher::match(const std::string& s) const {
+  if (s.compare(0, m_literal_prefix.size(), m_literal_prefix) != 0) {
+    return false;
+  }
+  uint64_t states = closure(uint64_t(1) << m_literal_prefix.size());
+  for (size_t j = m_literal_prefix.size(); j < s.size() && states != 0; j++) {
+    const char c = s[j];
+    uint64_t next = 0;
+    for (uint64_t rest = states; rest != 0; rest &= rest - 1) {
+      size_t i = __builtin_ctzll(rest);
+      if (i == m_tokens.size()) {
+        continue;
+      }
+      const auto& token = m_tokens[i];
+      switch (token.kind) {
+      case Kind::LITERAL:
+        if (c == token.ch) {
+          next |= uint64_t(1) << (i + 1);
+        }
+        break;
+      case Kind::ANY:
+        if (c != '/' && c != '[') {
+          next |= uint64_t(1) << (i + 1);
+        }
+        break;
+      case Kind::STAR:
+        if (c != '/' && c != '[') {
+          next |= uint64_t(1) << i;
+        }
+        break;
+      case Kind::DOUBLE_STAR:
+        if (c != '[') {
+          next |= uint64_t(1) << i;
+        }
+        break;
+      }
+    }
+    states = closure(next);
+  }
+  return (states >> m_tokens.size()) & 1;
+}
+
 // Return true if `proguard_regex` has any characters in it that would require
 // the use of regex. Return false if simple string equality would work
 bool has_special_char(const std::string& proguard_regex) {
@@ -7,7 +7,10 @@
 
 #pragma once
 
+#include <boost/optional.hpp>
+#include <cstdint>
 #include <string>
+#include <vector>
 
 namespace keep_rules {
 namespace proguard_parser {
@@ -17,5 +20,45 @@ std::string form_type_regex(const std::string& proguard_regex);
 bool has_special_char(const std::string& proguard_regex);
 std::string convert_wildcard_type(const std::string& typ);
 
+// The longest string that every string matched by
+// form_type_regex(proguard_regex) starts with.
+std::string get_literal_type_prefix(const std::string& proguard_regex);
+
+/*
+ * Matches type patterns that only consist of literal characters and the `*`,
+ * `**` and `?` wildcards, which covers almost all class name patterns, with
+ * the same semantics as boost::regex_match against form_type_regex(), but
+ * without the regex machinery: the pattern is compiled into a token sequence,
+ * and all positions in it are tracked at once in a bit set while scanning the
+ * input, so matching takes a single pass without backtracking.
+ */
+class TypeWildcardMatcher {
+ public:
+  // Returns none if the pattern uses anything beyond the supported subset.
+  static boost::optional<TypeWildcardMatcher> compile(
+      const std::string& proguard_regex);
+
+  bool match(const std::string& s) const;
+
+  const std::string& literal_prefix() const { return m_literal_prefix; }
+
+ private:
+  enum class Kind : uint8_t {
+    LITERAL, // the given character
+    ANY, // `?`: any character except the package separator or array prefix
+    STAR, // `*`: any number of those
+    DOUBLE_STAR, // `**`: any number of characters except the array prefix
+  };
+  struct Token {
+    Kind kind;
+    char ch;
+  };
+
+  uint64_t closure(uint64_t states) const;
+
+  std::vector<Token> m_tokens;
+  std::string m_literal_prefix;
+};
+
 } // namespace proguard_parser
 } // namespace keep_rules
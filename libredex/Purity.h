@@ -165,8 +165,10 @@ bool process_base_and_overriding_methods(
 // account all overriding methods.
 // When encountering unknown method implementations, the resulting map will have
 // no entry for the relevant (base) methods.
-// The return value indicates how many iterations the fixed-point computation
-// required.
+// The fixed-point computation is driven by a worklist, so that a method is only
+// analyzed again when the locations of one of its dependencies changed.
+// The return value indicates how many iterations (sweeps over the worklist)
+// the fixed-point computation required.
 size_t compute_locations_closure(
     const Scope& scope,
     const method_override_graph::Graph* method_override_graph,
@@ -194,8 +196,6 @@ size_t compute_conditionally_pure_methods(
 // state and only call other methods which do not have side effects.
 // The return value indicates how many iterations the fixed-point computation
 // required.
-// The return value indicates how many iterations the fixed-point computation
-// required.
 size_t compute_no_side_effects_methods(
     const Scope& scope,
     const method_override_graph::Graph* method_override_graph,
@@ -31,6 +31,10 @@ namespace {
 
 static ReachableObject SEED_SINGLETON{};
 
+// The number of newly reached objects a worker keeps visiting by itself before
+// it shares further objects through its task queue.
+constexpr size_t LOCAL_TASK_CHUNK_SIZE = 64;
+
 /*
  * Setup the algorithm's seeds using setup_root and computes all reachable
  * objects by applying a transitive closure.
@@ -45,8 +49,8 @@ std::unique_ptr<ReachableObjects> setup_seeds_and_compute_reachable_objects(
     std::unique_ptr<const mog::Graph>* out_method_override_graph) {
   Timer t("Marking");
   auto scope = build_class_scope(stores);
-  auto reachable_objects = std::make_unique<ReachableObjects>();
-  ConditionallyMarked cond_marked;
+  auto reachable_objects = std::make_unique<ReachableObjects>(scope);
+  ConditionallyMarked cond_marked(reachable_objects->ids());
   auto method_override_graph = mog::build_graph(scope);
 
   ConcurrentSet<ReachableObject, ReachableObjectHash> root_set;
@@ -65,7 +69,7 @@ std::unique_ptr<ReachableObjects> setup_seeds_and_compute_reachable_objects(
             ignore_sets, *method_override_graph, record_reachability,
             &cond_marked, reachable_objects.get(), worker_state,
             &stats_arr[worker_state->worker_id()]);
-        transitive_closure_marker.visit(obj);
+        transitive_closure_marker.run(obj);
         return nullptr;
       },
       num_threads,
@@ -93,6 +97,79 @@ namespace reachability {
 
 DexMethodRef* TransitiveClosureMarker::s_class_forname = nullptr;
 
+size_t AtomicBitset::count() const {
+  size_t result = 0;
+  for (const auto& word : m_words) {
+    result += __builtin_popcountll(word.load());
+  }
+  return result;
+}
+
+constexpr uint32_t DenseIds::NONE;
+
+DenseIds::DenseIds(const Scope& scope) {
+  m_classes.reserve(scope.size());
+  for (const auto* cls : scope) {
+    m_classes.emplace(cls, m_classes.size());
+    for (const auto* f : cls->get_ifields()) {
+      m_fields.emplace(f, m_fields.size());
+    }
+    for (const auto* f : cls->get_sfields()) {
+      m_fields.emplace(f, m_fields.size());
+    }
+    for (const auto* m : cls->get_dmethods()) {
+      m_methods.emplace(m, m_methods.size());
+    }
+    for (const auto* m : cls->get_vmethods()) {
+      m_methods.emplace(m, m_methods.size());
+    }
+  }
+}
+
+ReachableObjects::ReachableObjects(const Scope& scope)
+    : m_ids(std::make_unique<DenseIds>(scope)),
+      m_marked_classes(m_ids.get(), m_ids->num_classes()),
+      m_marked_fields(m_ids.get(), m_ids->num_fields()),
+      m_marked_methods(m_ids.get(), m_ids->num_methods()) {}
+
+ConditionallyMarked::ConditionallyMarked(const DenseIds& ids)
+    : m_ids(&ids),
+      m_fields(&ids, ids.num_fields()),
+      m_methods(&ids, ids.num_methods()),
+      m_member_counts(new std::atomic<uint32_t>[ids.num_classes()]()) {}
+
+bool ConditionallyMarked::mark(const DexField* field) {
+  if (!m_fields.mark(field)) {
+    return false;
+  }
+  count_member(field->get_class());
+  return true;
+}
+
+bool ConditionallyMarked::mark(const DexMethod* method) {
+  if (!m_methods.mark(method)) {
+    return false;
+  }
+  count_member(method->get_class());
+  return true;
+}
+
+void ConditionallyMarked::count_member(const DexType* type) {
+  if (!m_ids) {
+    return;
+  }
+  auto id = m_ids->get(type_class(type));
+  if (id != DenseIds::NONE) {
+    m_member_counts[id].fetch_add(1);
+  }
+}
+
+bool ConditionallyMarked::has_marked_members(const DexClass* cls) const {
+  auto id = m_ids ? m_ids->get(cls) : DenseIds::NONE;
+  // Classes without an id aren't counted; they have to be looked at.
+  return id == DenseIds::NONE || m_member_counts[id].load() > 0;
+}
+
 std::ostream& operator<<(std::ostream& os, const ReachableObject& obj) {
   switch (obj.type) {
   case ReachableObjectType::ANNO:
@@ -201,12 +278,12 @@ void RootSetMarker::push_seed(const DexClass* cls) {
 
 void RootSetMarker::push_seed(const DexField* field) {
   if (!field) return;
-  m_cond_marked->fields.insert(field);
+  m_cond_marked->mark(field);
 }
 
 void RootSetMarker::push_seed(const DexMethod* method) {
   if (!method) return;
-  m_cond_marked->methods.insert(method);
+  m_cond_marked->mark(method);
 }
 
 template <class Seed>
@@ -242,6 +319,23 @@ void RootSetMarker::mark_external_method_overriders() {
   }
 }
 
+void TransitiveClosureMarker::run(const ReachableObject& obj) {
+  visit(obj);
+  while (!m_local_tasks.empty()) {
+    auto next = m_local_tasks.back();
+    m_local_tasks.pop_back();
+    visit(next);
+  }
+}
+
+void TransitiveClosureMarker::push_task(const ReachableObject& obj) {
+  if (m_local_tasks.size() < LOCAL_TASK_CHUNK_SIZE) {
+    m_local_tasks.push_back(obj);
+  } else {
+    m_worker_state->push_task(obj);
+  }
+}
+
 /*
  * Marks :obj and pushes its immediately reachable neighbors onto the local
  * task queue of the current worker.
@@ -290,11 +384,10 @@ void TransitiveClosureMarker::push(const Parent* parent, const DexClass* cls) {
     return;
   }
   record_reachability(parent, cls);
-  if (m_reachable_objects->marked(cls)) {
+  if (!m_reachable_objects->mark(cls)) {
     return;
   }
-  m_reachable_objects->mark(cls);
-  m_worker_state->push_task(ReachableObject(cls));
+  push_task(ReachableObject(cls));
 }
 
 template <class Parent>
@@ -304,15 +397,14 @@ void TransitiveClosureMarker::push(const Parent* parent,
     return;
   }
   record_reachability(parent, field);
-  if (m_reachable_objects->marked(field)) {
+  if (!m_reachable_objects->mark(field)) {
     return;
   }
   auto f = field->as_def();
   if (f) {
     gather_and_push(f);
   }
-  m_reachable_objects->mark(field);
-  m_worker_state->push_task(ReachableObject(field));
+  push_task(ReachableObject(field));
 }
 
 template <class Parent>
@@ -327,11 +419,10 @@ void TransitiveClosureMarker::push(const Parent* parent,
   }
 
   record_reachability(parent, method);
-  if (m_reachable_objects->marked(method)) {
+  if (!m_reachable_objects->mark(method)) {
     return;
   }
-  m_reachable_objects->mark(method);
-  m_worker_state->push_task(ReachableObject(method));
+  push_task(ReachableObject(method));
 }
 
 void TransitiveClosureMarker::push(const DexMethodRef* parent,
@@ -343,13 +434,14 @@ void TransitiveClosureMarker::push_cond(const DexMethod* method) {
   if (!method || m_reachable_objects->marked(method)) return;
   TRACE(REACH, 4, "Conditionally marking method: %s", SHOW(method));
   auto clazz = type_class(method->get_class());
-  m_cond_marked->methods.insert(method);
+  m_cond_marked->mark(method);
   // If :clazz has been marked, we cannot count on visit(DexClass*) to move
   // the conditionally-marked methods into the actually-marked ones -- we have
   // to do it ourselves. Note that we must do this check after adding :method
   // to m_cond_marked to avoid a race condition where we add to m_cond_marked
   // after visit(DexClass*) has finished moving its contents over to
-  // m_reachable_objects.
+  // m_reachable_objects. (The marks and member counts are sequentially
+  // consistent atomics, so one of the two sides always sees the other.)
   if (m_reachable_objects->marked(clazz)) {
     push(clazz, method);
   }
@@ -477,23 +569,26 @@ void TransitiveClosureMarker::visit_cls(const DexClass* cls) {
       gather_and_push(anno);
     }
   }
+  if (!m_cond_marked->has_marked_members(cls)) {
+    return;
+  }
   for (auto const& m : cls->get_ifields()) {
-    if (m_cond_marked->fields.count(m)) {
+    if (m_cond_marked->marked(m)) {
       push(cls, m);
     }
   }
   for (auto const& m : cls->get_sfields()) {
-    if (m_cond_marked->fields.count(m)) {
+    if (m_cond_marked->marked(m)) {
       push(cls, m);
     }
   }
   for (auto const& m : cls->get_dmethods()) {
-    if (m_cond_marked->methods.count(m)) {
+    if (m_cond_marked->marked(m)) {
       push(cls, m);
     }
   }
   for (auto const& m : cls->get_vmethods()) {
-    if (m_cond_marked->methods.count(m)) {
+    if (m_cond_marked->marked(m)) {
       push(cls, m);
     }
   }
@@ -7,6 +7,9 @@
 
 #pragma once
 
+#include <atomic>
+#include <limits>
+#include <memory>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -90,36 +93,143 @@ using ReachableObjectSet =
 using ReachableObjectGraph =
     ConcurrentMap<ReachableObject, ReachableObjectSet, ReachableObjectHash>;
 
+/*
+ * A fixed-size set of bits that can be set and tested concurrently.
+ */
+class AtomicBitset {
+ public:
+  AtomicBitset() = default;
+  explicit AtomicBitset(size_t size) : m_words((size + 63) / 64) {}
+
+  // Returns whether the bit was not set before.
+  bool set(size_t i) {
+    uint64_t bit = uint64_t(1) << (i % 64);
+    return !(m_words[i / 64].fetch_or(bit) & bit);
+  }
+
+  bool test(size_t i) const {
+    return m_words[i / 64].load() & (uint64_t(1) << (i % 64));
+  }
+
+  size_t count() const;
+
+ private:
+  std::vector<std::atomic<uint64_t>> m_words;
+};
+
+/*
+ * Dense ids for the classes, fields and methods of a scope, so that marks can
+ * be recorded in bitsets instead of concurrent hash sets. Anything outside of
+ * the scope, e.g. external classes and unresolved refs, has no id.
+ */
+class DenseIds {
+ public:
+  static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+  DenseIds() = default;
+  explicit DenseIds(const Scope& scope);
+
+  uint32_t get(const DexClass* cls) const { return find(m_classes, cls); }
+  uint32_t get(const DexFieldRef* field) const {
+    return find(m_fields, field);
+  }
+  uint32_t get(const DexMethodRef* method) const {
+    return find(m_methods, method);
+  }
+
+  size_t num_classes() const { return m_classes.size(); }
+  size_t num_fields() const { return m_fields.size(); }
+  size_t num_methods() const { return m_methods.size(); }
+
+ private:
+  template <class Map, class Key>
+  static uint32_t find(const Map& map, Key key) {
+    auto it = map.find(key);
+    return it == map.end() ? NONE : it->second;
+  }
+
+  std::unordered_map<const DexClass*, uint32_t> m_classes;
+  std::unordered_map<const DexFieldRef*, uint32_t> m_fields;
+  std::unordered_map<const DexMethodRef*, uint32_t> m_methods;
+};
+
+/*
+ * A set of marks for objects of type T. Objects with a dense id are marked in
+ * an atomic bitset; all others, if any, fall back to a concurrent set.
+ */
+template <class T>
+class MarkSet {
+ public:
+  MarkSet() = default;
+  MarkSet(const DenseIds* ids, size_t size) : m_ids(ids), m_bits(size) {}
+
+  // Returns whether the object was not marked before.
+  bool mark(const T* obj) {
+    auto id = m_ids ? m_ids->get(obj) : DenseIds::NONE;
+    return id != DenseIds::NONE ? m_bits.set(id) : m_others.insert(obj);
+  }
+
+  bool marked(const T* obj) const {
+    auto id = m_ids ? m_ids->get(obj) : DenseIds::NONE;
+    return id != DenseIds::NONE ? m_bits.test(id) : m_others.count(obj);
+  }
+
+  bool marked_unsafe(const T* obj) const {
+    auto id = m_ids ? m_ids->get(obj) : DenseIds::NONE;
+    return id != DenseIds::NONE ? m_bits.test(id) : m_others.count_unsafe(obj);
+  }
+
+  size_t size() const { return m_bits.count() + m_others.size(); }
+
+ private:
+  const DenseIds* m_ids{nullptr};
+  AtomicBitset m_bits;
+  ConcurrentSet<const T*> m_others;
+};
+
 class ReachableObjects {
  public:
+  ReachableObjects() = default;
+
+  // Assigns dense ids to the objects of the scope, which makes marking them
+  // considerably cheaper.
+  explicit ReachableObjects(const Scope& scope);
+
   const ReachableObjectGraph& retainers_of() const { return m_retainers_of; }
 
-  void mark(const DexClass* cls) { m_marked_classes.insert(cls); }
+  const DenseIds& ids() const { return *m_ids; }
 
-  void mark(const DexMethodRef* method) { m_marked_methods.insert(method); }
+  // The mark functions return whether the object was not marked before.
+  bool mark(const DexClass* cls) { return m_marked_classes.mark(cls); }
 
-  void mark(const DexFieldRef* field) { m_marked_fields.insert(field); }
+  bool mark(const DexMethodRef* method) {
+    return m_marked_methods.mark(method);
+  }
+
+  bool mark(const DexFieldRef* field) { return m_marked_fields.mark(field); }
 
-  bool marked(const DexClass* cls) const { return m_marked_classes.count(cls); }
+  bool marked(const DexClass* cls) const {
+    return m_marked_classes.marked(cls);
+  }
 
   bool marked(const DexMethodRef* method) const {
-    return m_marked_methods.count(method);
+    return m_marked_methods.marked(method);
   }
 
   bool marked(const DexFieldRef* field) const {
-    return m_marked_fields.count(field);
+    return m_marked_fields.marked(field);
   }
 
   bool marked_unsafe(const DexClass* cls) const {
-    return m_marked_classes.count_unsafe(cls);
+    return m_marked_classes.marked_unsafe(cls);
   }
 
   bool marked_unsafe(const DexMethodRef* method) const {
-    return m_marked_methods.count_unsafe(method);
+    return m_marked_methods.marked_unsafe(method);
   }
 
   bool marked_unsafe(const DexFieldRef* field) const {
-    return m_marked_fields.count_unsafe(field);
+    return m_marked_fields.marked_unsafe(field);
   }
 
   size_t num_marked_classes() const { return m_marked_classes.size(); }
@@ -142,18 +252,46 @@ class ReachableObjects {
 
   void record_reachability(const DexMethodRef* member, const DexClass* cls);
 
-  ConcurrentSet<const DexClass*> m_marked_classes;
-  ConcurrentSet<const DexFieldRef*> m_marked_fields;
-  ConcurrentSet<const DexMethodRef*> m_marked_methods;
+  std::unique_ptr<const DenseIds> m_ids{std::make_unique<DenseIds>()};
+  MarkSet<DexClass> m_marked_classes;
+  MarkSet<DexFieldRef> m_marked_fields;
+  MarkSet<DexMethodRef> m_marked_methods;
   ReachableObjectGraph m_retainers_of;
 
   friend class RootSetMarker;
   friend class TransitiveClosureMarker;
 };
 
-struct ConditionallyMarked {
-  ConcurrentSet<const DexField*> fields;
-  ConcurrentSet<const DexMethod*> methods;
+/*
+ * Class members that are kept if their class is, e.g. by -keepclassmembers
+ * rules or as implementations of reachable interface methods. Each class
+ * counts its conditionally marked members, so that visiting a class only has
+ * to look at its members when there are any.
+ */
+class ConditionallyMarked {
+ public:
+  ConditionallyMarked() = default;
+  explicit ConditionallyMarked(const DenseIds& ids);
+
+  // Returns whether the member was not conditionally marked before.
+  bool mark(const DexField* field);
+  bool mark(const DexMethod* method);
+
+  bool marked(const DexField* field) const { return m_fields.marked(field); }
+  bool marked(const DexMethod* method) const {
+    return m_methods.marked(method);
+  }
+
+  // Whether any member of the class may be conditionally marked.
+  bool has_marked_members(const DexClass* cls) const;
+
+ private:
+  void count_member(const DexType* type);
+
+  const DenseIds* m_ids{nullptr};
+  MarkSet<DexFieldRef> m_fields;
+  MarkSet<DexMethodRef> m_methods;
+  std::unique_ptr<std::atomic<uint32_t>[]> m_member_counts;
 };
 
 struct References {
@@ -271,6 +409,13 @@ class TransitiveClosureMarker {
 
   virtual ~TransitiveClosureMarker() = default;
 
+  /*
+   * Visits :obj, and then keeps visiting newly reached objects from a local
+   * chunk of tasks. Only objects that don't fit into the chunk are pushed onto
+   * the task queue of the current worker, where other workers can steal them.
+   */
+  void run(const ReachableObject& obj);
+
   /*
    * Marks :obj and pushes its immediately reachable neighbors onto the local
    * task queue of the current worker.
@@ -311,6 +456,8 @@ class TransitiveClosureMarker {
 
   void push_cond(const DexMethod* method);
 
+  void push_task(const ReachableObject& obj);
+
   bool has_class_forname(DexMethod* meth);
 
   void gather_and_push(DexMethod* meth);
@@ -339,6 +486,7 @@ class TransitiveClosureMarker {
   ReachableObjects* m_reachable_objects;
   MarkWorkerState* m_worker_state;
   Stats* m_stats;
+  std::vector<ReachableObject> m_local_tasks;
 
   static DexMethodRef* s_class_forname;
 };
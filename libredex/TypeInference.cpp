@@ -7,6 +7,7 @@
 
 #include "TypeInference.h"
 
+#include <algorithm>
 #include <numeric>
 #include <ostream>
 #include <sstream>
@@ -97,6 +98,154 @@ TypeLattice type_lattice(
      {LONG2, SCALAR2},  {DOUBLE2, SCALAR2}, {REFERENCE, TOP},
      {SCALAR, TOP},     {SCALAR1, TOP},     {SCALAR2, TOP}});
 
+namespace {
+
+constexpr size_t NUM_IR_TYPES = TOP + 1;
+
+// The lattice operations on IRTypes, tabulated for the dense environments.
+struct TypeLatticeTables {
+  uint8_t join[NUM_IR_TYPES][NUM_IR_TYPES];
+  uint8_t meet[NUM_IR_TYPES][NUM_IR_TYPES];
+  bool leq[NUM_IR_TYPES][NUM_IR_TYPES];
+
+  TypeLatticeTables() {
+    for (size_t i = 0; i < NUM_IR_TYPES; i++) {
+      for (size_t j = 0; j < NUM_IR_TYPES; j++) {
+        TypeDomain a(static_cast<IRType>(i));
+        TypeDomain b(static_cast<IRType>(j));
+        join[i][j] = a.join(b).element();
+        meet[i][j] = a.meet(b).element();
+        leq[i][j] = a.leq(b);
+      }
+    }
+  }
+};
+
+const TypeLatticeTables& get_type_lattice_tables() {
+  static const TypeLatticeTables tables;
+  return tables;
+}
+
+} // namespace
+
+constexpr reg_t BasicTypeEnvironment::DENSE_REGISTERS;
+
+bool BasicTypeEnvironment::is_top() const {
+  if (m_is_bottom || !m_sparse.is_top()) {
+    return false;
+  }
+  return std::all_of(m_dense.begin(), m_dense.end(),
+                     [](uint8_t type) { return type == TOP; });
+}
+
+bool BasicTypeEnvironment::leq(const BasicTypeEnvironment& other) const {
+  if (m_is_bottom) {
+    return true;
+  }
+  if (other.m_is_bottom) {
+    return false;
+  }
+  const auto& tables = get_type_lattice_tables();
+  for (size_t i = 0; i < DENSE_REGISTERS; i++) {
+    if (!tables.leq[m_dense[i]][other.m_dense[i]]) {
+      return false;
+    }
+  }
+  return m_sparse.leq(other.m_sparse);
+}
+
+bool BasicTypeEnvironment::equals(const BasicTypeEnvironment& other) const {
+  if (m_is_bottom || other.m_is_bottom) {
+    return m_is_bottom == other.m_is_bottom;
+  }
+  return m_dense == other.m_dense && m_sparse.equals(other.m_sparse);
+}
+
+void BasicTypeEnvironment::set_to_bottom() {
+  m_is_bottom = true;
+  m_dense.fill(TOP);
+  m_sparse.set_to_bottom();
+}
+
+void BasicTypeEnvironment::set_to_top() {
+  m_is_bottom = false;
+  m_dense.fill(TOP);
+  m_sparse.set_to_top();
+}
+
+void BasicTypeEnvironment::join_with(const BasicTypeEnvironment& other) {
+  if (m_is_bottom) {
+    *this = other;
+    return;
+  }
+  if (other.m_is_bottom) {
+    return;
+  }
+  const auto& tables = get_type_lattice_tables();
+  for (size_t i = 0; i < DENSE_REGISTERS; i++) {
+    m_dense[i] = tables.join[m_dense[i]][other.m_dense[i]];
+  }
+  m_sparse.join_with(other.m_sparse);
+}
+
+void BasicTypeEnvironment::meet_with(const BasicTypeEnvironment& other) {
+  if (m_is_bottom) {
+    return;
+  }
+  if (other.m_is_bottom) {
+    set_to_bottom();
+    return;
+  }
+  const auto& tables = get_type_lattice_tables();
+  for (size_t i = 0; i < DENSE_REGISTERS; i++) {
+    m_dense[i] = tables.meet[m_dense[i]][other.m_dense[i]];
+    if (m_dense[i] == BOTTOM) {
+      set_to_bottom();
+      return;
+    }
+  }
+  m_sparse.meet_with(other.m_sparse);
+  if (m_sparse.is_bottom()) {
+    set_to_bottom();
+  }
+}
+
+BasicTypeEnvironment& BasicTypeEnvironment::set(reg_t reg,
+                                                const TypeDomain& type) {
+  if (m_is_bottom) {
+    return *this;
+  }
+  if (type.is_bottom()) {
+    set_to_bottom();
+    return *this;
+  }
+  if (reg < DENSE_REGISTERS) {
+    m_dense[reg] = type.element();
+  } else {
+    m_sparse.set(reg, type);
+  }
+  return *this;
+}
+
+BasicTypeEnvironment::SparseEnvironment BasicTypeEnvironment::to_sparse()
+    const {
+  if (m_is_bottom) {
+    return SparseEnvironment::bottom();
+  }
+  SparseEnvironment env = m_sparse;
+  for (reg_t reg = 0; reg < DENSE_REGISTERS; reg++) {
+    if (m_dense[reg] != TOP) {
+      env.set(reg, TypeDomain(static_cast<IRType>(m_dense[reg])));
+    }
+  }
+  return env;
+}
+
+std::ostream& operator<<(std::ostream& output,
+                         const BasicTypeEnvironment& env) {
+  return output << env.to_sparse();
+}
+
 void set_type(TypeEnvironment* state, reg_t reg, const TypeDomain& type) {
   state->set_type(reg, type);
 }
@@ -322,14 +471,8 @@ void TypeInference::run(const DexMethod* dex_method) {
       dex_method->get_proto()->get_args());
 }
 
-void TypeInference::run(bool is_static,
-                        DexType* declaring_type,
-                        DexTypeList* args) {
-  // We need to compute the initial environment by assigning the parameter
-  // registers their correct types derived from the method's signature. The
-  // IOPCODE_LOAD_PARAM_* instructions are pseudo-operations that are used to
-  // specify the formal parameters of the method. They must be interpreted
-  // separately.
+TypeEnvironment TypeInference::get_initial_environment(
+    bool is_static, DexType* declaring_type, DexTypeList* args) const {
   auto init_state = TypeEnvironment::top();
   const auto& signature = args->get_type_list();
   auto sig_it = signature.begin();
@@ -374,10 +517,63 @@ void TypeInference::run(bool is_static,
       not_reached();
     }
   }
-  MonotonicFixpointIterator::run(init_state);
+  return init_state;
+}
+
+void TypeInference::run(bool is_static,
+                        DexType* declaring_type,
+                        DexTypeList* args) {
+  MonotonicFixpointIterator::run(
+      get_initial_environment(is_static, declaring_type, args));
   populate_type_environments();
 }
 
+bool TypeInference::run_without_merges(const DexMethod* dex_method) {
+  cfg::Block* entry = m_cfg.entry_block();
+  for (cfg::Block* block : m_cfg.blocks()) {
+    if (block->preds().size() > (block == entry ? 0 : 1)) {
+      return false;
+    }
+  }
+
+  m_type_envs.reserve(m_cfg.blocks().size() * 16);
+  std::unordered_map<cfg::Block*, TypeEnvironment> entry_states;
+  entry_states.emplace(
+      entry, get_initial_environment(is_static(dex_method),
+                                     dex_method->get_class(),
+                                     dex_method->get_proto()->get_args()));
+  std::vector<cfg::Block*> work_list{entry};
+  while (!work_list.empty()) {
+    cfg::Block* block = work_list.back();
+    work_list.pop_back();
+    TypeEnvironment current_state = entry_states.at(block);
+    for (auto& mie : InstructionIterable(block)) {
+      IRInstruction* insn = mie.insn;
+      m_type_envs.emplace(insn, current_state);
+      analyze_instruction(insn, &current_state, block);
+    }
+    // Without merge points, every successor is reached exactly once.
+    for (cfg::Edge* edge : block->succs()) {
+      entry_states.emplace(edge->target(), analyze_edge(edge, current_state));
+      work_list.push_back(edge->target());
+    }
+  }
+
+  // Blocks that are unreachable from the entry block.
+  for (cfg::Block* block : m_cfg.blocks()) {
+    if (entry_states.count(block)) {
+      continue;
+    }
+    TypeEnvironment current_state = TypeEnvironment::bottom();
+    for (auto& mie : InstructionIterable(block)) {
+      IRInstruction* insn = mie.insn;
+      m_type_envs.emplace(insn, current_state);
+      analyze_instruction(insn, &current_state, block);
+    }
+  }
+  return true;
+}
+
 // This method analyzes an instruction and updates the type environment
 // accordingly during the fixpoint iteration.
 //
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <array>
 #include <boost/optional/optional_io.hpp>
 #include <ostream>
 
@@ -135,8 +136,79 @@ using TypeDomain = sparta::FiniteAbstractDomain<IRType,
 
 using namespace ir_analyzer;
 
-using BasicTypeEnvironment =
-    sparta::PatriciaTreeMapAbstractEnvironment<reg_t, TypeDomain>;
+/*
+ * The mapping of registers to their IRType. Most methods only use a few
+ * registers, and the environments get copied and joined a lot, so the types of
+ * the registers below DENSE_REGISTERS are kept in a flat array; joining or
+ * copying it is much cheaper than doing the same with a Patricia tree. The
+ * remaining registers, which only occur in large methods, as well as the
+ * result register pair, are kept in a Patricia-tree environment. Unbound
+ * registers are TOP, and binding any register to BOTTOM turns the whole
+ * environment into BOTTOM, just like for PatriciaTreeMapAbstractEnvironment.
+ */
+class BasicTypeEnvironment final
+    : public sparta::AbstractDomain<BasicTypeEnvironment> {
+ public:
+  using SparseEnvironment =
+      sparta::PatriciaTreeMapAbstractEnvironment<reg_t, TypeDomain>;
+
+  static constexpr reg_t DENSE_REGISTERS = 64;
+
+  BasicTypeEnvironment() { m_dense.fill(TOP); }
+
+  bool is_bottom() const override { return m_is_bottom; }
+
+  bool is_top() const override;
+
+  bool leq(const BasicTypeEnvironment& other) const override;
+
+  bool equals(const BasicTypeEnvironment& other) const override;
+
+  void set_to_bottom() override;
+
+  void set_to_top() override;
+
+  void join_with(const BasicTypeEnvironment& other) override;
+
+  void widen_with(const BasicTypeEnvironment& other) override {
+    // The lattice is finite.
+    join_with(other);
+  }
+
+  void meet_with(const BasicTypeEnvironment& other) override;
+
+  void narrow_with(const BasicTypeEnvironment& other) override {
+    meet_with(other);
+  }
+
+  TypeDomain get(reg_t reg) const {
+    if (m_is_bottom) {
+      return TypeDomain::bottom();
+    }
+    if (reg < DENSE_REGISTERS) {
+      return TypeDomain(static_cast<IRType>(m_dense[reg]));
+    }
+    return m_sparse.get(reg);
+  }
+
+  BasicTypeEnvironment& set(reg_t reg, const TypeDomain& type);
+
+  BasicTypeEnvironment& update(
+      reg_t reg, const std::function<TypeDomain(const TypeDomain&)>& operation) {
+    return set(reg, operation(get(reg)));
+  }
+
+  // The same environment in Patricia-tree form.
+  SparseEnvironment to_sparse() const;
+
+ private:
+  bool m_is_bottom{false};
+  std::array<uint8_t, DENSE_REGISTERS> m_dense;
+  SparseEnvironment m_sparse;
+};
+
+std::ostream& operator<<(std::ostream& output,
+                         const BasicTypeEnvironment& env);
 
 /*
  * Note that we only track the register DexTypeDomain mapping here. We always
@@ -195,6 +267,16 @@ class TypeInference final
 
   void run(bool is_static, DexType* declaring_type, DexTypeList* args);
 
+  /*
+   * When no block of the cfg is a merge point, i.e. the entry block has no
+   * predecessors and every other block has at most one, the fixpoint
+   * iteration reduces to propagating the exit state of each block to its
+   * successors, which this does in a single pass. Returns false without
+   * doing anything if there are merge points. Only get_type_environments()
+   * reflects the result; the fixpoint iterator's states stay unset.
+   */
+  bool run_without_merges(const DexMethod* dex_method);
+
   void analyze_node(const cfg::GraphInterface::NodeId& node,
                     TypeEnvironment* current_state) const override {
     for (auto& mie : InstructionIterable(node)) {
@@ -224,6 +306,10 @@ class TypeInference final
  private:
   void populate_type_environments();
 
+  TypeEnvironment get_initial_environment(bool is_static,
+                                          DexType* declaring_type,
+                                          DexTypeList* args) const;
+
   const cfg::ControlFlowGraph& m_cfg;
   std::unordered_map<const IRInstruction*, TypeEnvironment> m_type_envs;
 
@@ -15,6 +15,7 @@
 #include "Purity.h"
 #include "Show.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 using namespace cse_impl;
 
@@ -37,6 +38,9 @@ constexpr const char* METRIC_CONDITIONALLY_PURE_METHODS =
     "num_conditionally_pure_methods";
 constexpr const char* METRIC_CONDITIONALLY_PURE_METHODS_ITERATIONS =
     "num_conditionally_pure_methods_iterations";
+constexpr const char* METRIC_CALLEE_SUMMARIES = "num_callee_summaries";
+constexpr const char* METRIC_REFRESHED_METHOD_BARRIERS =
+    "num_refreshed_method_barriers";
 constexpr const char* METRIC_MAX_ITERATIONS = "num_max_iterations";
 
 } // namespace
@@ -71,7 +75,47 @@ void CommonSubexpressionEliminationPass::run_pass(DexStoresVector& stores,
   copy_prop_config.eliminate_const_classes = false;
   copy_prop_config.eliminate_const_strings = false;
   copy_prop_config.static_finals = false;
-  const auto stats = walk::parallel::methods<Stats>(
+
+  // Runs CSE once on a method, followed by copy-propagation and local-dce to
+  // clean up after it. Returns whether CSE changed anything.
+  auto run_iteration = [&](DexMethod* method, Stats* stats) {
+    auto code = method->get_code();
+    stats->max_iterations++;
+    TRACE(CSE, 3, "[CSE] processing %s", SHOW(method));
+    always_assert(code->editable_cfg_built());
+    CommonSubexpressionElimination cse(
+        &shared_state, code->cfg(), is_static(method),
+        method::is_init(method) || method::is_clinit(method),
+        method->get_class(), method->get_proto()->get_args());
+    bool any_changes = cse.patch(m_runtime_assertions);
+    *stats += cse.get_stats();
+
+    if (!any_changes) {
+      return false;
+    }
+
+    copy_propagation_impl::CopyPropagation copy_propagation(copy_prop_config);
+    copy_propagation.run(code, method);
+
+    auto local_dce = LocalDce(shared_state.get_pure_methods(),
+                              shared_state.get_method_override_graph(),
+                              /* may_allocate_registers */ true);
+    local_dce.dce(code);
+
+    if (traceEnabled(CSE, 5)) {
+      TRACE(CSE, 5, "[CSE] end of iteration:\n%s", SHOW(code->cfg()));
+    }
+    return true;
+  };
+
+  // The first iteration runs on all methods. As it may remove writes, the
+  // barrier summaries of the changed methods are then refreshed, before the
+  // remaining iterations run on those methods until they reach a fixed point.
+  // The cfgs are dropped in between, so that they don't all stay alive at the
+  // same time.
+  auto num_threads = m_debug ? 1 : redex_parallel::default_num_threads();
+  ConcurrentSet<DexMethod*> changed_methods;
+  auto stats = walk::parallel::methods<Stats>(
       scope,
       [&](DexMethod* method) {
         const auto code = method->get_code();
@@ -85,37 +129,37 @@ void CommonSubexpressionEliminationPass::run_pass(DexStoresVector& stores,
         }
 
         Stats stats;
-        while (true) {
-          stats.max_iterations++;
-          TRACE(CSE, 3, "[CSE] processing %s", SHOW(method));
-          always_assert(code->editable_cfg_built());
-          CommonSubexpressionElimination cse(
-              &shared_state, code->cfg(), is_static(method),
-              method::is_init(method) || method::is_clinit(method),
-              method->get_class(), method->get_proto()->get_args());
-          bool any_changes = cse.patch(m_runtime_assertions);
-          stats += cse.get_stats();
-
-          if (!any_changes) {
-            code->clear_cfg();
-            return stats;
-          }
-
-          copy_propagation_impl::CopyPropagation copy_propagation(
-              copy_prop_config);
-          copy_propagation.run(code, method);
-
-          auto local_dce = LocalDce(shared_state.get_pure_methods(),
-                                    shared_state.get_method_override_graph(),
-                                    /* may_allocate_registers */ true);
-          local_dce.dce(code);
-
-          if (traceEnabled(CSE, 5)) {
-            TRACE(CSE, 5, "[CSE] end of iteration:\n%s", SHOW(code->cfg()));
-          }
+        if (run_iteration(method, &stats)) {
+          shared_state.invalidate_method(method);
+          changed_methods.insert(method);
+        }
+        code->clear_cfg();
+        return stats;
+      },
+      num_threads);
+
+  shared_state.refresh_invalidated_methods();
+
+  std::mutex stats_mutex;
+  auto wq = workqueue_foreach<DexMethod*>(
+      [&](DexMethod* method) {
+        auto code = method->get_code();
+        code->build_cfg(/* editable */ true);
+        Stats method_stats;
+        // Account for the first iteration.
+        method_stats.max_iterations = 1;
+        while (run_iteration(method, &method_stats)) {
         }
+        code->clear_cfg();
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        stats += method_stats;
       },
-      m_debug ? 1 : redex_parallel::default_num_threads());
+      num_threads);
+  for (auto method : changed_methods) {
+    wq.add_item(method);
+  }
+  wq.run_all();
+
   mgr.incr_metric(METRIC_RESULTS_CAPTURED, stats.results_captured);
   mgr.incr_metric(METRIC_STORES_CAPTURED, stats.stores_captured);
   mgr.incr_metric(METRIC_ARRAY_LENGTHS_CAPTURED, stats.array_lengths_captured);
@@ -132,6 +176,9 @@ void CommonSubexpressionEliminationPass::run_pass(DexStoresVector& stores,
                   shared_state_stats.conditionally_pure_methods);
   mgr.incr_metric(METRIC_CONDITIONALLY_PURE_METHODS_ITERATIONS,
                   shared_state_stats.conditionally_pure_methods_iterations);
+  mgr.incr_metric(METRIC_CALLEE_SUMMARIES, shared_state_stats.callee_summaries);
+  mgr.incr_metric(METRIC_REFRESHED_METHOD_BARRIERS,
+                  shared_state_stats.refreshed_method_barriers);
   for (auto& p : stats.eliminated_opcodes) {
     std::string name = METRIC_INSTR_PREFIX;
     name += SHOW(static_cast<IROpcode>(p.first));
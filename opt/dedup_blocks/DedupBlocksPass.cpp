@@ -23,28 +23,10 @@ void DedupBlocksPass::run_pass(DexStoresVector& stores,
                                PassManager& mgr) {
   const auto& scope = build_class_scope(stores);
 
-  const auto stats = walk::parallel::methods<dedup_blocks_impl::Stats>(
-      scope,
-      [&](DexMethod* method) {
-        const auto code = method->get_code();
-        if (code == nullptr || m_config.method_blocklist.count(method) != 0) {
-          return dedup_blocks_impl::Stats();
-        }
-
-        TRACE(DEDUP_BLOCKS, 3, "[dedup blocks] method %s", SHOW(method));
-
-        code->build_cfg(/* editable */ true);
-        auto& cfg = code->cfg();
-
-        TRACE(DEDUP_BLOCKS, 5, "[dedup blocks] method %s before:\n%s",
-              SHOW(method), SHOW(cfg));
-
-        dedup_blocks_impl::DedupBlocks impl(&m_config, method);
-        impl.run();
-
-        code->clear_cfg();
-        return impl.get_stats();
-      },
+  std::vector<DexMethod*> methods;
+  walk::methods(scope, [&](DexMethod* method) { methods.push_back(method); });
+  const auto stats = dedup_blocks_impl::dedup_methods(
+      &m_config, methods,
       m_config.debug ? 1 : redex_parallel::default_num_threads());
 
   report_stats(mgr, stats);
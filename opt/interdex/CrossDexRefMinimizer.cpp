@@ -5,6 +5,7 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <algorithm>
 #include <cmath>
 #include <numeric>
 
@@ -12,6 +13,7 @@
 #include "DexUtil.h"
 #include "Show.h"
 #include "Trace.h"
+#include "WorkQueue.h"
 
 namespace interdex {
 
@@ -69,44 +71,91 @@ uint64_t CrossDexRefMinimizer::ClassInfo::get_priority() const {
   return (primary_priority << 24) | secondary_priority;
 }
 
-void CrossDexRefMinimizer::reprioritize(
-    const std::unordered_map<DexClass*, CrossDexRefMinimizer::ClassInfoDelta>&
-        affected_classes) {
-  TRACE(IDEX, 4, "[dex ordering] Reprioritizing %u classes",
-        affected_classes.size());
-  for (auto p : affected_classes) {
-    ++m_stats.reprioritizations;
-    DexClass* affected_class = p.first;
-    CrossDexRefMinimizer::ClassInfoDelta& delta = p.second;
-    CrossDexRefMinimizer::ClassInfo& affected_class_info =
-        m_class_infos.at(affected_class);
-    affected_class_info.applied_refs_weight += delta.applied_refs_weight;
-    for (size_t i = 0; i < INFREQUENT_REFS_COUNT; ++i) {
-      affected_class_info.infrequent_refs_weight[i] +=
-          delta.infrequent_refs_weight[i];
+uint32_t CrossDexRefMinimizer::get_ref_id(void* ref) {
+  auto it = m_ref_ids.emplace(ref, m_ref_infos.size()).first;
+  if (it->second == m_ref_infos.size()) {
+    m_ref_infos.emplace_back();
+  }
+  return it->second;
+}
+
+template <class Fn>
+void CrossDexRefMinimizer::for_each_class(RefInfo& ref_info, const Fn& fn) {
+  auto& classes = ref_info.classes;
+  size_t alive = 0;
+  for (size_t i = 0; i < classes.size(); ++i) {
+    auto& class_info = m_class_infos[classes[i]];
+    if (!class_info.alive) {
+      continue;
+    }
+    classes[alive++] = classes[i];
+    fn(class_info);
+  }
+  classes.resize(alive);
+}
+
+void CrossDexRefMinimizer::mark_dirty(ClassInfo& class_info) {
+  if (!class_info.dirty) {
+    class_info.dirty = true;
+    m_dirty_classes.push_back(class_info.index);
+  }
+}
+
+void CrossDexRefMinimizer::push(const ClassInfo& class_info) {
+  m_prioritized_classes.emplace_back(class_info.priority, class_info.index);
+  std::push_heap(m_prioritized_classes.begin(), m_prioritized_classes.end());
+}
+
+void CrossDexRefMinimizer::rebuild_prioritized_classes() {
+  m_prioritized_classes.clear();
+  for (auto& class_info : m_class_infos) {
+    if (class_info.alive) {
+      class_info.priority = class_info.get_priority();
+      m_prioritized_classes.emplace_back(class_info.priority, class_info.index);
     }
+  }
+  std::make_heap(m_prioritized_classes.begin(), m_prioritized_classes.end());
+}
 
+void CrossDexRefMinimizer::reprioritize() {
+  TRACE(IDEX, 4, "[dex ordering] Reprioritizing %u classes",
+        m_dirty_classes.size());
+  for (auto index : m_dirty_classes) {
+    auto& affected_class_info = m_class_infos[index];
+    affected_class_info.dirty = false;
+    if (!affected_class_info.alive) {
+      continue;
+    }
+    ++m_stats.reprioritizations;
     const auto priority = affected_class_info.get_priority();
-    m_prioritized_classes.update_priority(affected_class, priority);
-    TRACE(
-        IDEX, 5,
-        "[dex ordering] Reprioritized class {%s} with priority %016lx; "
-        "index %u; %u (delta %d) applied refs weight, %s (delta %s) infrequent "
-        "refs weights, %u total refs",
-        SHOW(affected_class), priority, affected_class_info.index,
-        affected_class_info.applied_refs_weight, delta.applied_refs_weight,
-        format_infrequent_refs_array(affected_class_info.infrequent_refs_weight)
-            .c_str(),
-        format_infrequent_refs_array(delta.infrequent_refs_weight).c_str(),
-        affected_class_info.refs.size());
+    if (priority != affected_class_info.priority) {
+      affected_class_info.priority = priority;
+      push(affected_class_info);
+    }
+    TRACE(IDEX, 5,
+          "[dex ordering] Reprioritized class {%s} with priority %016lx; "
+          "index %u; %u applied refs weight, %s infrequent refs weights, %u "
+          "total refs",
+          SHOW(affected_class_info.cls), priority, affected_class_info.index,
+          affected_class_info.applied_refs_weight,
+          format_infrequent_refs_array(
+              affected_class_info.infrequent_refs_weight)
+              .c_str(),
+          affected_class_info.refs.size());
+  }
+  m_dirty_classes.clear();
+  // Outdated entries are only dropped when they reach the top; don't let them
+  // pile up.
+  if (m_prioritized_classes.size() > 4 * m_alive_classes + 1024) {
+    rebuild_prioritized_classes();
   }
 }
 
-void CrossDexRefMinimizer::gather_refs(DexClass* cls,
-                                       std::vector<DexMethodRef*>& method_refs,
-                                       std::vector<DexFieldRef*>& field_refs,
-                                       std::vector<DexType*>& types,
-                                       std::vector<DexString*>& strings) {
+void CrossDexRefMinimizer::gather_refs(DexClass* cls, Refs* refs) {
+  auto& method_refs = refs->method_refs;
+  auto& field_refs = refs->field_refs;
+  auto& types = refs->types;
+  auto& strings = refs->strings;
   cls->gather_methods(method_refs);
   cls->gather_fields(field_refs);
   cls->gather_types(types);
@@ -125,6 +174,36 @@ void CrossDexRefMinimizer::gather_refs(DexClass* cls,
   std::sort(strings.begin(), strings.end(), compare_dexstrings);
 }
 
+CrossDexRefMinimizer::Refs CrossDexRefMinimizer::get_refs(DexClass* cls,
+                                                          bool keep) {
+  auto it = m_precomputed_refs.find(cls);
+  if (it == m_precomputed_refs.end()) {
+    Refs refs;
+    gather_refs(cls, &refs);
+    return refs;
+  }
+  if (keep) {
+    return it->second;
+  }
+  auto refs = std::move(it->second);
+  m_precomputed_refs.erase(it);
+  return refs;
+}
+
+void CrossDexRefMinimizer::precompute_refs(
+    const std::vector<DexClass*>& classes) {
+  std::vector<Refs> refs(classes.size());
+  auto wq = workqueue_foreach<size_t>(
+      [&](size_t i) { gather_refs(classes[i], &refs[i]); });
+  for (size_t i = 0; i < classes.size(); ++i) {
+    wq.add_item(i);
+  }
+  wq.run_all();
+  for (size_t i = 0; i < classes.size(); ++i) {
+    m_precomputed_refs[classes[i]] = std::move(refs[i]);
+  }
+}
+
 void CrossDexRefMinimizer::ignore(DexClass* cls) {
   // By setting the count to the maximum value here, the class will later appear
   // to have an extremely high frequency and thus get skipped from
@@ -133,11 +212,7 @@ void CrossDexRefMinimizer::ignore(DexClass* cls) {
 }
 
 void CrossDexRefMinimizer::sample(DexClass* cls) {
-  std::vector<DexMethodRef*> method_refs;
-  std::vector<DexFieldRef*> field_refs;
-  std::vector<DexType*> types;
-  std::vector<DexString*> strings;
-  gather_refs(cls, method_refs, field_refs, types, strings);
+  auto refs = get_refs(cls, /* keep */ true);
   auto increment = [& ref_counts = m_ref_counts,
                     &max_ref_count = m_max_ref_count](void* ref) {
     size_t& count = ref_counts[ref];
@@ -145,60 +220,59 @@ void CrossDexRefMinimizer::sample(DexClass* cls) {
       max_ref_count = count;
     }
   };
-  for (auto ref : method_refs) {
+  for (auto ref : refs.method_refs) {
     increment(ref);
   }
-  for (auto ref : field_refs) {
+  for (auto ref : refs.field_refs) {
     increment(ref);
   }
-  for (auto ref : types) {
+  for (auto ref : refs.types) {
     increment(ref);
   }
-  for (auto ref : strings) {
+  for (auto ref : refs.strings) {
     increment(ref);
   }
 }
 
 void CrossDexRefMinimizer::insert(DexClass* cls) {
-  always_assert(m_class_infos.count(cls) == 0);
+  auto class_index_it = m_class_indices.find(cls);
+  always_assert(class_index_it == m_class_indices.end() ||
+                !m_class_infos[class_index_it->second].alive);
   ++m_stats.classes;
-  CrossDexRefMinimizer::ClassInfo& class_info =
-      m_class_infos
-          .insert({cls, CrossDexRefMinimizer::ClassInfo(m_next_index++)})
-          .first->second;
+  uint32_t index = m_class_infos.size();
+  m_class_indices[cls] = index;
+  m_class_infos.emplace_back(cls, index);
+  ++m_alive_classes;
+  CrossDexRefMinimizer::ClassInfo& class_info = m_class_infos.back();
 
   // Collect all relevant references that contribute to cross-dex metadata
   // entries.
   // We don't bother with protos and type_lists, as they are directly related
   // to method refs (I tried, didn't help).
-  std::vector<DexMethodRef*> method_refs;
-  std::vector<DexFieldRef*> field_refs;
-  std::vector<DexType*> types;
-  std::vector<DexString*> strings;
-  gather_refs(cls, method_refs, field_refs, types, strings);
+  auto gathered_refs = get_refs(cls, /* keep */ false);
 
   auto& refs = class_info.refs;
-  refs.reserve(method_refs.size() + field_refs.size() + types.size() +
-               strings.size());
+  refs.reserve(gathered_refs.method_refs.size() +
+               gathered_refs.field_refs.size() + gathered_refs.types.size() +
+               gathered_refs.strings.size());
   uint64_t& refs_weight = class_info.refs_weight;
   uint64_t& seed_weight = class_info.seed_weight;
 
-  auto add_weight = [& ref_counts = m_ref_counts,
-                     max_ref_count = m_max_ref_count, &refs, &refs_weight,
-                     &seed_weight](void* ref, size_t item_weight,
-                                   size_t item_seed_weight) {
-    auto it = ref_counts.find(ref);
-    auto ref_count = it == ref_counts.end() ? 1 : it->second;
-    double frequency = ref_count * 1.0 / max_ref_count;
+  auto add_weight = [this, &refs, &refs_weight, &seed_weight](
+                        void* ref, size_t item_weight,
+                        size_t item_seed_weight) {
+    auto it = m_ref_counts.find(ref);
+    auto ref_count = it == m_ref_counts.end() ? 1 : it->second;
+    double frequency = ref_count * 1.0 / m_max_ref_count;
     // We skip reference that...
     // - only ever appear once (those won't help with prioritization), and
     // - and those which appear extremely frequently (and are therefore likely
     //   to be referenced by every dex anyway)
     bool skipping = ref_count == 1 || frequency > (1.0 / 8);
-    TRACE(IDEX, 6, "[dex ordering] %zu/%zu = %lf %s", ref_count, max_ref_count,
-          frequency, skipping ? "(skipping)" : "");
+    TRACE(IDEX, 6, "[dex ordering] %zu/%zu = %lf %s", ref_count,
+          m_max_ref_count, frequency, skipping ? "(skipping)" : "");
     if (!skipping) {
-      refs.emplace_back(ref, item_weight);
+      refs.emplace_back(get_ref_id(ref), item_weight);
       refs_weight += item_weight;
       seed_weight += item_seed_weight;
     }
@@ -209,118 +283,111 @@ void CrossDexRefMinimizer::insert(DexClass* cls) {
   // different values and observing the effect on APK size.
   // We discount references that occur in many classes.
   // TODO: Try some other variations.
-  for (auto mref : method_refs) {
+  for (auto mref : gathered_refs.method_refs) {
     add_weight(mref, m_config.method_ref_weight, m_config.method_seed_weight);
   }
-  for (auto type : types) {
+  for (auto type : gathered_refs.types) {
     add_weight(type, m_config.type_ref_weight, m_config.type_seed_weight);
   }
-  for (auto string : strings) {
+  for (auto string : gathered_refs.strings) {
     add_weight(string, m_config.string_ref_weight, m_config.string_seed_weight);
   }
-  for (auto fref : field_refs) {
+  for (auto fref : gathered_refs.field_refs) {
     add_weight(fref, m_config.field_ref_weight, m_config.field_seed_weight);
   }
 
-  std::unordered_map<DexClass*, CrossDexRefMinimizer::ClassInfoDelta>
-      affected_classes;
-  for (const std::pair<void*, uint32_t>& p : refs) {
-    void* ref = p.first;
+  for (const std::pair<uint32_t, uint32_t>& p : refs) {
+    auto& ref_info = m_ref_infos[p.first];
     uint32_t weight = p.second;
-    auto& classes = m_ref_classes[ref];
-    size_t frequency = classes.size();
-    // We record the need to undo (subtract weight of) a previously claimed
-    // infrequent ref. The actual undoing happens later in
-    // reprioritize.
+    size_t frequency = ref_info.frequency;
+    // The other classes with this ref move from one infrequency bucket to the
+    // next (or out of them).
     if (frequency > 0 && frequency <= INFREQUENT_REFS_COUNT) {
-      for (DexClass* affected_class : classes) {
-        always_assert(affected_class != cls);
-        affected_classes[affected_class]
-            .infrequent_refs_weight[frequency - 1] -= weight;
-      }
+      for_each_class(ref_info, [&](ClassInfo& affected_class_info) {
+        always_assert(affected_class_info.cls != cls);
+        affected_class_info.infrequent_refs_weight[frequency - 1] -= weight;
+        if (frequency < INFREQUENT_REFS_COUNT) {
+          affected_class_info.infrequent_refs_weight[frequency] += weight;
+        }
+        mark_dirty(affected_class_info);
+      });
     }
     ++frequency;
-    // We are recording a new infrequent unapplied ref, if any.
-    // This happens immediately for the to be inserted class cls,
-    // so that it can be used right away by the upcoming
-    // class_info.get_priority() call, while all other change requests happen
-    // later in reprioritize.
     if (frequency <= INFREQUENT_REFS_COUNT) {
-      for (DexClass* affected_class : classes) {
-        affected_classes[affected_class]
-            .infrequent_refs_weight[frequency - 1] += weight;
-      }
       class_info.infrequent_refs_weight[frequency - 1] += weight;
     }
-
-    // There's an implicit invariant that class_info and the keys of
-    // affected_classes are disjoint, so we are not going to reprioritize
-    // the class that we are adding here.
-    classes.emplace(cls);
+    ref_info.classes.push_back(index);
+    ref_info.frequency = frequency;
   }
-  const auto priority = class_info.get_priority();
-  m_prioritized_classes.insert(cls, priority);
+  class_info.priority = class_info.get_priority();
+  push(class_info);
   TRACE(IDEX, 4,
         "[dex ordering] Inserting class {%s} with priority %016lx; index %u; "
         "%s infrequent refs weights, %u total refs",
-        SHOW(cls), priority, class_info.index,
+        SHOW(cls), class_info.priority, class_info.index,
         format_infrequent_refs_array(class_info.infrequent_refs_weight).c_str(),
         refs.size());
-  reprioritize(affected_classes);
+  reprioritize();
 }
 
-bool CrossDexRefMinimizer::empty() const {
-  return m_prioritized_classes.empty();
-}
+bool CrossDexRefMinimizer::empty() const { return m_alive_classes == 0; }
 
 DexClass* CrossDexRefMinimizer::front() const {
-  return m_prioritized_classes.front();
+  always_assert(m_alive_classes > 0);
+  for (;;) {
+    always_assert(!m_prioritized_classes.empty());
+    const auto& top = m_prioritized_classes.front();
+    const auto& class_info = m_class_infos[top.second];
+    if (class_info.alive && class_info.priority == top.first) {
+      return class_info.cls;
+    }
+    std::pop_heap(m_prioritized_classes.begin(), m_prioritized_classes.end());
+    m_prioritized_classes.pop_back();
+  }
 }
 
 DexClass* CrossDexRefMinimizer::worst(bool generated) {
-  auto max_it = m_class_infos.end();
+  const ClassInfo* max_class_info = nullptr;
   uint64_t max_value = 0;
 
-  for (auto it = m_class_infos.begin(); it != m_class_infos.end(); ++it) {
+  // Class infos are ordered by index, so the first class with the highest seed
+  // weight is the one that was inserted earliest, which makes things
+  // deterministic.
+  for (const auto& class_info : m_class_infos) {
+    if (!class_info.alive) {
+      continue;
+    }
     // If requested, let's skip generated classes, as they tend to be not stable
     // and may cause drastic build-over-build changes.
-    if (it->first->rstate.is_generated() != generated) {
+    if (class_info.cls->rstate.is_generated() != generated) {
       continue;
     }
 
-    const CrossDexRefMinimizer::ClassInfo& class_info = it->second;
     uint64_t value = class_info.seed_weight;
 
     // Prefer the largest denominator
-    if (value < max_value) {
+    if (max_class_info != nullptr && value <= max_value) {
       continue;
     }
 
-    // If equal, prefer the class that was inserted earlier (smaller index) to
-    // make things deterministic.
-    if (value == max_value && max_it != m_class_infos.end() &&
-        class_info.index > max_it->second.index) {
-      continue;
-    }
-
-    max_it = it;
+    max_class_info = &class_info;
     max_value = value;
   }
 
-  if (max_it == m_class_infos.end()) {
+  if (max_class_info == nullptr) {
     return nullptr;
   }
 
   TRACE(IDEX, 3,
         "[dex ordering] Picked worst class {%s} with seed %u; "
         "index %u",
-        SHOW(max_it->first), max_value, max_it->second.index);
-  m_stats.worst_classes.emplace_back(max_it->first, max_value);
-  return max_it->first;
+        SHOW(max_class_info->cls), max_value, max_class_info->index);
+  m_stats.worst_classes.emplace_back(max_class_info->cls, max_value);
+  return max_class_info->cls;
 }
 
 DexClass* CrossDexRefMinimizer::worst() {
-  always_assert(!m_class_infos.empty());
+  always_assert(m_alive_classes > 0);
   // We prefer to find a class that is not generated. Only when such a class
   // doesn't exist (because all classes are generated), then we pick the worst
   // generated class.
@@ -333,87 +400,83 @@ DexClass* CrossDexRefMinimizer::worst() {
 }
 
 void CrossDexRefMinimizer::erase(DexClass* cls, bool emitted, bool reset) {
-  m_prioritized_classes.erase(cls);
-  auto class_info_it = m_class_infos.find(cls);
-  always_assert(class_info_it != m_class_infos.end());
-  const CrossDexRefMinimizer::ClassInfo& class_info = class_info_it->second;
+  auto class_index_it = m_class_indices.find(cls);
+  always_assert(class_index_it != m_class_indices.end());
+  CrossDexRefMinimizer::ClassInfo& class_info =
+      m_class_infos[class_index_it->second];
+  always_assert(class_info.alive);
   TRACE(IDEX, 3,
         "[dex ordering] Processing class {%s} with priority %016lx; "
         "index %u; %u applied refs weight, %s infrequent refs weights, %u "
         "total refs; emitted %d",
-        SHOW(cls), class_info.get_priority(), class_info.index,
+        SHOW(cls), class_info.priority, class_info.index,
         class_info.applied_refs_weight,
         format_infrequent_refs_array(class_info.infrequent_refs_weight).c_str(),
         class_info.refs.size(), emitted);
+  class_info.alive = false;
+  --m_alive_classes;
+  m_class_indices.erase(class_index_it);
 
-  // Updating m_applied_refs and m_ref_classes,
-  // and gathering information on how this affects other classes
+  // Updating the applied refs and the ref frequencies, and with them the
+  // weights of all affected classes
 
   if (reset) {
     TRACE(IDEX, 3, "[dex ordering] Reset");
     ++m_stats.resets;
-    m_applied_refs.clear();
+    ++m_applied_epoch;
+    m_applied_refs = 0;
+    for (auto& reset_class_info : m_class_infos) {
+      reset_class_info.applied_refs_weight = 0;
+    }
   }
 
-  std::unordered_map<DexClass*, CrossDexRefMinimizer::ClassInfoDelta>
-      affected_classes;
-  const auto& refs = class_info.refs;
-  size_t old_applied_refs = m_applied_refs.size();
-  for (const std::pair<void*, uint32_t>& p : refs) {
-    void* ref = p.first;
+  size_t old_applied_refs = m_applied_refs;
+  for (const std::pair<uint32_t, uint32_t>& p : class_info.refs) {
+    auto& ref_info = m_ref_infos[p.first];
     uint32_t weight = p.second;
-    auto& classes = m_ref_classes.at(ref);
-    size_t frequency = classes.size();
+    size_t frequency = ref_info.frequency;
     always_assert(frequency > 0);
-    const auto erased = classes.erase(cls);
-    always_assert(erased);
-    if (frequency <= INFREQUENT_REFS_COUNT) {
-      for (DexClass* affected_class : classes) {
-        affected_classes[affected_class]
-            .infrequent_refs_weight[frequency - 1] -= weight;
-      }
+    ref_info.frequency = --frequency;
+    bool apply = emitted && ref_info.applied_epoch != m_applied_epoch;
+    if (apply) {
+      ref_info.applied_epoch = m_applied_epoch;
+      ++m_applied_refs;
     }
-    --frequency;
-    if (frequency > 0 && frequency <= INFREQUENT_REFS_COUNT) {
-      for (DexClass* affected_class : classes) {
-        affected_classes[affected_class]
-            .infrequent_refs_weight[frequency - 1] += weight;
+    if (!apply && frequency >= INFREQUENT_REFS_COUNT) {
+      // Nothing changes for the remaining classes; still drop this class from
+      // the ref's class list once it gets too long.
+      if (ref_info.classes.size() > 2 * frequency + 16) {
+        for_each_class(ref_info, [](ClassInfo&) {});
       }
-    }
-
-    if (!emitted) {
-      continue;
-    }
-    if (m_applied_refs.count(ref) != 0) {
       continue;
     }
-    m_applied_refs.emplace(ref);
-    for (DexClass* affected_class : classes) {
-      affected_classes[affected_class].applied_refs_weight += weight;
-    }
+    // The remaining classes with this ref move from one infrequency bucket to
+    // the previous one.
+    for_each_class(ref_info, [&](ClassInfo& affected_class_info) {
+      if (frequency < INFREQUENT_REFS_COUNT) {
+        affected_class_info.infrequent_refs_weight[frequency] -= weight;
+        if (frequency > 0) {
+          affected_class_info.infrequent_refs_weight[frequency - 1] += weight;
+        }
+      }
+      if (apply) {
+        affected_class_info.applied_refs_weight += weight;
+      }
+      mark_dirty(affected_class_info);
+    });
   }
 
-  // Updating m_class_infos and m_prioritized_classes
+  // The refs are no longer needed.
+  std::vector<std::pair<uint32_t, uint32_t>>().swap(class_info.refs);
 
-  m_class_infos.erase(class_info_it);
-  always_assert(m_class_infos.count(cls) == 0);
-
-  if (reset) {
-    m_prioritized_classes.clear();
-    for (auto it = m_class_infos.begin(); it != m_class_infos.end(); ++it) {
-      DexClass* reset_class = it->first;
-      CrossDexRefMinimizer::ClassInfo& reset_class_info = it->second;
-      reset_class_info.applied_refs_weight = 0;
-      const auto priority = reset_class_info.get_priority();
-      m_prioritized_classes.insert(reset_class, priority);
-      always_assert(reset_class_info.applied_refs_weight == 0);
-    }
-  }
   if (emitted) {
     TRACE(IDEX, 4, "[dex ordering] %u + %u = %u applied refs", old_applied_refs,
-          m_applied_refs.size() - old_applied_refs, m_applied_refs.size());
+          m_applied_refs - old_applied_refs, m_applied_refs);
+  }
+  reprioritize();
+  if (reset) {
+    rebuild_prioritized_classes();
   }
-  reprioritize(affected_classes);
 }
 
 } // namespace interdex
@@ -7,12 +7,12 @@
 
 #pragma once
 
+#include <array>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
 #include "DexClass.h"
-#include "MutablePriorityQueue.h"
 
 namespace interdex {
 
@@ -26,7 +26,6 @@ namespace interdex {
 // minimization, but also causes it to use more memory and run slower.
 constexpr uint64_t INFREQUENT_REFS_COUNT = 6;
 
-using PrioritizedDexClasses = MutablePriorityQueue<DexClass*, uint64_t>;
 struct CrossDexRefMinimizerStats {
   uint64_t classes{0};
   uint64_t resets{0};
@@ -76,49 +75,87 @@ struct CrossDexRefMinimizerConfig {
 // reasonably large to prevent overflows. However, we don't always check for
 // overflows. In any case, all of this flows into a heuristic, so it wouldn't
 // be the end of the world if an overflow ever happens.
+//
+// All state is kept in flat arrays indexed by dense class and ref ids. For each
+// ref, we track the classes that (still) reference it; entries of removed
+// classes are dropped lazily when a ref's class list is visited. Weight changes
+// are applied directly to the affected classes, which are then marked dirty.
+// Their priorities are only recomputed once per insert / erase, and the
+// priority queue is updated lazily: a changed priority gets pushed as a new
+// entry, and outdated entries are skipped when looking for the front.
 class CrossDexRefMinimizer {
-  PrioritizedDexClasses m_prioritized_classes;
-  std::unordered_set<void*> m_applied_refs;
   struct ClassInfo {
+    DexClass* cls;
     uint32_t index;
+    bool alive{true};
+    bool dirty{false};
     // This array stores (the weights of) how many of the *refs of this class
     // have only one, two, ... classes left that reference them.
     std::array<uint32_t, INFREQUENT_REFS_COUNT> infrequent_refs_weight;
-    std::vector<std::pair<void*, uint32_t>> refs;
+    std::vector<std::pair<uint32_t, uint32_t>> refs;
     uint64_t refs_weight;
     uint64_t applied_refs_weight;
     uint64_t seed_weight{0};
-    explicit ClassInfo(uint32_t i)
-        : index(i),
+    uint64_t priority{0};
+    ClassInfo(DexClass* c, uint32_t i)
+        : cls(c),
+          index(i),
           infrequent_refs_weight(),
           refs_weight(0),
           applied_refs_weight(0) {}
     uint64_t get_primary_priority_denominator() const;
     uint64_t get_priority() const;
   };
-  std::unordered_map<DexClass*, ClassInfo> m_class_infos;
-  uint32_t m_next_index{0};
-  std::unordered_map<void*, std::unordered_set<DexClass*>> m_ref_classes;
+  // Indexed by class index.
+  std::vector<ClassInfo> m_class_infos;
+  std::unordered_map<DexClass*, uint32_t> m_class_indices;
+  size_t m_alive_classes{0};
+
+  struct RefInfo {
+    // Indices of classes referencing this ref; may include removed classes.
+    std::vector<uint32_t> classes;
+    // Number of alive classes referencing this ref.
+    uint32_t frequency{0};
+    // The ref has been applied to the current dex iff this matches
+    // m_applied_epoch.
+    uint32_t applied_epoch{0};
+  };
+  std::unordered_map<void*, uint32_t> m_ref_ids;
+  std::vector<RefInfo> m_ref_infos;
+  uint32_t m_applied_epoch{1};
+  size_t m_applied_refs{0};
+
+  // Max-heap of (priority, class index); may contain outdated entries.
+  mutable std::vector<std::pair<uint64_t, uint32_t>> m_prioritized_classes;
+  std::vector<uint32_t> m_dirty_classes;
+
   CrossDexRefMinimizerStats m_stats;
   const CrossDexRefMinimizerConfig m_config;
 
-  struct ClassInfoDelta {
-    std::array<int32_t, INFREQUENT_REFS_COUNT> infrequent_refs_weight{};
-    int64_t applied_refs_weight{0};
+  struct Refs {
+    std::vector<DexMethodRef*> method_refs;
+    std::vector<DexFieldRef*> field_refs;
+    std::vector<DexType*> types;
+    std::vector<DexString*> strings;
   };
+  std::unordered_map<const DexClass*, Refs> m_precomputed_refs;
 
-  void reprioritize(
-      const std::unordered_map<DexClass*, ClassInfoDelta>& affected_classes);
+  uint32_t get_ref_id(void* ref);
+  // Calls fn with the class info of every alive class that references the
+  // given ref, and drops removed classes from the ref's class list.
+  template <class Fn>
+  void for_each_class(RefInfo& ref_info, const Fn& fn);
+  void mark_dirty(ClassInfo& class_info);
+  void reprioritize();
+  void push(const ClassInfo& class_info);
+  void rebuild_prioritized_classes();
   DexClass* worst(bool generated);
 
   std::unordered_map<void*, size_t> m_ref_counts;
   size_t m_max_ref_count{0};
 
-  void gather_refs(DexClass* cls,
-                   std::vector<DexMethodRef*>& method_refs,
-                   std::vector<DexFieldRef*>& field_refs,
-                   std::vector<DexType*>& types,
-                   std::vector<DexString*>& strings);
+  static void gather_refs(DexClass* cls, Refs* refs);
+  Refs get_refs(DexClass* cls, bool keep);
 
  public:
   explicit CrossDexRefMinimizer(const CrossDexRefMinimizerConfig& config)
@@ -126,6 +163,10 @@ class CrossDexRefMinimizer {
   // Gather frequency counts; must be called for relevant classes before
   // inserting them
   void sample(DexClass* cls);
+  // Gather the refs of the given classes in parallel ahead of time, to be
+  // used by subsequent sample and insert calls. The classes must not change
+  // in the meantime.
+  void precompute_refs(const std::vector<DexClass*>& classes);
   // Ignore a class reference when computing weights
   void ignore(DexClass* cls);
   void insert(DexClass* cls);
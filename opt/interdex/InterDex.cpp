@@ -670,6 +670,10 @@ void InterDex::init_cross_dex_ref_minimizer_and_relocate_methods() {
     classes_to_insert.emplace_back(cls);
   }
 
+  // Gathering refs is the expensive part of sampling and inserting, and
+  // doesn't depend on the minimizer's state.
+  m_cross_dex_ref_minimizer.precompute_refs(classes_to_insert);
+
   // Initialize ref frequency counts
   for (DexClass* cls : classes_to_insert) {
     m_cross_dex_ref_minimizer.sample(cls);
@@ -59,6 +59,48 @@ int obfuscate_elems(const RenamingContext<T>& context,
   return num_renames;
 }
 
+// Picks new names for the fields of a class, avoiding the names of all other
+// fields of that class. Wrappers for all those fields must already exist in
+// the manager, which is only read here.
+void obfuscate_fields(DexClass* cls,
+                      bool operate_on_ifields,
+                      bool operate_on_sfields,
+                      const DexFieldManager& field_name_manager) {
+  FieldObfuscationState f_ob_state;
+  FieldNameGenerator field_name_generator(f_ob_state.ids_to_avoid,
+                                          f_ob_state.used_ids);
+
+  TRACE(OBFUSCATE, 3, "Renaming the fields of class %s", SHOW(cls->get_name()));
+
+  for (auto f : cls->get_ifields())
+    f_ob_state.ids_to_avoid.insert(field_name_manager.find(f)->get_name());
+  for (auto f : cls->get_sfields())
+    f_ob_state.ids_to_avoid.insert(field_name_manager.find(f)->get_name());
+
+  auto find_new_names = [&](const std::vector<DexField*>& fields) {
+    for (DexField* f : fields) {
+      auto wrap = field_name_manager.find(f);
+      if (!can_rename(f) || !wrap->should_rename()) {
+        TRACE(OBFUSCATE, 4,
+              "Ignoring member %s because we shouldn't rename it",
+              SHOW(f->get_name()));
+        continue;
+      }
+      field_name_generator.find_new_name(wrap);
+    }
+  };
+  if (operate_on_ifields) {
+    find_new_names(cls->get_ifields());
+  }
+  if (operate_on_sfields) {
+    find_new_names(cls->get_sfields());
+  }
+
+  // Make sure to bind the new names otherwise not all generators will
+  // assign names to the members
+  field_name_generator.bind_names();
+}
+
 void debug_logging(std::vector<DexClass*>& classes) {
   for (DexClass* cls : classes) {
     TRACE_NO_LINE(OBFUSCATE, 4, "Applying new names:\n  List of ifields\t");
@@ -149,7 +191,11 @@ void obfuscate(Scope& scope,
   DexFieldManager field_name_manager = new_dex_field_manager();
   DexMethodManager method_name_manager = new_dex_method_manager();
 
-  std::unordered_map<const DexClass*, int> next_dmethod_seeds;
+  // Field names only have to be unique within their class, so the classes can
+  // be processed independently of each other. All field wrappers are created
+  // up front; after that the manager is only read while picking names in
+  // parallel.
+  std::unordered_map<const DexClass*, std::pair<bool, bool>> field_classes;
   for (DexClass* cls : scope) {
     always_assert_log(!cls->is_external(),
                       "Shouldn't rename members of external classes. %s",
@@ -160,34 +206,25 @@ void obfuscate(Scope& scope,
         contains_renamable_elem(cls->get_ifields(), field_name_manager);
     bool operate_on_sfields =
         contains_renamable_elem(cls->get_sfields(), field_name_manager);
-    bool operate_on_dmethods =
-        contains_renamable_elem(cls->get_dmethods(), method_name_manager);
     if (operate_on_ifields || operate_on_sfields) {
-      FieldObfuscationState f_ob_state;
-      FieldNameGenerator field_name_generator(f_ob_state.ids_to_avoid,
-                                              f_ob_state.used_ids);
-
-      TRACE(OBFUSCATE, 3, "Renaming the fields of class %s",
-            SHOW(cls->get_name()));
-
-      f_ob_state.populate_ids_to_avoid(cls, field_name_manager,
-                                       /* unused */ ch);
-
-      if (operate_on_ifields) {
-        obfuscate_elems(
-            FieldRenamingContext(cls->get_ifields(), field_name_generator),
-            field_name_manager);
-      }
-      if (operate_on_sfields) {
-        obfuscate_elems(
-            FieldRenamingContext(cls->get_sfields(), field_name_generator),
-            field_name_manager);
-      }
-
-      // Make sure to bind the new names otherwise not all generators will
-      // assign names to the members
-      field_name_generator.bind_names();
+      for (auto f : cls->get_ifields()) field_name_manager[f];
+      for (auto f : cls->get_sfields()) field_name_manager[f];
+      field_classes.emplace(
+          cls, std::make_pair(operate_on_ifields, operate_on_sfields));
+    }
+  }
+  walk::parallel::classes(scope, [&](DexClass* cls) {
+    auto it = field_classes.find(cls);
+    if (it != field_classes.end()) {
+      obfuscate_fields(cls, it->second.first, it->second.second,
+                       field_name_manager);
     }
+  });
+
+  std::unordered_map<const DexClass*, int> next_dmethod_seeds;
+  for (DexClass* cls : scope) {
+    bool operate_on_dmethods =
+        contains_renamable_elem(cls->get_dmethods(), method_name_manager);
 
     // =========== Obfuscate Methods Below ==========
     if (operate_on_dmethods) {
@@ -36,4 +36,4 @@ struct RenameStats {
 
 void obfuscate(Scope& classes,
                RenameStats& stats,
-               const ObfuscatePass::Config& config);
+               bool avoid_colliding_debug_name);
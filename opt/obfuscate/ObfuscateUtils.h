@@ -555,6 +555,20 @@ class DexElemManager {
                                : emplace(elem);
   }
 
+  // Returns the wrapper of an element that was already created through
+  // operator[], or nullptr. Unlike operator[], this never modifies the
+  // manager, so it may be called concurrently once all wrappers of interest
+  // have been created.
+  DexNameWrapper<T>* find(T elem) const {
+    auto cls_it = elements.find(elem->get_class());
+    if (cls_it == elements.end()) return nullptr;
+    auto sig_it = cls_it->second.find(sig_getter_fn(elem));
+    if (sig_it == cls_it->second.end()) return nullptr;
+    auto name_it = sig_it->second.find(elem->get_name());
+    if (name_it == sig_it->second.end()) return nullptr;
+    return name_it->second.get();
+  }
+
   // Commits all the renamings in elements to the dex by modifying the
   // underlying DexFields. Does in-place modification. Returns the number
   // of elements renamed
@@ -6,6 +6,7 @@
  */
 
 #include "VirtualRenamer.h"
+#include "ConcurrentContainers.h"
 #include "DexAccess.h"
 #include "DexClass.h"
 #include "DexUtil.h"
@@ -15,6 +16,7 @@
 #include "Trace.h"
 #include "VirtualScope.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 #include <map>
 #include <set>
@@ -131,7 +133,9 @@ struct VirtualRenamer {
         def_refs(def_refs),
         stack_trace_elements(elms),
         external_name_cache(cache),
-        next_dmethod_seeds(next_dmethod_seeds) {}
+        next_dmethod_seeds(next_dmethod_seeds) {
+    build_scope_hierarchies();
+  }
 
   int rename_virtual_scopes(const DexType* type, int& seed);
   int rename_interface_scopes(int& seed);
@@ -151,8 +155,15 @@ struct VirtualRenamer {
   std::unordered_map<const DexType*, std::string>* external_name_cache;
   const std::unordered_map<const DexClass*, int>& next_dmethod_seeds;
   mutable std::unordered_map<const VirtualScope*, int> next_virtualscope_seeds;
+  // Scope root -> the root and all its children, i.e. all the classes in which
+  // a new name for a scope rooted there must not collide. Built once up front
+  // instead of for every candidate name.
+  std::unordered_map<const DexType*, std::vector<const DexType*>>
+      scope_hierarchies;
 
  private:
+  void build_scope_hierarchies();
+
   const std::string& get_prefix(const DexType* type) const {
     always_assert(external_name_cache != nullptr);
     auto iter = external_name_cache->find(type);
@@ -255,16 +266,51 @@ int VirtualRenamer::rename_scope(const VirtualScope* scope, DexString* name) {
   return renamed;
 }
 
+/**
+ * Gather the hierarchies of all scope roots in parallel. The classes don't
+ * change while renaming, so these stay valid throughout.
+ */
+void VirtualRenamer::build_scope_hierarchies() {
+  std::unordered_set<const DexType*> roots;
+  class_scopes.walk_virtual_scopes(
+      [&](const DexType*, const VirtualScope* scope) {
+        roots.insert(scope->type);
+      });
+  class_scopes.walk_all_intf_scopes(
+      [&](const DexString*,
+          const DexProto*,
+          const std::vector<const VirtualScope*>& scopes,
+          const TypeSet&) {
+        for (const auto& scope : scopes) {
+          roots.insert(scope->type);
+        }
+      });
+  for (const auto& root : roots) {
+    scope_hierarchies[root];
+  }
+  // Only the pre-created vectors get written, so the map itself is not
+  // modified concurrently.
+  auto wq = workqueue_foreach<const DexType*>([&](const DexType* root) {
+    auto& hier = scope_hierarchies.at(root);
+    auto children = get_all_children(class_scopes.get_class_hierarchy(), root);
+    hier.reserve(children.size() + 1);
+    hier.push_back(root);
+    hier.insert(hier.end(), children.begin(), children.end());
+  });
+  for (const auto& root : roots) {
+    wq.add_item(root);
+  }
+  wq.run_all();
+}
+
 /**
  * A name is usable if it does not collide with an existing
  * one in the def and ref space.
  */
 bool VirtualRenamer::usable_name(DexString* name,
                                  const VirtualScope* scope) const {
-  const auto root = scope->type;
   const auto proto = scope->methods[0].first->get_proto();
-  auto hier = get_all_children(class_scopes.get_class_hierarchy(), root);
-  hier.insert(root);
+  const auto& hier = scope_hierarchies.at(scope->type);
   bool has_ste = stack_trace_elements != nullptr;
   for (const auto& type : hier) {
     if (DexMethod::get_method(const_cast<DexType*>(type), name, proto) !=
@@ -464,7 +510,9 @@ int VirtualRenamer::rename_virtual_scopes(const DexType* type, int& seed) {
  * Collect all method refs to concrete methods (definitions).
  */
 void collect_refs(Scope& scope, RefsMap& def_refs) {
-  walk::opcodes(
+  ConcurrentMap<DexMethod*, std::set<DexMethodRef*, dexmethods_comparator>>
+      concurrent_def_refs;
+  walk::parallel::opcodes(
       scope, [](DexMethod*) { return true; },
       [&](DexMethod*, IRInstruction* insn) {
         if (!insn->has_method()) return;
@@ -491,8 +539,14 @@ void collect_refs(Scope& scope, RefsMap& def_refs) {
         redex_assert(type_class(top->get_class()) != nullptr);
         if (type_class(top->get_class())->is_external()) return;
         // it's a top definition on an internal class, save it
-        def_refs[top].insert(callee);
+        concurrent_def_refs.update(
+            top, [callee](DexMethod*,
+                          std::set<DexMethodRef*, dexmethods_comparator>& refs,
+                          bool) { refs.insert(callee); });
       });
+  for (auto& p : concurrent_def_refs) {
+    def_refs.emplace(p.first, std::move(p.second));
+  }
 }
 
 } // namespace
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "EscapeSummaryAnalysisPass.h"
+
+#include <fstream>
+
+#include "DexUtil.h"
+#include "HierarchyUtil.h"
+#include "PassManager.h"
+#include "SummarySerialization.h"
+#include "Walkers.h"
+
+namespace ptrs = local_pointers;
+
+namespace object_sensitive_dce {
+
+CallGraphStrategy::CallGraphStrategy(const Scope& scope)
+    : m_scope(scope),
+      m_non_overridden_virtuals(
+          hierarchy_util::find_non_overridden_virtuals(scope)) {}
+
+call_graph::CallSites CallGraphStrategy::get_callsites(
+    const DexMethod* method) const {
+  call_graph::CallSites callsites;
+  auto* code = const_cast<IRCode*>(method->get_code());
+  if (code == nullptr) {
+    return callsites;
+  }
+  for (auto& mie : InstructionIterable(code)) {
+    auto insn = mie.insn;
+    if (opcode::is_an_invoke(insn->opcode())) {
+      auto callee = resolve_method(insn->get_method(), opcode_to_search(insn),
+                                   m_resolved_refs, method);
+      if (callee == nullptr || may_be_overridden(callee)) {
+        continue;
+      }
+      callsites.emplace_back(callee, code->iterator_to(mie));
+    }
+  }
+  return callsites;
+}
+
+// XXX(jezng): We make every single method a root in order that all methods
+// are seen as reachable. Unreachable methods will not have `get_callsites`
+// run on them and will not have their outgoing edges added to the call graph,
+// which means that the dead code removal will not optimize them fully. I'm
+// not sure why these "unreachable" methods are not ultimately removed by RMU,
+// but as it stands, properly optimizing them is a size win for us.
+std::vector<const DexMethod*> CallGraphStrategy::get_roots() const {
+  std::vector<const DexMethod*> roots;
+
+  walk::code(m_scope, [&](DexMethod* method, IRCode& code) {
+    roots.emplace_back(method);
+  });
+  return roots;
+}
+
+} // namespace object_sensitive_dce
+
+void EscapeSummaryAnalysisPass::run_pass(DexStoresVector& stores,
+                                         ConfigFiles&,
+                                         PassManager& mgr) {
+  auto scope = build_class_scope(stores);
+
+  // Same CFGs as in ObjectSensitiveDcePass, so that the summaries match.
+  walk::parallel::code(scope, [&](const DexMethod* method, IRCode& code) {
+    code.build_cfg(/* editable */ false);
+    code.cfg().calculate_exit_block();
+  });
+
+  auto call_graph =
+      call_graph::Graph(object_sensitive_dce::CallGraphStrategy(scope));
+
+  ptrs::SummaryMap escape_summaries;
+  if (m_external_escape_summaries_file) {
+    std::ifstream file_input(*m_external_escape_summaries_file);
+    summary_serialization::read(file_input, &escape_summaries);
+  }
+  ptrs::SummaryCMap escape_summaries_cmap(escape_summaries.begin(),
+                                          escape_summaries.end());
+  auto stats =
+      ptrs::compute_summaries(scope, call_graph, &escape_summaries_cmap);
+
+  walk::parallel::code(scope, [&](const DexMethod* method, IRCode& code) {
+    code.clear_cfg();
+  });
+
+  m_result = std::make_shared<const Result>(escape_summaries_cmap.begin(),
+                                            escape_summaries_cmap.end());
+  mgr.set_metric("sccs", stats.sccs);
+  mgr.set_metric("analyzed_methods", stats.analyzed_methods);
+  mgr.set_metric("summaries", m_result->size());
+}
+
+static EscapeSummaryAnalysisPass s_pass;
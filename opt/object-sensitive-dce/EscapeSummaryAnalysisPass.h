@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <boost/optional.hpp>
+#include <memory>
+#include <string>
+#include <unordered_set>
+
+#include "CallGraph.h"
+#include "LocalPointersAnalysis.h"
+#include "Pass.h"
+#include "Resolver.h"
+
+namespace object_sensitive_dce {
+
+/*
+ * The call graph that the escape and side effect summaries of
+ * ObjectSensitiveDcePass are computed over.
+ */
+class CallGraphStrategy final : public call_graph::BuildStrategy {
+ public:
+  explicit CallGraphStrategy(const Scope& scope);
+
+  call_graph::CallSites get_callsites(const DexMethod* method) const override;
+
+  std::vector<const DexMethod*> get_roots() const override;
+
+ private:
+  bool may_be_overridden(DexMethod* method) const {
+    return method->is_virtual() && m_non_overridden_virtuals.count(method) == 0;
+  }
+
+  const Scope& m_scope;
+  std::unordered_set<const DexMethod*> m_non_overridden_virtuals;
+  mutable MethodRefCache m_resolved_refs;
+};
+
+} // namespace object_sensitive_dce
+
+/*
+ * Computes the escape summaries of all methods in scope, so that later passes
+ * -- ObjectSensitiveDcePass in particular -- can reuse them for as long as
+ * this analysis is preserved.
+ */
+class EscapeSummaryAnalysisPass : public Pass {
+ public:
+  EscapeSummaryAnalysisPass()
+      : Pass("EscapeSummaryAnalysisPass", Pass::ANALYSIS) {}
+
+  void bind_config() override {
+    bind("escape_summaries", {boost::none}, m_external_escape_summaries_file,
+         "Escape summaries of external methods, in the format read by "
+         "ObjectSensitiveDcePass.",
+         Configurable::bindflags::optionals::skip_empty_string);
+  }
+
+  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+
+  using Result = local_pointers::SummaryMap;
+
+  std::shared_ptr<const Result> get_result() { return m_result; }
+
+  void destroy_analysis_result() override { m_result = nullptr; }
+
+ private:
+  boost::optional<std::string> m_external_escape_summaries_file;
+  std::shared_ptr<const Result> m_result = nullptr;
+};
@@ -7,6 +7,8 @@
 
 #include "SideEffectSummary.h"
 
+#include <algorithm>
+
 #include "CallGraph.h"
 #include "ConcurrentContainers.h"
 #include "Show.h"
@@ -218,27 +220,23 @@ void SummaryBuilder::classify_heap_write(const ptrs::Environment& env,
 }
 
 /*
- * Analyze :method and insert its summary into :summary_cmap. Recursively
- * analyze the callees if necessary. This method is thread-safe.
+ * Analyze :method and insert its summary into :summary_cmap. The callees of
+ * :method, except for the ones in the same call graph component that are not
+ * done yet, must have been analyzed already. This method is thread-safe.
  */
-void analyze_method_recursive(const DexMethod* method,
-                              const call_graph::Graph& call_graph,
-                              const ptrs::FixpointIteratorMap& ptrs_fp_iter_map,
-                              PatriciaTreeSet<const DexMethodRef*> visiting,
-                              SummaryConcurrentMap* summary_cmap) {
-  if (!method || summary_cmap->count(method) != 0 ||
-      visiting.contains(method) || method->get_code() == nullptr) {
+void analyze_method(const DexMethod* method,
+                    const call_graph::Graph& call_graph,
+                    const ptrs::FixpointIteratorMap& ptrs_fp_iter_map,
+                    SummaryConcurrentMap* summary_cmap) {
+  if (summary_cmap->count(method) != 0) {
     return;
   }
-  visiting.insert(method);
 
   InvokeToSummaryMap invoke_to_summary_cmap;
   if (call_graph.has_node(method)) {
     const auto& callee_edges = call_graph.node(method)->callees();
     for (const auto& edge : callee_edges) {
       auto* callee = edge->callee()->method();
-      analyze_method_recursive(callee, call_graph, ptrs_fp_iter_map, visiting,
-                               summary_cmap);
       if (summary_cmap->count(callee) != 0) {
         invoke_to_summary_cmap.emplace(edge->invoke_iterator()->insn,
                                        summary_cmap->at(callee));
@@ -293,10 +291,20 @@ void analyze_scope(
     summary_cmap.insert(pair);
   }
 
-  walk::parallel::code(scope, [&](const DexMethod* method, IRCode& code) {
-    PatriciaTreeSet<const DexMethodRef*> visiting;
-    analyze_method_recursive(method, call_graph, ptrs_fp_iter_map, visiting,
-                             &summary_cmap);
+  // Analyze the callees before their callers, one call graph component at a
+  // time. Methods that already have a summary don't need to be waited for.
+  std::vector<const DexMethod*> methods;
+  walk::code(scope, [&](const DexMethod* method, IRCode&) {
+    methods.push_back(method);
+  });
+  std::sort(methods.begin(), methods.end(), compare_dexmethods);
+  call_graph::SccDag dag(call_graph, methods, [&](const DexMethod* method) {
+    return summary_cmap.count(method) == 0;
+  });
+  dag.run_bottom_up([&](const std::vector<const DexMethod*>& members) {
+    for (auto method : members) {
+      analyze_method(method, call_graph, ptrs_fp_iter_map, &summary_cmap);
+    }
   });
 
   for (auto& pair : summary_cmap) {
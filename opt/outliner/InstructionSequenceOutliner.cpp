@@ -12,20 +12,15 @@
  *
  * At its core is a rather naive approach: check if any subsequence of
  * instructions in a block occurs sufficiently often. The average complexity is
- * held down by filtering out instruction sequences where adjacent sequences of
- * abstracted instructions ("cores") of fixed lengths never occur twice anywhere
- * in the scope (seems good enough, even without a suffix tree).
+ * held down by a suffix array over the abstracted instructions ("cores") of all
+ * blocks in a dex: exploration of a sequence stops as soon as its cores no
+ * longer occur anywhere else, so long sequences are only ever considered when
+ * they actually recur.
  *
  * When reaching a conditional branch or switch instruction, different control-
  * paths are explored as well, as long as they eventually all arrive at a common
  * block. Thus, outline candidates are in fact instruction sequence trees.
  *
- * At its core is a rather naive approach: check if any subsequence of
- * instructions in a block occurs sufficiently often. The average complexity is
- * held down by filtering out instruction sequences where adjacent sequences of
- * abstracted instructions ("cores") of fixed lengths never occur twice anywhere
- * in the scope (seems good enough, even without a suffix tree).
- *
  * We gather existing method/type references in a dex and make sure that we
  * don't go beyond the limits when adding methods/types, effectively filling up
  * the available ref space created by IntraDexInline (minus other reservations).
@@ -98,6 +93,7 @@
 #include "Resolver.h"
 #include "Show.h"
 #include "StlUtil.h"
+#include "SuffixArray.h"
 #include "Trace.h"
 #include "Walkers.h"
 
@@ -338,40 +334,82 @@ static CandidateInstructionCore to_core(IRInstruction* insn) {
   return core;
 }
 
-using CandidateInstructionCores =
-    std::array<CandidateInstructionCore, MIN_INSNS_SIZE>;
-using CandidateInstructionCoresHasher = boost::hash<CandidateInstructionCores>;
-using CandidateInstructionCoresSet =
-    std::unordered_set<CandidateInstructionCores,
-                       CandidateInstructionCoresHasher>;
+// We keep track of outlined methods that reside in earlier dexes of the current
+// store
+using ReusableOutlinedMethods =
+    std::unordered_map<Candidate, std::vector<DexMethod*>, CandidateHasher>;
 
-// The cores builder efficiently keeps track of the last MIN_INSNS_SIZE many
-// instructions.
-class CandidateInstructionCoresBuilder {
+// All instructions of a dex that we may outline from are laid out as a single
+// stream of dense core ids, one big block after another. Instructions that
+// cannot be outlined and the ends of big blocks are represented by unique
+// separators. For every position in the stream, we then know how long the
+// sequence of cores starting there can get while still occurring somewhere
+// else in the stream.
+class RecurringCoreSequences {
  public:
-  void push_back(IRInstruction* insn) {
-    m_buffer[m_start] = to_core(insn);
-    m_start = (m_start + 1) % MIN_INSNS_SIZE;
-    m_size = m_size < MIN_INSNS_SIZE ? m_size + 1 : MIN_INSNS_SIZE;
+  // Appends an instruction to the stream; instructions that cannot be outlined
+  // are recorded as separators.
+  void push_back(IRInstruction* insn, bool can_outline) {
+    m_positions.emplace(insn, m_stream.size());
+    if (can_outline) {
+      auto it = m_core_ids.emplace(to_core(insn), m_next_id).first;
+      if (it->second == m_next_id) {
+        m_next_id++;
+      }
+      m_stream.push_back(it->second);
+    } else {
+      push_separator();
+    }
   }
 
-  void clear() { m_size = 0; }
+  // Appends the cores of an already outlined candidate, so that sequences
+  // that can reuse an outlined method count as recurring.
+  void push_back(const CandidateNode& cn) {
+    for (auto& ci : cn.insns) {
+      auto it = m_core_ids.emplace(ci.core, m_next_id).first;
+      if (it->second == m_next_id) {
+        m_next_id++;
+      }
+      m_stream.push_back(it->second);
+    }
+    push_separator();
+    for (auto& p : cn.succs) {
+      push_back(*p.second);
+    }
+  }
 
-  bool has_value() const { return m_size == MIN_INSNS_SIZE; }
+  void push_separator() { m_stream.push_back(m_next_id++); }
 
-  CandidateInstructionCores get_value() {
-    always_assert(m_size == MIN_INSNS_SIZE);
-    CandidateInstructionCores res;
-    for (size_t i = 0; i < MIN_INSNS_SIZE; i++) {
-      res[i] = m_buffer.at((m_start + i) % MIN_INSNS_SIZE);
+  void compute() {
+    m_repeat_lengths = get_repeat_lengths(m_stream);
+    m_core_ids.clear();
+  }
+
+  size_t size() const { return m_stream.size(); }
+
+  boost::optional<uint32_t> get_position(const IRInstruction* insn) const {
+    auto it = m_positions.find(insn);
+    if (it == m_positions.end()) {
+      return boost::none;
     }
-    return res;
+    return it->second;
+  }
+
+  // Length of the longest sequence of cores starting at the given position
+  // that also occurs elsewhere.
+  uint32_t get_repeat_length(uint32_t position) const {
+    return m_repeat_lengths.at(position);
   }
 
  private:
-  std::array<CandidateInstructionCore, MIN_INSNS_SIZE> m_buffer;
-  size_t m_start{0};
-  size_t m_size{0};
+  std::unordered_map<CandidateInstructionCore,
+                     uint32_t,
+                     CandidateInstructionCoreHasher>
+      m_core_ids;
+  uint32_t m_next_id{0};
+  std::vector<uint32_t> m_stream;
+  std::unordered_map<const IRInstruction*, uint32_t> m_positions;
+  std::vector<uint32_t> m_repeat_lengths;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -770,14 +808,15 @@ static bool explore_candidates_from(
     LazyReachingInitializedsEnvironments& reaching_initializeds,
     const InstructionSequenceOutlinerConfig& config,
     const RefChecker& ref_checker,
-    const CandidateInstructionCoresSet& recurring_cores,
+    const RecurringCoreSequences& recurring_sequences,
     PartialCandidate* pc,
     PartialCandidateNode* pcn,
     big_blocks::InstructionIterator it,
     const big_blocks::InstructionIterator& end,
     const ExploredCallback* explored_callback = nullptr) {
   boost::optional<IROpcode> prev_opcode;
-  CandidateInstructionCoresBuilder cores_builder;
+  boost::optional<uint32_t> start_position;
+  uint32_t length{0};
   auto first_block = it.block();
   auto& cfg = first_block->cfg();
   for (; it != end; prev_opcode = it->insn->opcode(), it++) {
@@ -789,9 +828,18 @@ static bool explore_candidates_from(
         !can_outline_insn(ref_checker, insn)) {
       return false;
     }
-    cores_builder.push_back(insn);
-    if (cores_builder.has_value() &&
-        !recurring_cores.count(cores_builder.get_value())) {
+    auto position = recurring_sequences.get_position(insn);
+    if (!position) {
+      return false;
+    }
+    if (!start_position || *position != *start_position + length) {
+      start_position = position;
+      length = 0;
+    }
+    if (++length >= MIN_INSNS_SIZE &&
+        recurring_sequences.get_repeat_length(*start_position) < length) {
+      // The sequence doesn't occur anywhere else, and neither does any
+      // extension of it.
       return false;
     }
     if (!append_to_partial_candidate(reaching_initializeds, insn, pc, pcn)) {
@@ -829,7 +877,7 @@ static bool explore_candidates_from(
               is_uniquely_reached_via_pred(succ_big_block->get_first_block()));
           auto succ_ii = big_blocks::InstructionIterable(*succ_big_block);
           if (!explore_candidates_from(
-                  reaching_initializeds, config, ref_checker, recurring_cores,
+                  reaching_initializeds, config, ref_checker, recurring_sequences,
                   pc, succ_pcn.get(), succ_ii.begin(), succ_ii.end())) {
             return false;
           }
@@ -897,7 +945,7 @@ static MethodCandidates find_method_candidates(
     bool skip_loops,
     DexMethod* method,
     cfg::ControlFlowGraph& cfg,
-    const CandidateInstructionCoresSet& recurring_cores,
+    const RecurringCoreSequences& recurring_sequences,
     FindCandidatesStats* stats) {
   MethodCandidates candidates;
   Lazy<LivenessFixpointIterator> liveness_fp_iter([&cfg] {
@@ -1125,7 +1173,7 @@ static MethodCandidates find_method_candidates(
       }
       PartialCandidate pc;
       explore_candidates_from(reaching_initializeds, config, ref_checker,
-                              recurring_cores, &pc, &pc.root, it, end,
+                              recurring_sequences, &pc, &pc.root, it, end,
                               &explored_callback);
     }
   }
@@ -1138,7 +1186,7 @@ static MethodCandidates find_method_candidates(
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// get_recurring_cores
+// get_recurring_sequences
 ////////////////////////////////////////////////////////////////////////////////
 
 static bool can_outline_from_method(
@@ -1153,60 +1201,62 @@ static bool can_outline_from_method(
   return true;
 }
 
-// Gather set of recurring small (MIN_INSNS_SIZE) adjacent instruction
-// sequences that are outlinable. Note that all longer recurring outlinable
-// instruction sequences must be comprised of shorter recurring ones.
-static void get_recurring_cores(
+// Lay out all instructions that we may outline from as a stream of cores, and
+// find the recurring sequences in it. Outlined methods of earlier dexes that
+// may be reused are included as well.
+static void get_recurring_sequences(
     PassManager& mgr,
     const Scope& scope,
     const std::unordered_set<DexMethod*>& sufficiently_hot_methods,
     const RefChecker& ref_checker,
-    CandidateInstructionCoresSet* recurring_cores) {
-  ConcurrentMap<CandidateInstructionCores, size_t,
-                CandidateInstructionCoresHasher>
-      concurrent_cores;
+    const ReusableOutlinedMethods* reusable_outlined_methods,
+    RecurringCoreSequences* recurring_sequences) {
+  // Finding out which instructions can be outlined is the expensive part, so
+  // we do that in parallel, and then assemble the stream in a deterministic
+  // order.
+  using OutlinableInsns = std::vector<std::pair<IRInstruction*, bool>>;
+  ConcurrentMap<DexMethod*, std::vector<OutlinableInsns>> method_big_blocks;
   walk::parallel::code(
       scope, [&ref_checker, &sufficiently_hot_methods,
-              &concurrent_cores](DexMethod* method, IRCode& code) {
+              &method_big_blocks](DexMethod* method, IRCode& code) {
         if (!can_outline_from_method(method, sufficiently_hot_methods)) {
           return;
         }
         code.build_cfg(/* editable */ true);
         code.cfg().calculate_exit_block();
         auto& cfg = code.cfg();
+        std::vector<OutlinableInsns> big_blocks_insns;
         for (auto& big_block : big_blocks::get_big_blocks(cfg)) {
-          CandidateInstructionCoresBuilder cores_builder;
+          big_blocks_insns.emplace_back();
+          auto& insns = big_blocks_insns.back();
           for (auto& mie : big_blocks::InstructionIterable(big_block)) {
-            auto insn = mie.insn;
-            if (!can_outline_insn(ref_checker, insn)) {
-              cores_builder.clear();
-              continue;
-            }
-            cores_builder.push_back(insn);
-            if (cores_builder.has_value()) {
-              concurrent_cores.update(cores_builder.get_value(),
-                                      [](const CandidateInstructionCores&,
-                                         size_t& occurrences,
-                                         bool /* exists */) { occurrences++; });
-            }
+            insns.emplace_back(mie.insn, can_outline_insn(ref_checker, mie.insn));
           }
         }
+        method_big_blocks.emplace(method, std::move(big_blocks_insns));
       });
-  size_t singleton_cores{0};
-  for (auto& p : concurrent_cores) {
-    always_assert(p.second > 0);
-    if (p.second > 1) {
-      recurring_cores->insert(p.first);
-    } else {
-      singleton_cores++;
+  walk::code(scope, [&](DexMethod* method, IRCode&) {
+    auto it = method_big_blocks.find(method);
+    if (it == method_big_blocks.end()) {
+      return;
+    }
+    for (auto& insns : it->second) {
+      for (auto& p : insns) {
+        recurring_sequences->push_back(p.first, p.second);
+      }
+      recurring_sequences->push_separator();
+    }
+  });
+  if (reusable_outlined_methods) {
+    // Repeat lengths don't depend on the order in which these are appended.
+    for (auto& p : *reusable_outlined_methods) {
+      recurring_sequences->push_back(p.first.root);
     }
   }
-  mgr.incr_metric("num_singleton_cores", singleton_cores);
-  mgr.incr_metric("num_recurring_cores", recurring_cores->size());
-  TRACE(ISO, 2,
-        "[invoke sequence outliner] %zu singleton cores, %zu recurring "
-        "cores",
-        singleton_cores, recurring_cores->size());
+  recurring_sequences->compute();
+  mgr.incr_metric("num_core_stream_size", recurring_sequences->size());
+  TRACE(ISO, 2, "[invoke sequence outliner] %zu cores in stream",
+        recurring_sequences->size());
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -1218,11 +1268,6 @@ struct CandidateInfo {
   size_t count{0};
 };
 
-// We keep track of outlined methods that reside in earlier dexes of the current
-// store
-using ReusableOutlinedMethods =
-    std::unordered_map<Candidate, std::vector<DexMethod*>, CandidateHasher>;
-
 std::unordered_set<const DexType*> get_declaring_types(
     const CandidateInfo& ci) {
   std::unordered_set<const DexType*> types;
@@ -1407,7 +1452,7 @@ static void get_beneficial_candidates(
     const std::unordered_set<DexMethod*>& sufficiently_warm_methods,
     const std::unordered_set<DexMethod*>& sufficiently_hot_methods,
     const RefChecker& ref_checker,
-    const CandidateInstructionCoresSet& recurring_cores,
+    const RecurringCoreSequences& recurring_sequences,
     const ReusableOutlinedMethods* reusable_outlined_methods,
     std::vector<CandidateWithInfo>* candidates_with_infos,
     std::unordered_map<DexMethod*, std::unordered_set<CandidateId>>*
@@ -1417,7 +1462,7 @@ static void get_beneficial_candidates(
   FindCandidatesStats stats;
   walk::parallel::code(scope, [&config, &sufficiently_warm_methods,
                                &sufficiently_hot_methods, &ref_checker,
-                               &recurring_cores, &concurrent_candidates,
+                               &recurring_sequences, &concurrent_candidates,
                                &stats](DexMethod* method, IRCode& code) {
     if (!can_outline_from_method(method, sufficiently_hot_methods)) {
       return;
@@ -1425,7 +1470,7 @@ static void get_beneficial_candidates(
     bool skip_loops = !!sufficiently_warm_methods.count(method);
     for (auto& p :
          find_method_candidates(config, ref_checker, skip_loops, method,
-                                code.cfg(), recurring_cores, &stats)) {
+                                code.cfg(), recurring_sequences, &stats)) {
       std::vector<CandidateMethodLocation>& cmls = p.second;
       concurrent_candidates.update(p.first,
                                    [method, &cmls](const Candidate&,
@@ -2760,15 +2805,16 @@ void InstructionSequenceOutliner::run_pass(DexStoresVector& stores,
       }
       last_store_idx = store_idx;
       RefChecker ref_checker{&xstores, store_idx, min_sdk_api};
-      CandidateInstructionCoresSet recurring_cores;
-      get_recurring_cores(mgr, dex, sufficiently_hot_methods, ref_checker,
-                          &recurring_cores);
+      RecurringCoreSequences recurring_sequences;
+      get_recurring_sequences(mgr, dex, sufficiently_hot_methods, ref_checker,
+                              reusable_outlined_methods.get(),
+                              &recurring_sequences);
       std::vector<CandidateWithInfo> candidates_with_infos;
       std::unordered_map<DexMethod*, std::unordered_set<CandidateId>>
           candidate_ids_by_methods;
       get_beneficial_candidates(
           m_config, mgr, dex, sufficiently_warm_methods,
-          sufficiently_hot_methods, ref_checker, recurring_cores,
+          sufficiently_hot_methods, ref_checker, recurring_sequences,
           reusable_outlined_methods.get(), &candidates_with_infos,
           &candidate_ids_by_methods);
 
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "SuffixArray.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace outliner_impl {
+
+std::vector<uint32_t> build_suffix_array(const std::vector<uint32_t>& s) {
+  const uint32_t n = s.size();
+  std::vector<uint32_t> sa(n);
+  if (n == 0) {
+    return sa;
+  }
+  std::iota(sa.begin(), sa.end(), 0);
+  std::sort(sa.begin(), sa.end(), [&s](uint32_t a, uint32_t b) {
+    return s[a] != s[b] ? s[a] < s[b] : a < b;
+  });
+
+  // Initial ranks are the dense ranks of the symbols themselves.
+  std::vector<uint32_t> rank(n);
+  uint32_t num_ranks = 1;
+  rank[sa[0]] = 0;
+  for (uint32_t i = 1; i < n; i++) {
+    if (s[sa[i]] != s[sa[i - 1]]) {
+      num_ranks++;
+    }
+    rank[sa[i]] = num_ranks - 1;
+  }
+
+  std::vector<uint32_t> tmp(n);
+  std::vector<uint32_t> counts;
+  for (uint32_t k = 1; num_ranks < n; k <<= 1) {
+    // Order by the second half first: suffixes shorter than k come first, the
+    // others follow in the order of their second half, which is already known.
+    uint32_t p = 0;
+    for (uint32_t i = n - std::min(k, n); i < n; i++) {
+      tmp[p++] = i;
+    }
+    for (uint32_t i = 0; i < n; i++) {
+      if (sa[i] >= k) {
+        tmp[p++] = sa[i] - k;
+      }
+    }
+    // Then do a stable counting sort by the first half.
+    counts.assign(num_ranks + 1, 0);
+    for (uint32_t i = 0; i < n; i++) {
+      counts[rank[i] + 1]++;
+    }
+    for (uint32_t r = 1; r <= num_ranks; r++) {
+      counts[r] += counts[r - 1];
+    }
+    for (uint32_t i = 0; i < n; i++) {
+      sa[counts[rank[tmp[i]]]++] = tmp[i];
+    }
+    // Re-rank by pairs of (first half, second half).
+    auto second = [&rank, n, k](uint32_t i) -> int64_t {
+      return i + k < n ? rank[i + k] : -1;
+    };
+    tmp[sa[0]] = 0;
+    num_ranks = 1;
+    for (uint32_t i = 1; i < n; i++) {
+      auto a = sa[i - 1];
+      auto b = sa[i];
+      if (rank[a] != rank[b] || second(a) != second(b)) {
+        num_ranks++;
+      }
+      tmp[b] = num_ranks - 1;
+    }
+    rank.swap(tmp);
+  }
+  return sa;
+}
+
+std::vector<uint32_t> build_lcp_array(const std::vector<uint32_t>& s,
+                                      const std::vector<uint32_t>& sa) {
+  const uint32_t n = s.size();
+  std::vector<uint32_t> rank(n);
+  for (uint32_t i = 0; i < n; i++) {
+    rank[sa[i]] = i;
+  }
+  std::vector<uint32_t> lcp(n, 0);
+  uint32_t h = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    if (rank[i] == 0) {
+      h = 0;
+      continue;
+    }
+    uint32_t j = sa[rank[i] - 1];
+    while (i + h < n && j + h < n && s[i + h] == s[j + h]) {
+      h++;
+    }
+    lcp[rank[i]] = h;
+    if (h > 0) {
+      h--;
+    }
+  }
+  return lcp;
+}
+
+std::vector<uint32_t> get_repeat_lengths(const std::vector<uint32_t>& s) {
+  auto sa = build_suffix_array(s);
+  auto lcp = build_lcp_array(s, sa);
+  const uint32_t n = s.size();
+  std::vector<uint32_t> res(n);
+  for (uint32_t i = 0; i < n; i++) {
+    res[sa[i]] = std::max(lcp[i], i + 1 < n ? lcp[i + 1] : 0);
+  }
+  return res;
+}
+
+} // namespace outliner_impl
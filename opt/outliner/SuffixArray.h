@@ -0,0 +1,33 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace outliner_impl {
+
+// Computes the suffix array of the given sequence, i.e. the starting positions
+// of all suffixes in lexicographic order. Symbols can be arbitrary values.
+// This uses prefix doubling with radix sorting; the number of rounds is
+// logarithmic in the length of the longest repeated subsequence, so sequences
+// with many unique separator symbols are handled in close to linear time.
+std::vector<uint32_t> build_suffix_array(const std::vector<uint32_t>& s);
+
+// Computes the longest-common-prefix array for a suffix array (Kasai et al.):
+// lcp[i] is the length of the longest common prefix of the suffixes starting
+// at sa[i - 1] and sa[i], and lcp[0] is zero.
+std::vector<uint32_t> build_lcp_array(const std::vector<uint32_t>& s,
+                                      const std::vector<uint32_t>& sa);
+
+// For each position in the given sequence, computes the length of the longest
+// subsequence starting there that also occurs at some other position
+// (possibly overlapping).
+std::vector<uint32_t> get_repeat_lengths(const std::vector<uint32_t>& s);
+
+} // namespace outliner_impl
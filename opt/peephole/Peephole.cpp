@@ -1683,11 +1683,79 @@ bool contains(const std::vector<T>& vec, const T& value) {
   return std::find(vec.begin(), vec.end(), value) != vec.end();
 }
 
+/*
+ * An opcode-indexed automaton over the match sequences of all patterns. A
+ * state is a pattern together with the number of its instructions matched so
+ * far; only opcodes are checked, so reaching the end of a pattern means that
+ * the block has a run of consecutive instructions that may match it, but the
+ * registers, operands and predicate still have to be checked by the Matcher.
+ * One walk over a method finds the candidates of all patterns at once.
+ */
+class PatternAutomaton {
+ public:
+  explicit PatternAutomaton(const std::vector<Matcher>& matchers) {
+    m_patterns.reserve(matchers.size());
+    for (size_t i = 0; i < matchers.size(); ++i) {
+      const auto& pattern = matchers[i].pattern;
+      m_patterns.push_back(&pattern);
+      for (auto opcode : pattern.match.at(0).opcodes) {
+        m_starts[opcode].push_back(i);
+      }
+    }
+  }
+
+  // Flags the patterns that have a candidate match in the given cfg.
+  void find_candidates(const cfg::ControlFlowGraph& cfg,
+                       std::vector<bool>* candidates) const {
+    candidates->assign(m_patterns.size(), false);
+    // (pattern index, number of matched instructions)
+    std::vector<std::pair<size_t, size_t>> states;
+    std::vector<std::pair<size_t, size_t>> next_states;
+    auto advance = [&](size_t i, size_t matched) {
+      if (matched == m_patterns[i]->match.size()) {
+        (*candidates)[i] = true;
+      } else {
+        next_states.emplace_back(i, matched);
+      }
+    };
+    for (const auto& block : cfg.blocks()) {
+      // As with the matchers, no pattern spans over multiple blocks.
+      states.clear();
+      for (const auto& mie : InstructionIterable(block)) {
+        uint16_t opcode = mie.insn->opcode();
+        next_states.clear();
+        for (const auto& state : states) {
+          size_t i = state.first;
+          const auto& dex_pattern = m_patterns[i]->match[state.second];
+          if (!(*candidates)[i] && dex_pattern.opcodes.count(opcode)) {
+            advance(i, state.second + 1);
+          }
+        }
+        auto it = m_starts.find(opcode);
+        if (it != m_starts.end()) {
+          for (size_t i : it->second) {
+            if (!(*candidates)[i]) {
+              advance(i, 1);
+            }
+          }
+        }
+        std::swap(states, next_states);
+      }
+    }
+  }
+
+ private:
+  std::vector<const Pattern*> m_patterns;
+  // Opcode to the patterns whose first instruction may have that opcode.
+  std::unordered_map<uint16_t, std::vector<size_t>> m_starts;
+};
+
 // Each thread will have its own instance of PeepholeOptimizer, so align it in
 // order to avoid false sharing.
 class alignas(CACHE_LINE_SIZE) PeepholeOptimizer {
  private:
   std::vector<Matcher> m_matchers;
+  std::unique_ptr<PatternAutomaton> m_automaton;
   std::vector<size_t> m_stats;
   PassManager& m_mgr;
   int m_stats_removed = 0;
@@ -1721,6 +1789,7 @@ class alignas(CACHE_LINE_SIZE) PeepholeOptimizer {
         }
       }
     }
+    m_automaton = std::make_unique<PatternAutomaton>(m_matchers);
     m_stats.resize(m_matchers.size(), 0);
   }
 
@@ -1732,10 +1801,20 @@ class alignas(CACHE_LINE_SIZE) PeepholeOptimizer {
     code->build_cfg(/* editable */ true);
     auto& cfg = code->cfg();
 
+    // Only the patterns with candidates need to walk the method. A
+    // replacement creates new runs of instructions, so the candidates are
+    // recomputed after each pattern that changed the code.
+    std::vector<bool> candidates;
+    m_automaton->find_candidates(cfg, &candidates);
+
     // do optimizations one at a time
     // so they can match on the same pattern without interfering
     for (size_t i = 0; i < m_matchers.size(); ++i) {
+      if (!candidates[i]) {
+        continue;
+      }
       auto& matcher = m_matchers[i];
+      bool changed = false;
 
       const auto& blocks = cfg.blocks();
       cfg::CFGMutation mutator(cfg);
@@ -1787,11 +1866,15 @@ class alignas(CACHE_LINE_SIZE) PeepholeOptimizer {
                                matcher.matched_instructions.end());
           m_stats_removed += matcher.match_index;
           matcher.reset();
+          changed = true;
         }
       }
 
       // Apply the mutator.
       mutator.flush();
+      if (changed) {
+        m_automaton->find_candidates(cfg, &candidates);
+      }
     }
 
     code->clear_cfg();
@@ -316,6 +316,9 @@ Allocator::Stats& Allocator::Stats::operator+=(const Allocator::Stats& that) {
   split_moves += that.split_moves;
   moves_coalesced += that.moves_coalesced;
   params_spill_early += that.params_spill_early;
+  linear_scan_allocations += that.linear_scan_allocations;
+  linear_scan_fallbacks += that.linear_scan_fallbacks;
+  graph_coloring_allocations += that.graph_coloring_allocations;
   return *this;
 }
 
@@ -1054,6 +1057,70 @@ static void dedicate_this_register(DexMethod* method) {
   }
 }
 
+/*
+ * A fast tier for small methods: given the coalesced interference graph of the
+ * first iteration of allocate(), assign each symreg the lowest vreg not taken
+ * by an already assigned neighbor, in the order in which the symregs are first
+ * defined. This skips simplification and the spill / split / rebuild loop
+ * altogether, which is what dominates for the many methods whose register
+ * pressure is low.
+ *
+ * Symregs that can use all 16 bits are assigned after the constrained ones,
+ * and params are placed at the end of the frame, just like in the full
+ * allocator. If any symreg would need to be spilled, false is returned, the
+ * code is left as it is, and allocate() continues with graph coloring on the
+ * same graph.
+ */
+bool Allocator::try_linear_scan(DexMethod* method,
+                                const interference::Graph& ig) {
+  IRCode* code = method->get_code();
+
+  // Collect the symregs in order of their first definition.
+  std::vector<reg_t> constrained;
+  std::vector<reg_t> unconstrained;
+  std::unordered_set<reg_t> seen;
+  for (const auto& mie : InstructionIterable(code)) {
+    auto* insn = mie.insn;
+    if (!insn->has_dest() || !seen.emplace(insn->dest()).second) {
+      continue;
+    }
+    const auto& node = ig.get_node(insn->dest());
+    if (!node.is_active() || node.is_param() || node.is_range()) {
+      continue;
+    }
+    if (node.max_vreg() < max_unsigned_value(16)) {
+      constrained.push_back(insn->dest());
+    } else {
+      unconstrained.push_back(insn->dest());
+    }
+  }
+  // select() pops from the top, so push in reverse order.
+  auto to_stack = [](const std::vector<reg_t>& regs) {
+    std::stack<reg_t> stack;
+    for (auto it = regs.rbegin(); it != regs.rend(); ++it) {
+      stack.push(*it);
+    }
+    return stack;
+  };
+
+  RegisterTransform reg_transform;
+  SpillPlan spill_plan;
+  auto select_stack = to_stack(constrained);
+  select(code, ig, &select_stack, &reg_transform, &spill_plan);
+  auto unconstrained_stack = to_stack(unconstrained);
+  select(code, ig, &unconstrained_stack, &reg_transform, &spill_plan);
+  select_params(method, ig, &reg_transform, &spill_plan);
+  if (!spill_plan.empty()) {
+    TRACE(REG, 5, "Linear scan needs spills, falling back:\n%s",
+          SHOW(spill_plan));
+    return false;
+  }
+  TRACE(REG, 5, "Linear scan transform:\n%s", SHOW(reg_transform));
+  transform::remap_registers(code, reg_transform.map);
+  code->set_registers_size(reg_transform.size);
+  return true;
+}
+
 /*
  * Main differences from the standard Chaitin-Briggs
  * build-coalesce-simplify-spill loop:
@@ -1084,6 +1151,14 @@ void Allocator::allocate(DexMethod* method) {
   if (no_overwrite_this) {
     dedicate_this_register(method);
   }
+
+  bool linear_scan = range_set.size() == 0 &&
+                     m_config.linear_scan_max_registers > 0 &&
+                     initial_regs <= m_config.linear_scan_max_registers;
+  if (!linear_scan) {
+    ++m_stats.graph_coloring_allocations;
+  }
+
   bool first{true};
   while (true) {
     SplitCosts split_costs;
@@ -1097,8 +1172,9 @@ void Allocator::allocate(DexMethod* method) {
     fixpoint_iter.run(LivenessDomain());
 
     TRACE(REG, 5, "Allocating:\n%s", ::SHOW(code->cfg()));
-    auto ig =
-        interference::build_graph(fixpoint_iter, code, initial_regs, range_set);
+    auto ig = interference::build_graph(fixpoint_iter, code, initial_regs,
+                                        range_set,
+                                        m_config.use_interference_bit_matrix);
 
     // Make the `this` symreg conflict with every other one so that it never
     // gets overwritten in the method. See check_no_overwrite_this in
@@ -1114,6 +1190,15 @@ void Allocator::allocate(DexMethod* method) {
     if (first) {
       coalesce(&ig, code);
       first = false;
+      if (linear_scan) {
+        if (try_linear_scan(method, ig)) {
+          ++m_stats.linear_scan_allocations;
+          TRACE(REG, 3, "Allocated by linear scan");
+          return;
+        }
+        ++m_stats.linear_scan_fallbacks;
+        ++m_stats.graph_coloring_allocations;
+      }
       // After coalesce the live_out and live_in of blocks may change, so run
       // LivenessFixpointIterator again.
       fixpoint_iter.run(LivenessDomain());
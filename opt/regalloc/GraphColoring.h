@@ -83,6 +83,14 @@ class Allocator {
   struct Config {
     bool no_overwrite_this{false};
     bool use_splitting{false};
+    // Methods with at most this many symbolic registers and no range
+    // instructions are first allocated greedily, see try_linear_scan(). When
+    // that needs spills, graph coloring continues from the same interference
+    // graph. Zero disables that tier.
+    size_t linear_scan_max_registers{0};
+    // Build interference graphs with bit matrices instead of hash sets; see
+    // interference::impl::GraphBuilder::build_dense().
+    bool use_interference_bit_matrix{false};
   };
 
   struct Stats {
@@ -93,6 +101,11 @@ class Allocator {
     size_t split_moves{0};
     size_t moves_coalesced{0};
     size_t params_spill_early{0};
+    // Methods allocated by the greedy tier, methods for which it was tried
+    // but needed spills, and methods allocated by graph coloring.
+    size_t linear_scan_allocations{0};
+    size_t linear_scan_fallbacks{0};
+    size_t graph_coloring_allocations{0};
     size_t moves_inserted() const {
       return param_spill_moves + range_spill_moves + global_spill_moves +
              split_moves;
@@ -151,6 +164,8 @@ class Allocator {
              const RangeSet&,
              IRCode*);
 
+  bool try_linear_scan(DexMethod*, const interference::Graph&);
+
   void allocate(DexMethod*);
 
   const Stats& get_stats() const { return m_stats; }
@@ -50,6 +50,34 @@ uint32_t edge_weight_helper(uint8_t u_width, uint8_t v_width) {
   return ((v_width - 1) >> (u_width - 1)) + 1;
 }
 
+void BitMatrix::set_row(reg_t u, const DenseRegSet& set) {
+  const auto& words = set.words();
+  auto* row = m_words.data() + u * m_words_per_row;
+  for (size_t w = 0; w < words.size(); ++w) {
+    row[w] |= words[w];
+  }
+}
+
+TriangularBitMatrix::TriangularBitMatrix(size_t n) : m_row_offsets(n + 1) {
+  m_row_offsets[0] = 0;
+  for (size_t u = 0; u < n; ++u) {
+    m_row_offsets[u + 1] = m_row_offsets[u] + (u + 63) / 64;
+  }
+  m_words.resize(m_row_offsets[n]);
+}
+
+void TriangularBitMatrix::set_row(reg_t u, const DenseRegSet& set) {
+  const auto& words = set.words();
+  auto* row = m_words.data() + m_row_offsets[u];
+  size_t full_words = u / 64;
+  for (size_t w = 0; w < full_words; ++w) {
+    row[w] |= words[w];
+  }
+  if (u % 64 != 0) {
+    row[full_words] |= words[full_words] & ((uint64_t(1) << (u % 64)) - 1);
+  }
+}
+
 } // namespace impl
 
 using namespace impl;
@@ -80,6 +108,13 @@ void Graph::add_edge(reg_t u, reg_t v, bool can_coalesce) {
     u_node.m_weight += edge_weight(u_node, v_node);
     v_node.m_weight += edge_weight(v_node, u_node);
   }
+  if (m_dense) {
+    m_adjacent_bits.set(std::max(u, v), std::min(u, v));
+    if (!can_coalesce) {
+      m_non_coalesceable_bits.set(std::max(u, v), std::min(u, v));
+    }
+    return;
+  }
   // If we have one instruction that creates a coalesceable edge between two
   // nodes s0 and s1, and another that creates a non-coalesceable edge, those
   // edges combined must be non-coalesceable. For example, if we have
@@ -349,6 +384,135 @@ Graph GraphBuilder::build(const LivenessFixpointIterator& fixpoint_iter,
   return graph;
 }
 
+namespace {
+
+/*
+ * Records interference edges between :reg and all registers in :live, in both
+ * matrices. Edges to lower registers are merged word by word into :reg's row;
+ * edges to higher registers go into their respective rows.
+ */
+void add_dense_edges(reg_t reg,
+                     const DenseRegSet& live,
+                     TriangularBitMatrix* adjacent_bits,
+                     TriangularBitMatrix* non_coalesceable_bits) {
+  adjacent_bits->set_row(reg, live);
+  non_coalesceable_bits->set_row(reg, live);
+  const auto& words = live.words();
+  size_t start = size_t(reg) + 1;
+  for (size_t w = start / 64; w < words.size(); ++w) {
+    uint64_t word = words[w];
+    if (w == start / 64) {
+      word &= ~((uint64_t(1) << (start % 64)) - 1);
+    }
+    for (; word != 0; word &= word - 1) {
+      reg_t other = w * 64 + __builtin_ctzll(word);
+      adjacent_bits->set(other, reg);
+      non_coalesceable_bits->set(other, reg);
+    }
+  }
+}
+
+} // namespace
+
+Graph GraphBuilder::build_dense(const LivenessFixpointIterator& fixpoint_iter,
+                                IRCode* code,
+                                reg_t initial_regs,
+                                const RangeSet& range_set) {
+  Graph graph;
+  auto ii = InstructionIterable(code);
+  for (auto it = ii.begin(); it != ii.end(); ++it) {
+    GraphBuilder::update_node_constraints(it.unwrap(), range_set, &graph);
+  }
+
+  size_t regs_size = code->get_registers_size();
+  graph.m_adjacent_bits = TriangularBitMatrix(regs_size);
+  graph.m_non_coalesceable_bits = TriangularBitMatrix(regs_size);
+  graph.m_containment_bits = BitMatrix(regs_size);
+
+  // This mirrors build(), see there for the rationale of the individual
+  // edges. The live registers are tracked in a DenseRegSet alongside the
+  // LivenessDomain, which is only still needed for instructions that may take
+  // the range form.
+  DenseRegSet live(regs_size);
+  auto& cfg = code->cfg();
+  for (cfg::Block* block : cfg.blocks()) {
+    LivenessDomain live_out = fixpoint_iter.get_live_out_vars_at(block);
+    live.clear();
+    for (auto reg : live_out.elements()) {
+      live.add(reg);
+    }
+    for (auto it = block->rbegin(); it != block->rend(); ++it) {
+      if (it->type != MFLOW_OPCODE) {
+        continue;
+      }
+      auto insn = it->insn;
+      auto op = insn->opcode();
+      if (opcode::has_range_form(op)) {
+        graph.m_range_liveness.emplace(insn, live_out);
+      }
+      if (insn->has_dest()) {
+        auto dest = insn->dest();
+        bool skip_src = opcode::is_a_move(op) && live.contains(insn->src(0));
+        if (skip_src) {
+          live.remove(insn->src(0));
+        }
+        add_dense_edges(dest, live, &graph.m_adjacent_bits,
+                        &graph.m_non_coalesceable_bits);
+        if (skip_src) {
+          live.add(insn->src(0));
+        }
+        for (size_t i = 0; i < insn->srcs_size(); ++i) {
+          auto src = insn->src(i);
+          if (insn->src_is_wide(i) && src != dest) {
+            graph.m_adjacent_bits.set(std::max(dest, src), std::min(dest, src));
+          }
+        }
+      }
+      if (op == OPCODE_CHECK_CAST) {
+        auto move_result_pseudo = std::prev(it)->insn;
+        add_dense_edges(move_result_pseudo->dest(), live,
+                        &graph.m_adjacent_bits,
+                        &graph.m_non_coalesceable_bits);
+      }
+      if (insn->has_dest()) {
+        graph.m_containment_bits.set_row(insn->dest(), live);
+        live.remove(insn->dest());
+      }
+      fixpoint_iter.analyze_instruction(it->insn, &live_out);
+      for (size_t i = 0; i < insn->srcs_size(); ++i) {
+        live.add(insn->src(i));
+      }
+      for (size_t i = 0; i < insn->srcs_size(); ++i) {
+        graph.m_containment_bits.set_row(insn->src(i), live);
+      }
+    }
+  }
+
+  // Now derive the adjacency vectors and weights from the matrix.
+  graph.m_adjacent_bits.for_each([&graph](reg_t u, reg_t v) {
+    auto& u_node = graph.m_nodes.at(u);
+    auto& v_node = graph.m_nodes.at(v);
+    u_node.m_adjacent.push_back(v);
+    v_node.m_adjacent.push_back(u);
+    u_node.m_weight += graph.edge_weight(u_node, v_node);
+    v_node.m_weight += graph.edge_weight(v_node, u_node);
+  });
+  graph.m_dense = true;
+
+  for (auto& pair : graph.nodes()) {
+    auto reg = pair.first;
+    auto& node = pair.second;
+    if (reg >= initial_regs) {
+      node.m_props.set(Node::SPILL);
+    }
+    assert_log(!node.m_type_domain.is_bottom(),
+               "Type violation of v%u in code:\n%s\n",
+               reg,
+               SHOW(code));
+  }
+  return graph;
+}
+
 std::ostream& Graph::write_dot_format(std::ostream& o) const {
   o << "graph {\n";
   for (const auto& pair : nodes()) {
@@ -365,6 +529,15 @@ std::ostream& Graph::write_dot_format(std::ostream& o) const {
   o << "}\n";
 
   o << "containment graph {\n";
+  if (m_dense) {
+    for (const auto& u : nodes()) {
+      for (const auto& v : nodes()) {
+        if (has_containment_edge(u.first, v.first)) {
+          o << u.first << " -- " << v.first << "\n";
+        }
+      }
+    }
+  }
   for (const auto& pair : m_containment_graph) {
     reg_t reg1 = static_cast<reg_t>((pair & 0xFFFFFFFF00000000) >> 32);
     reg_t reg2 = static_cast<reg_t>(pair & 0x00000000FFFFFFFF);
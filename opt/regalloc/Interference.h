@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <boost/functional/hash.hpp>
 #include <boost/range/adaptor/filtered.hpp>
 #include <unordered_map>
@@ -88,6 +89,82 @@ inline reg_pair_t build_edge(reg_t u, reg_t v) {
   return (hi << (sizeof(reg_t) * 8)) | lo;
 }
 
+/*
+ * A set of registers as a plain bitset, so that it can be merged into the bit
+ * matrices below a word at a time.
+ */
+class DenseRegSet {
+ public:
+  DenseRegSet() = default;
+  explicit DenseRegSet(size_t n) : m_words((n + 63) / 64) {}
+  bool contains(reg_t r) const { return (m_words[r / 64] >> (r % 64)) & 1; }
+  void add(reg_t r) { m_words[r / 64] |= uint64_t(1) << (r % 64); }
+  void remove(reg_t r) { m_words[r / 64] &= ~(uint64_t(1) << (r % 64)); }
+  void clear() { std::fill(m_words.begin(), m_words.end(), 0); }
+  const std::vector<uint64_t>& words() const { return m_words; }
+
+ private:
+  std::vector<uint64_t> m_words;
+};
+
+/*
+ * A square matrix of bits.
+ */
+class BitMatrix {
+ public:
+  BitMatrix() = default;
+  explicit BitMatrix(size_t n)
+      : m_words_per_row((n + 63) / 64), m_words(n * m_words_per_row) {}
+  bool get(reg_t u, reg_t v) const {
+    return (m_words[u * m_words_per_row + v / 64] >> (v % 64)) & 1;
+  }
+  void set(reg_t u, reg_t v) {
+    m_words[u * m_words_per_row + v / 64] |= uint64_t(1) << (v % 64);
+  }
+  // Sets (u, v) for all v in the given set.
+  void set_row(reg_t u, const DenseRegSet& set);
+
+ private:
+  size_t m_words_per_row{0};
+  std::vector<uint64_t> m_words;
+};
+
+/*
+ * A lower triangular matrix of bits, holding (u, v) for u > v. Each row starts
+ * at a word boundary, so that a row can be merged with a DenseRegSet a word
+ * at a time.
+ */
+class TriangularBitMatrix {
+ public:
+  TriangularBitMatrix() = default;
+  explicit TriangularBitMatrix(size_t n);
+  bool get(reg_t u, reg_t v) const {
+    return (m_words[m_row_offsets[u] + v / 64] >> (v % 64)) & 1;
+  }
+  void set(reg_t u, reg_t v) {
+    m_words[m_row_offsets[u] + v / 64] |= uint64_t(1) << (v % 64);
+  }
+  // Sets (u, v) for all v < u in the given set.
+  void set_row(reg_t u, const DenseRegSet& set);
+  // Calls fn(u, v) for all set bits, in lexicographic order.
+  template <class Fn>
+  void for_each(const Fn& fn) const {
+    for (size_t u = 1; u + 1 < m_row_offsets.size(); ++u) {
+      for (size_t w = m_row_offsets[u]; w < m_row_offsets[u + 1]; ++w) {
+        for (uint64_t word = m_words[w]; word != 0; word &= word - 1) {
+          fn(static_cast<reg_t>(u),
+             static_cast<reg_t>((w - m_row_offsets[u]) * 64 +
+                                __builtin_ctzll(word)));
+        }
+      }
+    }
+  }
+
+ private:
+  std::vector<size_t> m_row_offsets;
+  std::vector<uint64_t> m_words;
+};
+
 } // namespace impl
 
 class Node {
@@ -191,14 +268,24 @@ class Graph {
   }
 
   bool is_adjacent(reg_t u, reg_t v) const {
+    if (m_dense) {
+      return u != v && m_adjacent_bits.get(std::max(u, v), std::min(u, v));
+    }
     return m_adj_matrix.find(impl::build_edge(u, v)) != m_adj_matrix.end();
   }
 
   bool is_coalesceable(reg_t u, reg_t v) const {
+    if (m_dense) {
+      return !is_adjacent(u, v) ||
+             !m_non_coalesceable_bits.get(std::max(u, v), std::min(u, v));
+    }
     return !is_adjacent(u, v) || !m_adj_matrix.at(impl::build_edge(u, v));
   }
 
   bool has_containment_edge(reg_t u, reg_t v) const {
+    if (m_dense) {
+      return u != v && m_containment_bits.get(u, v);
+    }
     return m_containment_graph.find(impl::build_containment_edge(u, v)) !=
            m_containment_graph.end();
   }
@@ -233,6 +320,10 @@ class Graph {
     if (u == v) {
       return;
     }
+    if (m_dense) {
+      m_containment_bits.set(u, v);
+      return;
+    }
     m_containment_graph.emplace(impl::build_containment_edge(u, v));
   }
 
@@ -240,6 +331,12 @@ class Graph {
   std::unordered_map<reg_t, Node> m_nodes;
   std::unordered_map<reg_pair_t, bool> m_adj_matrix;
   std::unordered_set<reg_pair_t> m_containment_graph;
+  // When the graph was built with bit matrices, they replace the hash-based
+  // edge sets above; the nodes still keep adjacency vectors.
+  bool m_dense{false};
+  impl::TriangularBitMatrix m_adjacent_bits;
+  impl::TriangularBitMatrix m_non_coalesceable_bits;
+  impl::BitMatrix m_containment_bits;
   // This map contains the LivenessDomains for all instructions which could
   // potentialy take on the /range format.
   std::unordered_map<IRInstruction*, LivenessDomain> m_range_liveness;
@@ -282,6 +379,15 @@ class GraphBuilder {
                      reg_t initial_regs,
                      const RangeSet&);
 
+  // Same as build(), but records edges in bit matrices indexed by register,
+  // merging whole liveness words at once instead of inserting edge by edge.
+  // This is the classic Chaitin representation; it pays off for large methods
+  // but needs quadratic space in the number of registers.
+  static Graph build_dense(const LivenessFixpointIterator&,
+                           IRCode*,
+                           reg_t initial_regs,
+                           const RangeSet&);
+
   // For unit tests
   static Graph create_empty() { return Graph(); }
   static void make_node(Graph*, reg_t, RegisterType, vreg_t max_vreg);
@@ -292,10 +398,22 @@ uint32_t edge_weight_helper(uint8_t, uint8_t);
 
 } // namespace impl
 
+/*
+ * Methods with more registers than this always use the hash-based
+ * representation, as the bit matrices would get too large.
+ */
+constexpr size_t MAX_BIT_MATRIX_REGISTERS = 8192;
+
 inline Graph build_graph(const LivenessFixpointIterator& fixpoint_iter,
                          IRCode* code,
                          reg_t initial_regs,
-                         const RangeSet& range_set) {
+                         const RangeSet& range_set,
+                         bool use_bit_matrix = false) {
+  if (use_bit_matrix &&
+      code->get_registers_size() <= MAX_BIT_MATRIX_REGISTERS) {
+    return impl::GraphBuilder::build_dense(fixpoint_iter, code, initial_regs,
+                                           range_set);
+  }
   return impl::GraphBuilder::build(
       fixpoint_iter, code, initial_regs, range_set);
 }
@@ -70,6 +70,10 @@ void RegAllocPass::run_pass(DexStoresVector& stores,
   graph_coloring::Allocator::Config allocator_config;
   const auto& jw = mgr.get_current_pass_info()->config;
   jw.get("live_range_splitting", false, allocator_config.use_splitting);
+  jw.get("linear_scan_max_registers", 0,
+         allocator_config.linear_scan_max_registers);
+  jw.get("interference_bit_matrix", false,
+         allocator_config.use_interference_bit_matrix);
   allocator_config.no_overwrite_this =
       mgr.get_redex_options().no_overwrite_this();
 
@@ -86,12 +90,22 @@ void RegAllocPass::run_pass(DexStoresVector& stores,
   TRACE(REG, 1, "  Total splits: %lu", stats.split_moves);
   TRACE(REG, 1, "Total coalesce count: %lu", stats.moves_coalesced);
   TRACE(REG, 1, "Total net moves: %ld", stats.net_moves());
+  TRACE(REG, 1, "Methods allocated by linear scan: %lu",
+        stats.linear_scan_allocations);
+  TRACE(REG, 1, "  Fallbacks to graph coloring: %lu",
+        stats.linear_scan_fallbacks);
+  TRACE(REG, 1, "Methods allocated by graph coloring: %lu",
+        stats.graph_coloring_allocations);
 
   mgr.incr_metric("param spilled too early", stats.params_spill_early);
   mgr.incr_metric("reiteration_count", stats.reiteration_count);
   mgr.incr_metric("spill_count", stats.moves_inserted());
   mgr.incr_metric("coalesce_count", stats.moves_coalesced);
   mgr.incr_metric("net_moves", stats.net_moves());
+  mgr.incr_metric("linear_scan_allocations", stats.linear_scan_allocations);
+  mgr.incr_metric("linear_scan_fallbacks", stats.linear_scan_fallbacks);
+  mgr.incr_metric("graph_coloring_allocations",
+                  stats.graph_coloring_allocations);
 
   mgr.record_running_regalloc();
 }
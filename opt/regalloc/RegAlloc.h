@@ -21,6 +21,9 @@ class RegAllocPass : public Pass {
   void bind_config() override {
     bool unused;
     bind("live_range_splitting", false, unused);
+    size_t unused_size;
+    bind("linear_scan_max_registers", 0, unused_size);
+    bind("interference_bit_matrix", false, unused);
     trait(Traits::Pass::atleast, 1);
   }
 
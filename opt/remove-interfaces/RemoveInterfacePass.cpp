@@ -11,6 +11,7 @@
 #include "DexStoreUtil.h"
 #include "DexUtil.h"
 #include "PassManager.h"
+#include "ReferenceIndex.h"
 #include "Resolver.h"
 #include "Show.h"
 #include "SwitchDispatch.h"
@@ -145,24 +146,23 @@ DexMethod* generate_dispatch(const DexType* base_type,
   return materialized_dispatch(dispatch_owner, mc);
 }
 
+/**
+ * The calls are found through the index, which resolved them before any
+ * interface was removed. The index keeps listing them under the interface
+ * methods, which nothing queries again.
+ */
 void update_interface_calls(
-    const Scope& scope,
+    const reference_index::Index& index,
     const std::unordered_map<DexMethod*, DexMethod*>& old_to_new_callee) {
-  auto patcher = [&old_to_new_callee](DexMethod* meth, IRInstruction* insn) {
-    if (!insn->has_method()) {
-      return;
+  for (const auto& pair : old_to_new_callee) {
+    auto new_callee = pair.second;
+    for (const auto& use : index.callers_of(pair.first)) {
+      auto insn = use.insn;
+      TRACE(RM_INTF, 9, "Updated call %s to %s", SHOW(insn), SHOW(new_callee));
+      insn->set_method(new_callee);
+      insn->set_opcode(OPCODE_INVOKE_STATIC);
     }
-    const auto method =
-        resolve_method(insn->get_method(), opcode_to_search(insn), meth);
-    if (method == nullptr || old_to_new_callee.count(method) == 0) {
-      return;
-    }
-    auto new_callee = old_to_new_callee.at(method);
-    TRACE(RM_INTF, 9, "Updated call %s to %s", SHOW(insn), SHOW(new_callee));
-    insn->set_method(new_callee);
-    insn->set_opcode(OPCODE_INVOKE_STATIC);
-  };
-  walk::parallel::opcodes(scope, patcher);
+  }
 }
 
 /**
@@ -226,48 +226,27 @@ void remove_interface_references(
     const Scope& scope,
     const TypeSystem& type_system,
     const DexType* root,
-    const std::unordered_set<const DexType*>& interfaces) {
-
-  auto patcher = [&](DexMethod*, IRInstruction* insn) {
-    if (!insn->has_type()) {
-      return;
-    }
-    const auto ref_type = insn->get_type();
-    auto type = type::get_element_type_if_array(ref_type);
-    if (interfaces.count(type) == 0) {
-      return;
-    }
-    auto opcode = insn->opcode();
-    always_assert_log(!is_opcode_excluded(opcode),
-                      "Unexpected opcode %s on %s\n", SHOW(opcode), SHOW(type));
-    always_assert(type_class(type));
-    auto new_type = get_replacement_type(type_system, type, root);
-    if (type::is_array(ref_type)) {
-      const auto array_merger_type = type::make_array_type(new_type);
-      insn->set_type(array_merger_type);
-      TRACE(RM_INTF,
-            9,
-            " removing %s referencing array type of %s",
-            SHOW(insn),
-            SHOW(type));
-    } else {
-      insn->set_type(const_cast<DexType*>(new_type));
-      TRACE(RM_INTF, 9, " removing %s referencing %s", SHOW(insn), SHOW(type));
-    }
-  };
-
-  walk::parallel::opcodes(scope, patcher);
-
+    const std::unordered_set<const DexType*>& interfaces,
+    reference_index::Index& index) {
   std::unordered_map<const DexType*, DexType*> old_to_new;
   for (const auto intf : interfaces) {
+    for (const auto& use : index.type_uses(intf)) {
+      auto opcode = use.insn->opcode();
+      always_assert_log(!is_opcode_excluded(opcode),
+                        "Unexpected opcode %s on %s\n", SHOW(opcode),
+                        SHOW(intf));
+    }
+    always_assert(type_class(intf));
     auto new_type = get_replacement_type(type_system, intf, root);
     old_to_new[intf] = const_cast<DexType*>(new_type);
   }
+  auto num_updated = index.update_type_refs(old_to_new);
+  TRACE(RM_INTF, 5, "Updated %zu type references", num_updated);
   auto& parent_to_children =
       type_system.get_class_scopes().get_parent_to_children();
   update_method_signature_type_references(scope, old_to_new,
                                           parent_to_children);
-  update_field_type_references(scope, old_to_new);
+  index.update_field_type_references(old_to_new);
 }
 
 size_t exclude_unremovables(const Scope& scope,
@@ -454,7 +433,8 @@ TypeSet RemoveInterfacePass::remove_leaf_interfaces(
     const Scope& scope,
     const DexType* root,
     const TypeSet& interfaces,
-    const TypeSystem& type_system) {
+    const TypeSystem& type_system,
+    const reference_index::Index& index) {
   TypeSet leaf_interfaces;
   for (const auto intf : interfaces) {
     if (is_leaf(type_system, intf)) {
@@ -482,7 +462,7 @@ TypeSet RemoveInterfacePass::remove_leaf_interfaces(
       intf_meth_to_dispatch[meth] = dispatch;
     }
   }
-  update_interface_calls(scope, intf_meth_to_dispatch);
+  update_interface_calls(index, intf_meth_to_dispatch);
   remove_inheritance(scope, type_system, leaf_interfaces);
   m_num_interface_removed += leaf_interfaces.size();
   return leaf_interfaces;
@@ -492,7 +472,8 @@ void RemoveInterfacePass::remove_interfaces_for_root(
     const Scope& scope,
     const DexStoresVector& stores,
     const DexType* root,
-    const TypeSystem& type_system) {
+    const TypeSystem& type_system,
+    reference_index::Index& index) {
   TRACE(RM_INTF, 5, "Processing root %s", SHOW(root));
   TypeSet interfaces;
   type_system.get_all_interface_children(root, interfaces);
@@ -504,7 +485,7 @@ void RemoveInterfacePass::remove_interfaces_for_root(
 
   TRACE(RM_INTF, 5, "removable interfaces %ld", interfaces.size());
   TypeSet removed =
-      remove_leaf_interfaces(scope, root, interfaces, type_system);
+      remove_leaf_interfaces(scope, root, interfaces, type_system, index);
 
   while (!removed.empty()) {
     for (const auto intf : removed) {
@@ -512,11 +493,13 @@ void RemoveInterfacePass::remove_interfaces_for_root(
       m_removed_interfaces.insert(intf);
     }
     TRACE(RM_INTF, 5, "non-leaf removable interfaces %ld", interfaces.size());
-    removed = remove_leaf_interfaces(scope, root, interfaces, type_system);
+    removed =
+        remove_leaf_interfaces(scope, root, interfaces, type_system, index);
   }
 
   // Update type reference to removed interfaces all at once.
-  remove_interface_references(scope, type_system, root, m_removed_interfaces);
+  remove_interface_references(scope, type_system, root, m_removed_interfaces,
+                              index);
 
   if (traceEnabled(RM_INTF, 9)) {
     TypeSystem updated_ts(scope);
@@ -546,8 +529,14 @@ void RemoveInterfacePass::run_pass(DexStoresVector& stores,
                                    PassManager& mgr) {
   auto scope = build_class_scope(stores);
   TypeSystem type_system(scope);
+  // Built once for all roots and rounds: the dispatch stubs added on the way
+  // only mention implementor classes, so the index doesn't need them.
+  reference_index::Index index(scope,
+                               reference_index::Index::CALLERS |
+                                   reference_index::Index::TYPE_USES |
+                                   reference_index::Index::FIELDS_OF_TYPE);
   for (const auto root : m_interface_roots) {
-    remove_interfaces_for_root(scope, stores, root, type_system);
+    remove_interfaces_for_root(scope, stores, root, type_system, index);
   }
   mgr.incr_metric("num_total_interface", m_total_num_interface);
   mgr.incr_metric("num_interface_excluded", m_num_interface_excluded);
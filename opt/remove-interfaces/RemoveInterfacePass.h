@@ -13,6 +13,10 @@
 using TypeSet = std::set<const DexType*, dextypes_comparator>;
 class TypeSystem;
 
+namespace reference_index {
+class Index;
+} // namespace reference_index
+
 /**
  * The motivation of this pass is to remove a hierarhcy of interfaces extending
  * each others. The removal of the interfaces simplifies the type system and
@@ -52,11 +56,13 @@ class RemoveInterfacePass : public Pass {
   void remove_interfaces_for_root(const Scope& scope,
                                   const DexStoresVector& stores,
                                   const DexType* root,
-                                  const TypeSystem& type_system);
+                                  const TypeSystem& type_system,
+                                  reference_index::Index& index);
   TypeSet remove_leaf_interfaces(const Scope& scope,
                                  const DexType* root,
                                  const TypeSet& interfaces,
-                                 const TypeSystem& type_system);
+                                 const TypeSystem& type_system,
+                                 const reference_index::Index& index);
   bool is_leaf(const TypeSystem& type_system, const DexType* intf);
   void remove_inheritance(const Scope& scope,
                           const TypeSystem& type_system,
@@ -208,8 +208,8 @@ std::unique_ptr<ReachableObjects> compute_reachable_objects_with_type_anaysis(
     code.cfg().calculate_exit_block();
   });
 
-  auto reachable_objects = std::make_unique<ReachableObjects>();
-  ConditionallyMarked cond_marked;
+  auto reachable_objects = std::make_unique<ReachableObjects>(scope);
+  ConditionallyMarked cond_marked(reachable_objects->ids());
   auto method_override_graph = mog::build_graph(scope);
 
   ConcurrentSet<ReachableObject, ReachableObjectHash> root_set;
@@ -228,7 +228,7 @@ std::unique_ptr<ReachableObjects> compute_reachable_objects_with_type_anaysis(
             ignore_sets, *method_override_graph, record_reachability,
             &cond_marked, reachable_objects.get(), worker_state,
             &stats_arr[worker_state->worker_id()], gta);
-        transitive_closure_marker.visit(obj);
+        transitive_closure_marker.run(obj);
         return nullptr;
       },
       num_threads,
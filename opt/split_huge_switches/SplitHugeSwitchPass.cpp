@@ -27,6 +27,7 @@
 #include "ReachingDefinitions.h"
 #include "ScopedCFG.h"
 #include "Show.h"
+#include "SwitchCaseIndex.h"
 #include "TypeUtil.h"
 #include "Walkers.h"
 
@@ -205,24 +206,14 @@ struct SwitchRange {
   int32_t max_case;
   std::vector<int32_t> mid_cases;
 };
-SwitchRange get_switch_range(const cfg::ControlFlowGraph& cfg,
-                             cfg::Block* b,
-                             size_t split_into) {
+SwitchRange get_switch_range(cfg::Block* b, size_t split_into) {
   redex_assert(b->get_last_insn()->insn->opcode() == OPCODE_SWITCH);
-  std::vector<int32_t> cases;
-  for (const auto* e : cfg.get_succ_edges_of_type(b, cfg::EDGE_BRANCH)) {
-    cases.push_back(*e->case_key());
-  }
-  std::sort(cases.begin(), cases.end());
+  SwitchCaseIndex cases(b);
   int32_t min_case = 0, max_case = 0;
-  std::vector<int32_t> mid_cases;
-  if (!cases.empty() && cases.size() > split_into) {
-    min_case = cases.front();
-    max_case = cases.back();
-    for (size_t i = 1; i < split_into; ++i) {
-      mid_cases.push_back(cases[(i * cases.size()) / split_into - 1]);
-    }
-    mid_cases.push_back(max_case);
+  auto mid_cases = cases.split_points(split_into);
+  if (!mid_cases.empty()) {
+    min_case = cases.keys().front();
+    max_case = cases.keys().back();
   }
   return SwitchRange{cases.size(), min_case, max_case, std::move(mid_cases)};
 }
@@ -561,8 +552,7 @@ AnalysisData analyze(DexMethod* m,
   data.no_easy_expr = false;
 
   size_t nr_splits = (size_t)std::ceil(((float)size) / insn_threshold);
-  auto switch_range =
-      get_switch_range(*scoped_cfg, switch_it.block(), nr_splits);
+  auto switch_range = get_switch_range(switch_it.block(), nr_splits);
   if (switch_range.cases < nr_splits) {
     // Cannot split into the requested amount.
     data.cannot_split = true;
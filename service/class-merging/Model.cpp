@@ -16,6 +16,7 @@
 #include "Resolver.h"
 #include "Show.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 using namespace class_merging;
 
@@ -604,17 +605,44 @@ void Model::shape_model() {
     mergers.emplace_back(&m_mergers[type]);
   }
 
-  for (auto merger : mergers) {
-    TRACE(CLMG, 6, "Build shapes from %s", SHOW(merger->type));
-    MergerType::ShapeCollector shapes;
-    shape_merger(*merger, shapes);
-    approximate_shapes(shapes);
-    m_metric.dropped += trim_shapes(shapes, m_spec.min_count);
-    for (auto& shape_it : shapes) {
-      break_by_interface(*merger, shape_it.first, shape_it.second);
+  // Shaping only reads the hierarchy below each merger, and the children of
+  // different mergers are disjoint, so all mergers are shaped in parallel.
+  std::vector<MergerType::ShapeCollector> merger_shapes(mergers.size());
+  std::vector<TypeSet> merger_excluded(mergers.size());
+  auto wq = workqueue_foreach<size_t>([&](size_t i) {
+    TRACE(CLMG, 6, "Build shapes from %s", SHOW(mergers[i]->type));
+    shape_merger(*mergers[i], merger_shapes[i], merger_excluded[i]);
+  });
+  for (size_t i = 0; i < mergers.size(); i++) {
+    wq.add_item(i);
+  }
+  wq.run_all();
+
+  // Approximation may append to a shared shape graph file, keep it ordered.
+  for (size_t i = 0; i < mergers.size(); i++) {
+    m_excluded.insert(merger_excluded[i].begin(), merger_excluded[i].end());
+    approximate_shapes(merger_shapes[i]);
+    m_metric.dropped += trim_shapes(merger_shapes[i], m_spec.min_count);
+  }
+
+  auto group_wq = workqueue_foreach<size_t>([&](size_t i) {
+    for (auto& shape_it : merger_shapes[i]) {
+      break_by_interface(*mergers[i], shape_it.first, shape_it.second);
     }
+  });
+  for (size_t i = 0; i < mergers.size(); i++) {
+    group_wq.add_item(i);
+  }
+  group_wq.run_all();
+
+  if (is_merge_per_interdex_set_enabled() && s_num_interdex_groups > 1) {
+    collect_type_usages(merger_shapes);
+  }
 
-    flatten_shapes(*merger, shapes);
+  // Creating the mergers updates the hierarchy and names the new shapes in
+  // order, so it stays sequential.
+  for (size_t i = 0; i < mergers.size(); i++) {
+    flatten_shapes(*mergers[i], merger_shapes[i]);
   }
 
   // Update excluded metrics
@@ -623,7 +651,8 @@ void Model::shape_model() {
 }
 
 void Model::shape_merger(const MergerType& merger,
-                         MergerType::ShapeCollector& shapes) {
+                         MergerType::ShapeCollector& shapes,
+                         TypeSet& excluded) const {
   // if the root has got no children there is nothing to "shape"
   const auto& children = m_hierarchy.find(merger.type);
   if (children == m_hierarchy.end()) {
@@ -636,7 +665,7 @@ void Model::shape_merger(const MergerType& merger,
       continue;
     }
     if (is_excluded(child)) {
-      m_excluded.insert(child);
+      excluded.insert(child);
       continue;
     }
     if (m_non_mergeables.count(child)) {
@@ -753,7 +782,7 @@ void Model::approximate_shapes(MergerType::ShapeCollector& shapes) {
  */
 void Model::break_by_interface(const MergerType& merger,
                                const MergerType::Shape& shape,
-                               MergerType::ShapeHierarchy& hier) {
+                               MergerType::ShapeHierarchy& hier) const {
   always_assert(!hier.types.empty());
   // group classes by interfaces implemented
   TRACE(CLMG, 7, "Break up shape %s parent %s", shape.to_string().c_str(),
@@ -851,14 +880,36 @@ size_t get_interdex_group(
 
 namespace class_merging {
 
+void Model::collect_type_usages(
+    const std::vector<MergerType::ShapeCollector>& merger_shapes) {
+  // Usages of a type don't depend on the other types looked up, so one walk
+  // over the scope serves the groups of all shapes.
+  ConstTypeHashSet types;
+  for (const auto& shapes : merger_shapes) {
+    for (const auto& shape_it : shapes) {
+      types.insert(shape_it.second.types.begin(),
+                   shape_it.second.types.end());
+    }
+  }
+  auto type_to_usages = get_type_usages(types, m_scope);
+  m_type_usages.clear();
+  m_type_usages.reserve(type_to_usages.size());
+  for (auto& pair : type_to_usages) {
+    m_type_usages.emplace(pair.first, std::move(pair.second));
+  }
+  TRACE(CLMG, 5, "Collected usages of %zu types", m_type_usages.size());
+}
+
 std::vector<TypeSet> Model::group_per_interdex_set(const TypeSet& types) {
-  ConstTypeHashSet type_hash_set{types.begin(), types.end()};
-  const auto& type_to_usages = get_type_usages(type_hash_set, m_scope);
   std::vector<TypeSet> new_groups(s_num_interdex_groups);
-  for (const auto& pair : type_to_usages) {
-    auto index = get_interdex_group(pair.second, s_cls_to_interdex_group,
+  for (const auto& type : types) {
+    auto usages = m_type_usages.find(type);
+    if (usages == m_type_usages.end()) {
+      continue;
+    }
+    auto index = get_interdex_group(usages->second, s_cls_to_interdex_group,
                                     s_num_interdex_groups);
-    new_groups[index].emplace(pair.first);
+    new_groups[index].emplace(type);
   }
 
   if (m_spec.merge_per_interdex_set == InterDexGroupingType::NON_HOT_SET) {
@@ -1431,6 +1482,7 @@ ModelStats& ModelStats::operator+=(const ModelStats& stats) {
   m_num_merged_static_methods += stats.m_num_merged_static_methods;
   m_num_merged_direct_methods += stats.m_num_merged_direct_methods;
   m_num_merged_nonvirt_methods += stats.m_num_merged_nonvirt_methods;
+  m_dedup_stats += stats.m_dedup_stats;
   return *this;
 }
 
@@ -13,6 +13,7 @@
 #include "ApproximateShapeMerging.h"
 #include "DexClass.h"
 #include "MergerType.h"
+#include "MethodDedup.h"
 #include "Trace.h"
 #include "TypeSystem.h"
 
@@ -327,6 +328,11 @@ class Model {
   // Number of merger types created with the same shape per model.
   std::map<MergerType::Shape, size_t, MergerType::ShapeComp> m_shape_to_count;
 
+  // Classes of the methods using each grouped type, collected once for
+  // merge_per_interdex_set.
+  std::unordered_map<const DexType*, std::unordered_set<DexType*>>
+      m_type_usages;
+
   const Scope& m_scope;
   const ConfigFiles& m_conf;
 
@@ -381,13 +387,17 @@ class Model {
 
   // make shapes out of the model classes
   void shape_model();
-  void shape_merger(const MergerType& root, MergerType::ShapeCollector& shapes);
+  void shape_merger(const MergerType& root,
+                    MergerType::ShapeCollector& shapes,
+                    TypeSet& excluded) const;
   void approximate_shapes(MergerType::ShapeCollector& shapes);
   void break_by_interface(const MergerType& merger,
                           const MergerType::Shape& shape,
-                          MergerType::ShapeHierarchy& hier);
+                          MergerType::ShapeHierarchy& hier) const;
   void flatten_shapes(const MergerType& merger,
                       MergerType::ShapeCollector& shapes);
+  void collect_type_usages(
+      const std::vector<MergerType::ShapeCollector>& merger_shapes);
   std::vector<TypeSet> group_per_interdex_set(const TypeSet& types);
   void map_fields(MergerType& shape, const TypeSet& classes);
 
@@ -456,6 +466,8 @@ struct ModelStats {
   uint32_t m_num_merged_static_methods = 0;
   uint32_t m_num_merged_direct_methods = 0;
   uint32_t m_num_merged_nonvirt_methods = 0;
+  // Throughput of the identical method grouping.
+  method_dedup::Stats m_dedup_stats;
 
   ModelStats& operator+=(const ModelStats& stats);
 };
@@ -659,6 +659,12 @@ void ModelMerger::update_redex_stats(const std::string& prefix,
                   m_stats.m_num_merged_direct_methods);
   mgr.incr_metric(prefix + "_merged_nonvirt_methods",
                   m_stats.m_num_merged_nonvirt_methods);
+  mgr.incr_metric(prefix + "_dedup_fingerprinted_methods",
+                  m_stats.m_dedup_stats.fingerprinted_methods);
+  mgr.incr_metric(prefix + "_dedup_fingerprint_buckets",
+                  m_stats.m_dedup_stats.fingerprint_buckets);
+  mgr.incr_metric(prefix + "_dedup_exact_compares",
+                  m_stats.m_dedup_stats.exact_compares);
 }
 
 } // namespace class_merging
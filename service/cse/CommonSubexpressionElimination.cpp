@@ -64,10 +64,10 @@
 #include "ReducedProductAbstractDomain.h"
 #include "Resolver.h"
 #include "Show.h"
-#include "StlUtil.h"
 #include "Trace.h"
 #include "TypeInference.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 using namespace sparta;
 using namespace cse_impl;
@@ -909,6 +909,10 @@ SharedState::SharedState(const std::unordered_set<DexMethodRef*>& pure_methods)
   if (traceEnabled(CSE, 2)) {
     m_barriers.reset(new ConcurrentMap<Barrier, size_t, BarrierHasher>());
   }
+  m_callee_summaries.reset(
+      new ConcurrentMap<const DexMethod*,
+                        std::shared_ptr<const CalleeSummary>>());
+  m_invalidated_methods.reset(new ConcurrentSet<const DexMethod*>());
 }
 
 const method_override_graph::Graph* SharedState::get_method_override_graph()
@@ -916,58 +920,78 @@ const method_override_graph::Graph* SharedState::get_method_override_graph()
   return m_method_override_graph.get();
 }
 
-void SharedState::init_method_barriers(const Scope& scope) {
-  Timer t("init_method_barriers");
-  auto iterations = compute_locations_closure(
-      scope, m_method_override_graph.get(),
-      [&](DexMethod* method) -> boost::optional<LocationsAndDependencies> {
-        auto action = get_base_or_overriding_method_action(
-            method, &m_safe_method_defs,
-            /* ignore_methods_with_assumenosideeffects */ true);
-        if (action == MethodOverrideAction::UNKNOWN) {
-          return boost::none;
-        }
-        LocationsAndDependencies lads;
-        if (action == MethodOverrideAction::EXCLUDE) {
-          return lads;
+boost::optional<LocationsAndDependencies> SharedState::get_method_barriers(
+    DexMethod* method) {
+  auto action = get_base_or_overriding_method_action(
+      method, &m_safe_method_defs,
+      /* ignore_methods_with_assumenosideeffects */ true);
+  if (action == MethodOverrideAction::UNKNOWN) {
+    return boost::none;
+  }
+  LocationsAndDependencies lads;
+  if (action == MethodOverrideAction::EXCLUDE) {
+    return lads;
+  }
+  // Returns false if the instruction makes the method a general memory
+  // barrier.
+  auto visit = [&](IRInstruction* insn) {
+    if (may_be_barrier(insn, nullptr /* exact_virtual_scope */)) {
+      auto barrier = make_barrier(insn);
+      if (!opcode::is_an_invoke(barrier.opcode)) {
+        auto location = get_written_location(barrier);
+        if (location ==
+            CseLocation(CseSpecialLocations::GENERAL_MEMORY_BARRIER)) {
+          return false;
         }
-        auto code = method->get_code();
-        for (const auto& mie : cfg::InstructionIterable(code->cfg())) {
-          auto* insn = mie.insn;
-          if (may_be_barrier(insn, nullptr /* exact_virtual_scope */)) {
-            auto barrier = make_barrier(insn);
-            if (!opcode::is_an_invoke(barrier.opcode)) {
-              auto location = get_written_location(barrier);
-              if (location ==
-                  CseLocation(CseSpecialLocations::GENERAL_MEMORY_BARRIER)) {
-                return boost::none;
-              }
-              lads.locations.insert(location);
-              continue;
-            }
+        lads.locations.insert(location);
+        return true;
+      }
 
-            if (barrier.opcode == OPCODE_INVOKE_SUPER) {
-              // TODO: Implement
-              return boost::none;
-            }
+      if (barrier.opcode == OPCODE_INVOKE_SUPER) {
+        // TODO: Implement
+        return false;
+      }
 
-            if (!process_base_and_overriding_methods(
-                    m_method_override_graph.get(), barrier.method,
-                    &m_safe_method_defs,
-                    /* ignore_methods_with_assumenosideeffects */ true,
-                    [&](DexMethod* other_method) {
-                      if (other_method != method) {
-                        lads.dependencies.insert(other_method);
-                      }
-                      return true;
-                    })) {
-              return boost::none;
-            }
-          }
-        }
+      if (!process_base_and_overriding_methods(
+              m_method_override_graph.get(), barrier.method,
+              &m_safe_method_defs,
+              /* ignore_methods_with_assumenosideeffects */ true,
+              [&](DexMethod* other_method) {
+                if (other_method != method) {
+                  lads.dependencies.insert(other_method);
+                }
+                return true;
+              })) {
+        return false;
+      }
+    }
+    return true;
+  };
+  // The code has an editable cfg when the summaries are first computed, and
+  // may be linear when they get refreshed.
+  auto code = method->get_code();
+  if (code->editable_cfg_built()) {
+    for (const auto& mie : cfg::InstructionIterable(code->cfg())) {
+      if (!visit(mie.insn)) {
+        return boost::none;
+      }
+    }
+  } else {
+    for (const auto& mie : InstructionIterable(code)) {
+      if (!visit(mie.insn)) {
+        return boost::none;
+      }
+    }
+  }
+
+  return lads;
+}
 
-        return lads;
-      },
+void SharedState::init_method_barriers(const Scope& scope) {
+  Timer t("init_method_barriers");
+  auto iterations = compute_locations_closure(
+      scope, m_method_override_graph.get(),
+      [&](DexMethod* method) { return get_method_barriers(method); },
       &m_method_written_locations);
   m_stats.method_barriers_iterations = iterations;
   m_stats.method_barriers = m_method_written_locations.size();
@@ -980,6 +1004,99 @@ void SharedState::init_method_barriers(const Scope& scope) {
   }
 }
 
+void SharedState::init_callee_summaries(const Scope& scope) {
+  Timer t("init_callee_summaries");
+  walk::parallel::methods(scope, [&](DexMethod* method) {
+    m_callee_summaries->emplace(method, compute_callee_summary(method));
+  });
+  m_stats.callee_summaries = m_callee_summaries->size();
+}
+
+std::shared_ptr<const CalleeSummary> SharedState::compute_callee_summary(
+    const DexMethod* method) const {
+  auto summary = std::make_shared<CalleeSummary>();
+  if (!process_base_and_overriding_methods(
+          m_method_override_graph.get(), method, &m_safe_method_defs,
+          /* ignore_methods_with_assumenosideeffects */ true,
+          [&](DexMethod* other_method) {
+            auto it = m_method_written_locations.find(other_method);
+            if (it == m_method_written_locations.end()) {
+              return false;
+            }
+            summary->written_locations.insert(it->second.begin(),
+                                              it->second.end());
+            return true;
+          })) {
+    summary->general_memory_barrier = true;
+    summary->written_locations.clear();
+  }
+  return summary;
+}
+
+std::shared_ptr<const CalleeSummary> SharedState::get_callee_summary(
+    const DexMethod* method) {
+  auto summary = m_callee_summaries->get(method, nullptr);
+  if (!summary) {
+    // Callees outside of the scope; racing threads compute the same summary.
+    summary = compute_callee_summary(method);
+    m_callee_summaries->emplace(method, summary);
+  }
+  return summary;
+}
+
+void SharedState::invalidate_method(const DexMethod* method) {
+  m_invalidated_methods->insert(method);
+}
+
+size_t SharedState::refresh_invalidated_methods() {
+  std::vector<const DexMethod*> methods(m_invalidated_methods->begin(),
+                                        m_invalidated_methods->end());
+  m_invalidated_methods->clear();
+  if (methods.empty()) {
+    return 0;
+  }
+
+  // All new summaries are derived from the old ones, so that the result
+  // doesn't depend on the order in which the methods get processed. The old
+  // summaries of callees remain sound, as they over-approximate what they
+  // write now.
+  std::vector<boost::optional<CseUnorderedLocationSet>> written_locations(
+      methods.size());
+  auto wq = workqueue_foreach<size_t>([&](size_t i) {
+    auto method = const_cast<DexMethod*>(methods[i]);
+    auto lads = get_method_barriers(method);
+    if (!lads) {
+      return;
+    }
+    for (auto dependency : lads->dependencies) {
+      auto it = m_method_written_locations.find(dependency);
+      if (it == m_method_written_locations.end()) {
+        return;
+      }
+      lads->locations.insert(it->second.begin(), it->second.end());
+    }
+    written_locations[i] = std::move(lads->locations);
+  });
+  for (size_t i = 0; i < methods.size(); i++) {
+    wq.add_item(i);
+  }
+  wq.run_all();
+
+  for (size_t i = 0; i < methods.size(); i++) {
+    if (written_locations[i]) {
+      m_method_written_locations[methods[i]] = std::move(*written_locations[i]);
+    } else {
+      m_method_written_locations.erase(methods[i]);
+    }
+  }
+  m_stats.method_barriers = m_method_written_locations.size();
+  m_stats.refreshed_method_barriers += methods.size();
+
+  // Callee summaries get recomputed on demand.
+  m_callee_summaries->clear();
+  return methods.size();
+}
+
 void SharedState::init_scope(const Scope& scope) {
   always_assert(!m_method_override_graph);
   m_method_override_graph = method_override_graph::build_graph(scope);
@@ -1001,6 +1118,7 @@ void SharedState::init_scope(const Scope& scope) {
   }
 
   init_method_barriers(scope);
+  init_callee_summaries(scope);
 }
 
 CseUnorderedLocationSet SharedState::get_relevant_written_locations(
@@ -1099,26 +1217,21 @@ CseUnorderedLocationSet SharedState::get_relevant_written_locations(
 
   auto method_ref = insn->get_method();
   DexMethod* method = resolve_method(method_ref, opcode_to_search(insn));
-  CseUnorderedLocationSet written_locations;
-  if (!process_base_and_overriding_methods(
-          m_method_override_graph.get(), method, &m_safe_method_defs,
-          /* ignore_methods_with_assumenosideeffects */ true,
-          [&](DexMethod* other_method) {
-            auto it = m_method_written_locations.find(other_method);
-            if (it == m_method_written_locations.end()) {
-              return false;
-            }
-            written_locations.insert(it->second.begin(), it->second.end());
-            return true;
-          })) {
+  if (method == nullptr) {
+    return general_memory_barrier_locations;
+  }
+  auto summary = get_callee_summary(method);
+  if (summary->general_memory_barrier) {
     return general_memory_barrier_locations;
   }
 
-  // Remove written locations that are not read
-  std20::erase_if(written_locations, [&read_locations](auto it) {
-    return !read_locations.count(*it);
-  });
-
+  // Only keep written locations that are read
+  CseUnorderedLocationSet written_locations;
+  for (const auto& location : summary->written_locations) {
+    if (read_locations.count(location)) {
+      written_locations.insert(location);
+    }
+  }
   return written_locations;
 }
 
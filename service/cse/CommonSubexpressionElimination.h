@@ -44,6 +44,8 @@ struct SharedStateStats {
   size_t method_barriers_iterations{0};
   size_t conditionally_pure_methods{0};
   size_t conditionally_pure_methods_iterations{0};
+  size_t callee_summaries{0};
+  size_t refreshed_method_barriers{0};
 };
 
 // A barrier is defined by a particular opcode, and possibly some extra data
@@ -66,6 +68,15 @@ struct BarrierHasher {
   }
 };
 
+// The locations that an invocation of a particular callee may write, taking
+// into account all overriding methods.
+struct CalleeSummary {
+  // When set, the invocation must be treated as a general memory barrier, and
+  // the written locations are meaningless.
+  bool general_memory_barrier{false};
+  CseUnorderedLocationSet written_locations;
+};
+
 class SharedState {
  public:
   explicit SharedState(const std::unordered_set<DexMethodRef*>& pure_methods);
@@ -86,8 +97,29 @@ class SharedState {
   }
   const method_override_graph::Graph* get_method_override_graph() const;
 
+  /*
+   * Record that the code of the given method changed, so that its barrier
+   * summary should be recomputed. This operation is thread-safe; the summaries
+   * in use don't change until refresh_invalidated_methods is called.
+   */
+  void invalidate_method(const DexMethod* method);
+
+  /*
+   * Recompute the barrier summaries of all invalidated methods from their
+   * current code, and drop the affected callee summaries. Must not run concurrently with any CSE instance using this
+   * shared state. Returns the number of recomputed methods.
+   */
+  size_t refresh_invalidated_methods();
+
  private:
   void init_method_barriers(const Scope& scope);
+  void init_callee_summaries(const Scope& scope);
+  boost::optional<LocationsAndDependencies> get_method_barriers(
+      DexMethod* method);
+  std::shared_ptr<const CalleeSummary> get_callee_summary(
+      const DexMethod* method);
+  std::shared_ptr<const CalleeSummary> compute_callee_summary(
+      const DexMethod* method) const;
   bool may_be_barrier(const IRInstruction* insn, DexType* exact_virtual_scope);
   bool is_invoke_safe(const IRInstruction* insn, DexType* exact_virtual_scope);
   CseUnorderedLocationSet get_relevant_written_locations(
@@ -101,6 +133,12 @@ class SharedState {
   std::unique_ptr<ConcurrentMap<Barrier, size_t, BarrierHasher>> m_barriers;
   std::unordered_map<const DexMethod*, CseUnorderedLocationSet>
       m_method_written_locations;
+  // Derived from m_method_written_locations, keyed by resolved callee;
+  // computed up front for the scope, and on demand for other callees.
+  std::unique_ptr<
+      ConcurrentMap<const DexMethod*, std::shared_ptr<const CalleeSummary>>>
+      m_callee_summaries;
+  std::unique_ptr<ConcurrentSet<const DexMethod*>> m_invalidated_methods;
   std::unordered_map<const DexMethod*, CseUnorderedLocationSet>
       m_conditionally_pure_methods;
   std::unique_ptr<const method_override_graph::Graph> m_method_override_graph;
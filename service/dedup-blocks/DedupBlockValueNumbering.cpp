@@ -11,6 +11,53 @@
 
 using namespace DedupBlkValueNumbering;
 
+namespace {
+
+void set_operand(IROperation& operation, const IRInstruction* insn) {
+  if (insn->has_literal()) {
+    operation.literal = insn->get_literal();
+  } else if (insn->has_type()) {
+    operation.type = insn->get_type();
+  } else if (insn->has_field()) {
+    operation.field = insn->get_field();
+  } else if (insn->has_method()) {
+    operation.method = insn->get_method();
+  } else if (insn->has_string()) {
+    operation.string = insn->get_string();
+  } else if (insn->has_data()) {
+    operation.data = insn->get_data();
+  }
+}
+
+} // namespace
+
+namespace DedupBlkValueNumbering {
+
+bool is_ordered_opcode(IROpcode opcode) {
+  return opcode == OPCODE_MOVE_EXCEPTION || opcode::has_side_effects(opcode) ||
+         opcode::is_a_load_param(opcode) ||
+         opcode::is_move_result_any(opcode) || opcode::may_throw(opcode);
+}
+
+size_t hash_ordered_operations(cfg::Block* block) {
+  size_t hash = 0;
+  for (auto& mie : InstructionIterable(block)) {
+    auto insn = mie.insn;
+    if (!is_ordered_opcode(insn->opcode())) {
+      continue;
+    }
+    IROperation operation;
+    operation.opcode = insn->opcode();
+    set_operand(operation, insn);
+    boost::hash_combine(hash, operation.opcode);
+    boost::hash_combine(hash, insn->srcs_size());
+    boost::hash_combine(hash, (size_t)operation.literal);
+  }
+  return hash;
+}
+
+} // namespace DedupBlkValueNumbering
+
 // Return BlockValue hash for the given block.
 const BlockValue* BlockValues::get_block_value(cfg::Block* block) const {
   // Check if we have already computed.
@@ -84,30 +131,14 @@ IROperation BlockValues::get_operation(std::map<reg_t, value_id_t>& regs,
   if (opcode::is_commutative(opcode)) {
     std::sort(operation.srcs.begin(), operation.srcs.end());
   }
-  if (insn->has_literal()) {
-    operation.literal = insn->get_literal();
-  } else if (insn->has_type()) {
-    operation.type = insn->get_type();
-  } else if (insn->has_field()) {
-    operation.field = insn->get_field();
-  } else if (insn->has_method()) {
-    operation.method = insn->get_method();
-  } else if (insn->has_string()) {
-    operation.string = insn->get_string();
-  } else if (insn->has_data()) {
-    operation.data = insn->get_data();
-  }
+  set_operand(operation, insn);
   return operation;
 }
 
 bool BlockValues::is_ordered_operation(const IROperation& operation) const {
   always_assert(operation.opcode != IOPCODE_LOAD_REG &&
                 operation.opcode != IOPCODE_OPERATION_RESULT);
-  return operation.opcode == OPCODE_MOVE_EXCEPTION ||
-         opcode::has_side_effects(operation.opcode) ||
-         opcode::is_a_load_param(operation.opcode) ||
-         opcode::is_move_result_any(operation.opcode) ||
-         opcode::may_throw(operation.opcode);
+  return is_ordered_opcode(operation.opcode);
 }
 
 value_id_t BlockValues::get_value_id(const IROperation& operation) const {
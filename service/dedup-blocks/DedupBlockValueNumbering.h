@@ -91,6 +91,15 @@ inline bool operator==(const BlockValue& a, const BlockValue& b) {
          a.out_regs == b.out_regs;
 }
 
+// Whether an operation keeps its position in the ordered operations of a block
+// value, instead of only contributing to the values of registers.
+bool is_ordered_opcode(IROpcode opcode);
+
+// A hash of the opcodes and operands of the ordered operations of a block, in
+// order. It doesn't need liveness or value numbering, and blocks with equal
+// block values always have equal ordered operation hashes.
+size_t hash_ordered_operations(cfg::Block* block);
+
 class BlockValues {
  public:
   explicit BlockValues(LivenessFixpointIterator& liveness_fixpoint_iter)
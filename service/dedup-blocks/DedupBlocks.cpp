@@ -56,6 +56,7 @@
 #include "StlUtil.h"
 #include "Trace.h"
 #include "TypeInference.h"
+#include "WorkQueue.h"
 #include <boost/functional/hash.hpp>
 
 namespace {
@@ -112,6 +113,30 @@ static bool same_branch_and_goto_successors(const cfg::Block* b1,
   return true;
 }
 
+// A cheap hash of what BlockAndBlockValuePairInSameGroup compares, apart from
+// the values of live-out registers: the kinds and case keys of the branch and
+// goto successors, the throw edges, whether the block is a catch block, and the
+// ordered operations. Duplicate blocks always have the same fingerprint.
+static hash_t block_fingerprint(cfg::Block* block) {
+  hash_t hash = block->is_catch();
+  // Successor targets may differ for self-loops, and their order doesn't
+  // matter; see same_branch_and_goto_successors.
+  hash_t succs_hash = 0;
+  for (auto edge : get_branch_or_goto_succs(block)) {
+    hash_t edge_hash = edge->type();
+    boost::hash_combine(edge_hash, edge->case_key().value_or(0));
+    succs_hash += edge_hash;
+  }
+  boost::hash_combine(hash, succs_hash);
+  for (auto edge : block->get_outgoing_throws_in_order()) {
+    boost::hash_combine(hash, edge->target()->id());
+    boost::hash_combine(hash, edge->throw_info()->catch_type);
+  }
+  boost::hash_combine(hash,
+                      DedupBlkValueNumbering::hash_ordered_operations(block));
+  return hash;
+}
+
 struct SuccBlocksInSameGroup {
   bool operator()(const cfg::Block* a, const cfg::Block* b) const {
     return same_branch_and_goto_successors(a, b) && a->same_try(b) &&
@@ -198,19 +223,23 @@ namespace dedup_blocks_impl {
 
 class DedupBlocksImpl {
  public:
-  DedupBlocksImpl(const Config* config, Stats& stats)
-      : m_config(config), m_stats(stats) {
+  DedupBlocksImpl(const Config* config, Scratch& scratch, Stats& stats)
+      : m_config(config), m_scratch(scratch), m_stats(stats) {
     always_assert(m_config);
   }
 
   // Dedup blocks that are exactly the same
   bool dedup(DexMethod* method, cfg::ControlFlowGraph& cfg) {
+    auto candidates = collect_candidates(cfg);
+    if (candidates.empty()) {
+      return false;
+    }
     cfg.calculate_exit_block();
     LivenessFixpointIterator liveness_fixpoint_iter(cfg);
     liveness_fixpoint_iter.run({});
     DedupBlkValueNumbering::BlockValues block_values(liveness_fixpoint_iter);
-    Duplicates dups =
-        collect_duplicates(method, cfg, block_values, liveness_fixpoint_iter);
+    Duplicates dups = collect_duplicates(method, cfg, candidates, block_values,
+                                         liveness_fixpoint_iter);
     if (!dups.empty()) {
       if (m_config->debug) {
         check_inits(cfg);
@@ -275,33 +304,54 @@ class DedupBlocksImpl {
                                                   BlockSuccHasher,
                                                   SuccBlocksInSameGroup>;
   const Config* m_config;
+  Scratch& m_scratch;
   Stats& m_stats;
 
+  // Index the eligible blocks by their fingerprint. Returns the blocks that
+  // share their fingerprint with another block, in id order; all other
+  // eligible blocks cannot have duplicates.
+  std::vector<cfg::Block*> collect_candidates(cfg::ControlFlowGraph& cfg) {
+    auto& index = m_scratch.candidates;
+    index.clear();
+    for (cfg::Block* block : cfg.blocks()) {
+      if (is_eligible(block)) {
+        index[block_fingerprint(block)].push_back(block);
+        ++m_stats.eligible_blocks;
+      }
+    }
+
+    std::vector<cfg::Block*> candidates;
+    for (const auto& p : index) {
+      if (p.second.size() > 1) {
+        candidates.insert(candidates.end(), p.second.begin(), p.second.end());
+      }
+    }
+    std::sort(candidates.begin(), candidates.end(), BlockCompare());
+    return candidates;
+  }
+
   // Find blocks with the same exact code
   Duplicates collect_duplicates(
       DexMethod* method,
       cfg::ControlFlowGraph& cfg,
+      const std::vector<cfg::Block*>& candidates,
       DedupBlkValueNumbering::BlockValues& block_values,
       LivenessFixpointIterator& liveness_fixpoint_iter) {
-    const auto& blocks = cfg.blocks();
     Duplicates duplicates;
 
-    for (cfg::Block* block : blocks) {
-      if (is_eligible(block)) {
-        // Find a group that matches this one. The key equality function of this
-        // map is actually a check that they are duplicates, not that they're
-        // the same block.
-        //
-        // For example, if Block A and Block A' are duplicates, we will
-        // populate this map as such:
-        //   * after the first iteration (inserted A)
-        //       A -> [A]
-        //   * after the second iteration (inserted A')
-        //       A -> [A, A']
-        auto& dups = duplicates[{block, block_values.get_block_value(block)}];
-        dups.insert(block);
-        ++m_stats.eligible_blocks;
-      }
+    for (cfg::Block* block : candidates) {
+      // Find a group that matches this one. The key equality function of this
+      // map is actually a check that they are duplicates, not that they're
+      // the same block.
+      //
+      // For example, if Block A and Block A' are duplicates, we will
+      // populate this map as such:
+      //   * after the first iteration (inserted A)
+      //       A -> [A]
+      //   * after the second iteration (inserted A')
+      //       A -> [A, A']
+      auto& dups = duplicates[{block, block_values.get_block_value(block)}];
+      dups.insert(block);
     }
 
     std::unique_ptr<reaching_defs::MoveAwareFixpointIterator>
@@ -988,13 +1038,17 @@ class DedupBlocksImpl {
   }
 };
 
-DedupBlocks::DedupBlocks(const Config* config, DexMethod* method)
-    : m_config(config), m_method(method) {
+DedupBlocks::DedupBlocks(const Config* config,
+                         DexMethod* method,
+                         Scratch* scratch)
+    : m_config(config), m_method(method), m_scratch(scratch) {
   always_assert(m_config);
 }
 
 void DedupBlocks::run() {
-  DedupBlocksImpl impl(m_config, m_stats);
+  Scratch local_scratch;
+  DedupBlocksImpl impl(m_config, m_scratch ? *m_scratch : local_scratch,
+                       m_stats);
   auto& cfg = m_method->get_code()->cfg();
   do {
     if (m_config->split_postfix) {
@@ -1003,6 +1057,50 @@ void DedupBlocks::run() {
   } while (impl.dedup(m_method, cfg));
 }
 
+Stats dedup_methods(const Config* config,
+                    const std::vector<DexMethod*>& methods,
+                    size_t num_threads) {
+  std::vector<Scratch> scratches(num_threads);
+  std::vector<Stats> stats(num_threads);
+  auto wq = workqueue_foreach<DexMethod*>(
+      [&](sparta::SpartaWorkerState<DexMethod*>* state, DexMethod* method) {
+        auto code = method->get_code();
+        if (code == nullptr || config->method_blocklist.count(method) != 0) {
+          return;
+        }
+
+        TRACE(DEDUP_BLOCKS, 3, "[dedup blocks] method %s", SHOW(method));
+
+        bool editable_cfg_built = code->editable_cfg_built();
+        if (!editable_cfg_built) {
+          code->build_cfg(/* editable */ true);
+        }
+
+        TRACE(DEDUP_BLOCKS, 5, "[dedup blocks] method %s before:\n%s",
+              SHOW(method), SHOW(code->cfg()));
+
+        auto worker_id = state->worker_id();
+        DedupBlocks impl(config, method, &scratches[worker_id]);
+        impl.run();
+        stats[worker_id] += impl.get_stats();
+
+        if (!editable_cfg_built) {
+          code->clear_cfg();
+        }
+      },
+      num_threads);
+  for (auto method : methods) {
+    wq.add_item(method);
+  }
+  wq.run_all();
+
+  Stats result;
+  for (const auto& worker_stats : stats) {
+    result += worker_stats;
+  }
+  return result;
+}
+
 Stats& Stats::operator+=(const Stats& that) {
   eligible_blocks += that.eligible_blocks;
   blocks_removed += that.blocks_removed;
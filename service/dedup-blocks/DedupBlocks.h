@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include "ControlFlow.h"
 #include "DexClass.h"
 
 namespace dedup_blocks_impl {
@@ -29,9 +30,19 @@ struct Stats {
   Stats& operator+=(const Stats& that);
 };
 
+// Buffers that are reused across methods, to avoid reallocating them for every
+// method. A Scratch must not be shared between threads.
+struct Scratch {
+  // Eligible blocks, indexed by a cheap fingerprint. Only blocks that share
+  // their fingerprint with another block go through value numbering.
+  std::unordered_map<size_t, std::vector<cfg::Block*>> candidates;
+};
+
 class DedupBlocks {
  public:
-  DedupBlocks(const Config* config, DexMethod* method);
+  DedupBlocks(const Config* config,
+              DexMethod* method,
+              Scratch* scratch = nullptr);
 
   const Stats& get_stats() const { return m_stats; }
 
@@ -40,7 +51,17 @@ class DedupBlocks {
  private:
   const Config* m_config;
   DexMethod* m_method;
+  Scratch* m_scratch;
   Stats m_stats;
 };
 
+/**
+ * Dedup the blocks of many methods in parallel, with one Scratch per thread.
+ * Methods without code or in the config's blocklist are skipped. The editable
+ * cfg is built as needed, and left as it was found.
+ */
+Stats dedup_methods(const Config* config,
+                    const std::vector<DexMethod*>& methods,
+                    size_t num_threads);
+
 } // namespace dedup_blocks_impl
@@ -7,8 +7,10 @@
 
 #include "LocalPointersAnalysis.h"
 
+#include <algorithm>
+#include <atomic>
+
 #include "DexUtil.h"
-#include "PatriciaTreeSet.h"
 #include "Resolver.h"
 #include "Walkers.h"
 #include "WorkQueue.h"
@@ -381,52 +383,47 @@ void FixpointIteratorMapDeleter::operator()(FixpointIteratorMap* map) {
   wq.run_all();
 }
 
-static void analyze_method_recursive(
+namespace {
+
+/*
+ * The call graph components of the methods with code in scope. Calls to
+ * methods that already have a summary don't need to wait for them, so those
+ * calls are not edges of the DAG.
+ */
+call_graph::SccDag build_scc_dag(const Scope& scope,
+                                 const call_graph::Graph& call_graph,
+                                 const SummaryCMap& summary_map) {
+  std::vector<const DexMethod*> methods;
+  walk::code(scope, [&](const DexMethod* method, IRCode&) {
+    methods.push_back(method);
+  });
+  std::sort(methods.begin(), methods.end(), compare_dexmethods);
+  return call_graph::SccDag(
+      call_graph, methods, [&](const DexMethod* method) {
+        return summary_map.count(method) == 0;
+      });
+}
+
+InvokeToSummaryMap get_invoke_to_summary_map(
     const DexMethod* method,
     const call_graph::Graph& call_graph,
-    sparta::PatriciaTreeSet<const DexMethodRef*> visiting,
-    FixpointIteratorMap* fp_iter_map,
-    SummaryCMap* summary_map) {
-  if (!method || summary_map->count(method) != 0 || visiting.contains(method) ||
-      method->get_code() == nullptr) {
-    return;
-  }
-  visiting.insert(method);
-
-  std::unordered_map<const IRInstruction*, EscapeSummary> invoke_to_summary_map;
+    const SummaryCMap& summary_map) {
+  InvokeToSummaryMap invoke_to_summary_map;
   if (call_graph.has_node(method)) {
-    const auto& callee_edges = call_graph.node(method)->callees();
-    for (const auto& edge : callee_edges) {
+    for (const auto& edge : call_graph.node(method)->callees()) {
       auto* callee = edge->callee()->method();
-      analyze_method_recursive(callee, call_graph, visiting, fp_iter_map,
-                               summary_map);
-      if (summary_map->count(callee) != 0) {
+      // Edges to the ghost exit node have no callee and no invoke.
+      if (callee != nullptr && summary_map.count(callee) != 0) {
         invoke_to_summary_map.emplace(edge->invoke_iterator()->insn,
-                                      summary_map->at(callee));
+                                      summary_map.at(callee));
       }
     }
   }
-
-  auto* code = method->get_code();
-  auto& cfg = code->cfg();
-  auto fp_iter = new FixpointIterator(cfg, std::move(invoke_to_summary_map));
-  fp_iter->run(Environment());
-
-  // The following updates form a critical section.
-  {
-    boost::lock_guard<boost::mutex> lock(fp_iter_map->get_lock(method));
-    fp_iter_map->update_unsafe(method,
-                               [&](auto, FixpointIterator*& v, bool exists) {
-                                 redex_assert(!(exists ^ (v != nullptr)));
-                                 delete v;
-                                 v = fp_iter;
-                               });
-    summary_map->update(method, [&](auto, EscapeSummary& v, bool) {
-      v = get_escape_summary(*fp_iter, *code);
-    });
-  }
+  return invoke_to_summary_map;
 }
 
+} // namespace
+
 FixpointIteratorMapPtr analyze_scope(const Scope& scope,
                                      const call_graph::Graph& call_graph,
                                      SummaryCMap* summary_map_ptr) {
@@ -438,14 +435,55 @@ FixpointIteratorMapPtr analyze_scope(const Scope& scope,
   summary_map_ptr->emplace(
       DexMethod::get_method("Ljava/lang/Object;.<init>:()V"), EscapeSummary{});
 
-  walk::parallel::code(scope, [&](const DexMethod* method, IRCode& code) {
-    sparta::PatriciaTreeSet<const DexMethodRef*> visiting;
-    analyze_method_recursive(method, call_graph, visiting, fp_iter_map.get(),
-                             summary_map_ptr);
+  auto dag = build_scc_dag(scope, call_graph, *summary_map_ptr);
+  dag.run_bottom_up([&](const std::vector<const DexMethod*>& methods) {
+    for (auto method : methods) {
+      auto* code = method->get_code();
+      auto fp_iter = new FixpointIterator(
+          code->cfg(),
+          get_invoke_to_summary_map(method, call_graph, *summary_map_ptr));
+      fp_iter->run(Environment());
+      fp_iter_map->emplace(method, fp_iter);
+      if (summary_map_ptr->count(method) == 0) {
+        summary_map_ptr->emplace(method, get_escape_summary(*fp_iter, *code));
+      }
+    }
   });
   return fp_iter_map;
 }
 
+SummaryStats compute_summaries(const Scope& scope,
+                               const call_graph::Graph& call_graph,
+                               SummaryCMap* summary_map) {
+  summary_map->emplace(DexMethod::get_method("Ljava/lang/Object;.<init>:()V"),
+                       EscapeSummary{});
+
+  auto dag = build_scc_dag(scope, call_graph, *summary_map);
+  std::atomic<size_t> analyzed_methods{0};
+  auto analyze = [&](const DexMethod* method) {
+    if (summary_map->count(method) != 0) {
+      return;
+    }
+    auto* code = method->get_code();
+    FixpointIterator fp_iter(
+        code->cfg(),
+        get_invoke_to_summary_map(method, call_graph, *summary_map));
+    fp_iter.run(Environment());
+    summary_map->emplace(method, get_escape_summary(fp_iter, *code));
+    ++analyzed_methods;
+  };
+  dag.run_bottom_up([&](const std::vector<const DexMethod*>& methods) {
+    for (auto method : methods) {
+      analyze(method);
+    }
+  });
+
+  SummaryStats stats;
+  stats.sccs = dag.size();
+  stats.analyzed_methods = analyzed_methods;
+  return stats;
+}
+
 void collect_exiting_pointers(const FixpointIterator& fp_iter,
                               const IRCode& code,
                               PointerSet* returned_ptrs,
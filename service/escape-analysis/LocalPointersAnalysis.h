@@ -305,17 +305,43 @@ using SummaryMap = std::unordered_map<const DexMethodRef*, EscapeSummary>;
 
 using SummaryCMap = ConcurrentMap<const DexMethodRef*, EscapeSummary>;
 
+struct SummaryStats {
+  // Strongly connected components of the call graph over methods with code.
+  size_t sccs{0};
+  // Methods whose fixpoint iteration ran.
+  size_t analyzed_methods{0};
+};
+
 /*
  * Analyze all methods in scope, making sure to analyze the callees before
- * their callers.
+ * their callers. Methods are scheduled bottom-up over the strongly connected
+ * components of the call graph: a component gets analyzed, in parallel with
+ * the others, as soon as all the components it calls into are done. The
+ * members of a component are analyzed in a fixed order, with calls to the
+ * members that are not done yet treated as unknown calls.
  *
  * If a non-null SummaryCMap pointer is passed in, it will get populated
- * with the escape summaries of the methods in scope.
+ * with the escape summaries of the methods in scope. Methods that already have
+ * a summary in it still get analyzed, but keep their summary; in particular,
+ * when it is pre-populated with the summaries of all methods in scope, e.g.
+ * from compute_summaries(), no method waits for another one.
  */
 FixpointIteratorMapPtr analyze_scope(const Scope&,
                                      const call_graph::Graph&,
                                      SummaryCMap* = nullptr);
 
+/*
+ * Populate the SummaryCMap with the escape summaries of all methods in scope
+ * that don't have one yet, in the same order as analyze_scope(), but without
+ * keeping their fixpoint iterators around.
+ *
+ * The code of the methods is expected to have a CFG, with its exit block
+ * calculated.
+ */
+SummaryStats compute_summaries(const Scope&,
+                               const call_graph::Graph&,
+                               SummaryCMap*);
+
 /*
  * Join over all possible returned and thrown values.
  */
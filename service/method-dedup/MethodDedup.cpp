@@ -7,50 +7,88 @@
 
 #include "MethodDedup.h"
 
+#include <boost/functional/hash.hpp>
+#include <memory>
+
+#include "DexInstruction.h"
 #include "IRCode.h"
-#include "MethodReference.h"
+#include "ReferenceIndex.h"
 #include "Show.h"
 #include "Trace.h"
+#include "WorkQueue.h"
 
 namespace {
 
-struct CodeAsKey {
-  IRCode* code;
-
-  explicit CodeAsKey(IRCode* c) : code(c) {}
+// Below this many methods, fingerprinting and grouping are not worth spreading
+// over worker threads.
+constexpr size_t MIN_METHODS_FOR_PARALLEL_GROUPING = 1000;
 
-  bool operator==(const CodeAsKey& other) const {
-    return code->structural_equals(*other.code);
-  }
-};
-
-struct CodeHasher {
-  size_t operator()(const CodeAsKey& key) const {
-    size_t result = 0;
-    for (auto& mie : InstructionIterable(key.code)) {
-      result ^= mie.insn->hash();
+/*
+ * A structural hash of a method, which covers its proto and the opcodes and
+ * operands of its instructions. Registers are numbered in order of first use,
+ * and positions and other non-opcode entries are skipped, so the fingerprint
+ * doesn't depend on them. Methods with identical code always have the same
+ * fingerprint.
+ */
+size_t fingerprint(const DexMethod* method) {
+  size_t hash = 0;
+  boost::hash_combine(hash, method->get_proto());
+  std::unordered_map<reg_t, size_t> regs;
+  auto combine_reg = [&](reg_t reg) {
+    boost::hash_combine(hash, regs.emplace(reg, regs.size()).first->second);
+  };
+  size_t count = 0;
+  for (const auto& mie : InstructionIterable(method->get_code())) {
+    auto insn = mie.insn;
+    boost::hash_combine(hash, insn->opcode());
+    for (auto reg : insn->srcs()) {
+      combine_reg(reg);
+    }
+    if (insn->has_dest()) {
+      combine_reg(insn->dest());
+    }
+    if (insn->has_literal()) {
+      boost::hash_combine(hash, insn->get_literal());
+    } else if (insn->has_type()) {
+      boost::hash_combine(hash, insn->get_type());
+    } else if (insn->has_field()) {
+      boost::hash_combine(hash, insn->get_field());
+    } else if (insn->has_method()) {
+      boost::hash_combine(hash, insn->get_method());
+    } else if (insn->has_string()) {
+      boost::hash_combine(hash, insn->get_string());
+    } else if (insn->has_data()) {
+      boost::hash_combine(hash, insn->get_data()->data_size());
     }
-    return result;
+    count++;
   }
-};
-
-using DuplicateMethods =
-    std::unordered_map<CodeAsKey, MethodOrderedSet, CodeHasher>;
+  boost::hash_combine(hash, count);
+  return hash;
+}
 
-std::vector<MethodOrderedSet> get_duplicate_methods_simple(
-    const MethodOrderedSet& methods) {
-  DuplicateMethods duplicates;
-  for (DexMethod* method : methods) {
+// Split methods with equal fingerprints into groups of identical methods.
+void group_bucket(std::vector<DexMethod*>& bucket,
+                  std::vector<MethodOrderedSet>* groups,
+                  size_t* compares) {
+  std::sort(bucket.begin(), bucket.end(), compare_dexmethods);
+  size_t first_group = groups->size();
+  for (auto method : bucket) {
     always_assert(method->get_code());
-    duplicates[CodeAsKey(method->get_code())].emplace(method);
-  }
-
-  std::vector<MethodOrderedSet> result;
-  for (auto& duplicate : duplicates) {
-    result.push_back(std::move(duplicate.second));
+    auto it = groups->begin() + first_group;
+    for (; it != groups->end(); ++it) {
+      DexMethod* representative = *it->begin();
+      ++*compares;
+      if (method->get_proto() == representative->get_proto() &&
+          method->get_code()->structural_equals(
+              *representative->get_code())) {
+        it->insert(method);
+        break;
+      }
+    }
+    if (it == groups->end()) {
+      groups->push_back(MethodOrderedSet{method});
+    }
   }
-
-  return result;
 }
 
 } // namespace
@@ -86,19 +124,77 @@ std::vector<MethodOrderedSet> group_similar_methods(
   return result;
 }
 
+Stats& Stats::operator+=(const Stats& that) {
+  fingerprinted_methods += that.fingerprinted_methods;
+  fingerprint_buckets += that.fingerprint_buckets;
+  exact_compares += that.exact_compares;
+  return *this;
+}
+
 std::vector<MethodOrderedSet> group_identical_methods(
-    const std::vector<DexMethod*>& methods) {
-  std::vector<MethodOrderedSet> result;
-  std::vector<MethodOrderedSet> same_protos = group_similar_methods(methods);
+    const std::vector<DexMethod*>& methods, Stats* stats) {
+  bool parallel = methods.size() >= MIN_METHODS_FOR_PARALLEL_GROUPING;
+  size_t num_threads = parallel ? redex_parallel::default_num_threads() : 1;
 
-  // Find actual duplicates.
-  for (const auto& same_proto : same_protos) {
-    std::vector<MethodOrderedSet> duplicates =
-        get_duplicate_methods_simple(same_proto);
+  // 1. Fingerprint all methods.
+  std::vector<size_t> fingerprints(methods.size());
+  if (parallel) {
+    auto wq = workqueue_foreach<size_t>(
+        [&](size_t i) { fingerprints[i] = fingerprint(methods[i]); },
+        num_threads);
+    for (size_t i = 0; i < methods.size(); i++) {
+      wq.add_item(i);
+    }
+    wq.run_all();
+  } else {
+    for (size_t i = 0; i < methods.size(); i++) {
+      fingerprints[i] = fingerprint(methods[i]);
+    }
+  }
 
-    result.insert(result.end(), duplicates.begin(), duplicates.end());
+  // 2. Bucket methods by fingerprint, sharded so that shards can be grouped
+  //    independently. Only methods of the same bucket are compared exactly.
+  std::vector<std::unordered_map<size_t, std::vector<DexMethod*>>> shards(
+      num_threads);
+  for (size_t i = 0; i < methods.size(); i++) {
+    shards[fingerprints[i] % num_threads][fingerprints[i]].push_back(
+        methods[i]);
+  }
+  std::vector<std::vector<MethodOrderedSet>> shard_groups(num_threads);
+  std::vector<size_t> shard_compares(num_threads, 0);
+  auto group_shard = [&](size_t shard) {
+    for (auto& bucket : shards[shard]) {
+      group_bucket(bucket.second, &shard_groups[shard],
+                   &shard_compares[shard]);
+    }
+  };
+  if (parallel) {
+    auto wq = workqueue_foreach<size_t>(group_shard, num_threads);
+    for (size_t shard = 0; shard < num_threads; shard++) {
+      wq.add_item(shard);
+    }
+    wq.run_all();
+  } else {
+    group_shard(0);
   }
 
+  // 3. Order the groups by their first method for determinism.
+  std::vector<MethodOrderedSet> result;
+  for (auto& groups : shard_groups) {
+    std::move(groups.begin(), groups.end(), std::back_inserter(result));
+  }
+  std::sort(result.begin(), result.end(),
+            [](const MethodOrderedSet& a, const MethodOrderedSet& b) {
+              return compare_dexmethods(*a.begin(), *b.begin());
+            });
+
+  if (stats != nullptr) {
+    stats->fingerprinted_methods += methods.size();
+    for (size_t shard = 0; shard < num_threads; shard++) {
+      stats->fingerprint_buckets += shards[shard].size();
+      stats->exact_compares += shard_compares[shard];
+    }
+  }
   return result;
 }
 
@@ -108,16 +204,18 @@ bool are_methods_identical(const std::vector<DexMethod*>& methods) {
 
 size_t dedup_methods_helper(
     const Scope& scope,
+    std::unique_ptr<reference_index::Index>* index,
     const std::vector<DexMethod*>& to_dedup,
     std::vector<DexMethod*>& replacements,
     boost::optional<std::unordered_map<DexMethod*, MethodOrderedSet>>&
-        new_to_old) {
+        new_to_old,
+    Stats* stats) {
   if (to_dedup.size() <= 1) {
     replacements = to_dedup;
     return 0;
   }
   size_t dedup_count = 0;
-  auto grouped_methods = group_identical_methods(to_dedup);
+  auto grouped_methods = group_identical_methods(to_dedup, stats);
   std::unordered_map<DexMethod*, DexMethod*> duplicates_to_replacement;
   for (auto& group : grouped_methods) {
     auto replacement = *group.begin();
@@ -152,7 +250,15 @@ size_t dedup_methods_helper(
             SHOW(replacement));
     }
   }
-  method_reference::update_call_refs_simple(scope, duplicates_to_replacement);
+  if (!duplicates_to_replacement.empty()) {
+    // Rounds without duplicates, and dedup_methods calls without any, don't
+    // need to walk the scope at all.
+    if (*index == nullptr) {
+      *index = std::make_unique<reference_index::Index>(
+          scope, reference_index::Index::CALLERS);
+    }
+    (*index)->update_call_refs(duplicates_to_replacement);
+  }
   return dedup_count;
 }
 
@@ -161,14 +267,23 @@ size_t dedup_methods(
     const std::vector<DexMethod*>& to_dedup,
     std::vector<DexMethod*>& replacements,
     boost::optional<std::unordered_map<DexMethod*, MethodOrderedSet>>&
-        new_to_old) {
+        new_to_old,
+    Stats* stats) {
   size_t total_dedup_count = 0;
+  if (to_dedup.size() <= 1) {
+    replacements = to_dedup;
+    return total_dedup_count;
+  }
+  // Each round only rewrites the callers of the duplicates, so the callers are
+  // indexed once, when the first duplicates are found, instead of walking the
+  // whole scope every round.
+  std::unique_ptr<reference_index::Index> index;
   auto to_dedup_temp = to_dedup;
   while (true) {
     TRACE(
         METH_DEDUP, 8, "dedup: static|non_virt input %d", to_dedup_temp.size());
-    size_t dedup_count =
-        dedup_methods_helper(scope, to_dedup_temp, replacements, new_to_old);
+    size_t dedup_count = dedup_methods_helper(scope, &index, to_dedup_temp,
+                                              replacements, new_to_old, stats);
     total_dedup_count += dedup_count;
     TRACE(METH_DEDUP, 8, "dedup: static|non_virt dedupped %d", dedup_count);
     if (dedup_count == 0) {
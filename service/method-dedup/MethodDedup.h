@@ -26,13 +26,27 @@ namespace method_dedup {
 std::vector<MethodOrderedSet> group_similar_methods(
     const std::vector<DexMethod*>&);
 
+// Counters of the grouping work, to track dedup throughput.
+struct Stats {
+  // Methods whose structural fingerprint was computed.
+  size_t fingerprinted_methods{0};
+  // Distinct fingerprints among them.
+  size_t fingerprint_buckets{0};
+  // Exact code comparisons within buckets.
+  size_t exact_compares{0};
+  Stats& operator+=(const Stats& that);
+};
+
 /**
  * Group methods that are identical in that they share the same signature and
  * identical code. We ignore non-opcodes like debug info.
+ * Methods are first bucketed by a structural fingerprint that doesn't depend on
+ * register names, in parallel for large inputs; code is only compared exactly
+ * within a bucket. Groups are ordered by their first method.
  * Note that there's no side affects other than the grouping here.
  */
 std::vector<MethodOrderedSet> group_identical_methods(
-    const std::vector<DexMethod*>&);
+    const std::vector<DexMethod*>&, Stats* stats = nullptr);
 
 /**
  * Check if the given list of methods share the same signature and identical
@@ -52,6 +66,7 @@ size_t dedup_methods(
     const std::vector<DexMethod*>& to_dedup,
     std::vector<DexMethod*>& replacements,
     boost::optional<std::unordered_map<DexMethod*, MethodOrderedSet>>&
-        new_to_old);
+        new_to_old,
+    Stats* stats = nullptr);
 
 } // namespace method_dedup
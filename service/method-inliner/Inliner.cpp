@@ -255,33 +255,33 @@ void MultiMethodInliner::compute_callee_constant_arguments() {
     std::unordered_map<std::string, size_t> occurrences;
   };
   ConcurrentMap<DexMethod*, CalleeInfo> concurrent_callee_constant_arguments;
-  auto wq = workqueue_foreach<DexMethod*>(
-      [&](DexMethod* caller) {
-        auto& callees = caller_callee.at(caller);
-        auto res = get_invoke_constant_arguments(caller, callees);
-        if (!res) {
-          return;
-        }
-        for (auto& p : res->invoke_constant_arguments) {
-          auto insn = p.first->insn;
-          auto callee = resolver(insn->get_method(), opcode_to_search(insn));
-          const auto& constant_arguments = p.second;
-          auto key = get_key(constant_arguments);
-          concurrent_callee_constant_arguments.update(
-              callee, [&](const DexMethod*, CalleeInfo& ci, bool /* exists */) {
-                ci.constant_arguments.emplace(key, constant_arguments);
-                ++ci.occurrences[key];
-              });
-          m_call_constant_arguments.emplace(insn, constant_arguments);
-        }
-        info.constant_invoke_callers_analyzed++;
-        info.constant_invoke_callers_unreachable_blocks += res->dead_blocks;
-      },
-      redex_parallel::default_num_threads());
+  std::vector<DexMethod*> callers;
+  callers.reserve(caller_callee.size());
   for (auto& p : caller_callee) {
-    wq.add_item(p.first);
-  };
-  wq.run_all();
+    callers.push_back(p.first);
+  }
+  m_async_method_executor.parallel_for(callers.size(), [&](size_t i) {
+    auto caller = callers[i];
+    auto& callees = caller_callee.at(caller);
+    auto res = get_invoke_constant_arguments(caller, callees);
+    if (!res) {
+      return;
+    }
+    for (auto& p : res->invoke_constant_arguments) {
+      auto insn = p.first->insn;
+      auto callee = resolver(insn->get_method(), opcode_to_search(insn));
+      const auto& constant_arguments = p.second;
+      auto key = get_key(constant_arguments);
+      concurrent_callee_constant_arguments.update(
+          callee, [&](const DexMethod*, CalleeInfo& ci, bool /* exists */) {
+            ci.constant_arguments.emplace(key, constant_arguments);
+            ++ci.occurrences[key];
+          });
+      m_call_constant_arguments.emplace(insn, constant_arguments);
+    }
+    info.constant_invoke_callers_analyzed++;
+    info.constant_invoke_callers_unreachable_blocks += res->dead_blocks;
+  });
   for (auto& p : concurrent_callee_constant_arguments) {
     auto& v = m_callee_constant_arguments[p.first];
     const auto& ci = p.second;
@@ -294,13 +294,13 @@ void MultiMethodInliner::compute_callee_constant_arguments() {
 }
 
 void MultiMethodInliner::inline_methods() {
-  compute_callee_constant_arguments();
-
   // Inlining and shrinking initiated from within this method will be done
   // in parallel.
   m_async_method_executor.set_num_threads(
       m_config.debug ? 1 : redex_parallel::default_num_threads());
 
+  compute_callee_constant_arguments();
+
   // The order in which we inline is such that once a callee is considered to
   // be inlined, it's code will no longer change. So we can cache...
   // - its size
@@ -375,7 +375,6 @@ void MultiMethodInliner::inline_methods() {
         callee_priority = std::max(callee_priority, caller_priority + 1);
         m_async_callee_callers[callee].push_back(caller);
       }
-      m_async_caller_wait_counts.emplace(caller, callees.size());
       m_async_caller_callees.emplace(caller, callees);
     }
   }
@@ -388,6 +387,21 @@ void MultiMethodInliner::inline_methods() {
     callee_priority = (callee_priority << 16) + callers.size();
   }
 
+  // Each caller becomes runnable exactly when its last callee is done.
+  for (auto& p : m_async_caller_callees) {
+    auto caller = const_cast<DexMethod*>(p.first);
+    int priority = std::numeric_limits<int>::min();
+    auto it = m_async_callee_priorities.find(caller);
+    if (it != m_async_callee_priorities.end()) {
+      priority = it->second;
+    }
+    m_async_caller_work_items.emplace(
+        caller,
+        std::make_unique<PriorityThreadPool::DependentWorkItem>(
+            p.second.size(), priority,
+            [caller, this]() { async_caller_inline(caller); }));
+  }
+
   // Kick off (shrinking and) pre-computing the should-inline cache.
   // Once all callees of a caller have been processed, then postprocessing
   // will in turn kick off processing of the caller.
@@ -411,9 +425,11 @@ void MultiMethodInliner::inline_methods() {
     });
   }
 
-  m_async_method_executor.join();
+  m_async_method_executor.wait();
   delayed_change_visibilities();
+  m_async_method_executor.join();
   info.waited_seconds = m_async_method_executor.get_waited_seconds();
+  info.stolen_work_items = m_async_method_executor.get_stolen_work_items();
 }
 
 size_t MultiMethodInliner::compute_caller_nonrecursive_callees_by_stack_depth(
@@ -858,8 +874,12 @@ void MultiMethodInliner::shrink_method(DexMethod* method) {
       code->build_cfg(/* editable */ true);
     }
 
+    // Shrinking runs on the inliner's worker threads; keep one scratch state
+    // per thread instead of reallocating it for every shrunk method.
+    static thread_local dedup_blocks_impl::Scratch dedup_blocks_scratch;
     dedup_blocks_impl::Config config;
-    dedup_blocks_impl::DedupBlocks dedup_blocks(&config, method);
+    dedup_blocks_impl::DedupBlocks dedup_blocks(&config, method,
+                                                &dedup_blocks_scratch);
     dedup_blocks.run();
     dedup_blocks_stats = dedup_blocks.get_stats();
   }
@@ -926,31 +946,24 @@ void MultiMethodInliner::postprocess_method(DexMethod* method) {
 void MultiMethodInliner::decrement_caller_wait_counts(
     const std::vector<DexMethod*>& callers) {
   for (auto caller : callers) {
-    bool caller_ready = false;
-    m_async_caller_wait_counts.update(
-        caller, [&](const DexMethod*, size_t& value, bool /*exists*/) {
-          caller_ready = --value == 0;
-        });
-    if (caller_ready) {
-      if (inline_inlinables_need_deconstruct(caller)) {
-        // TODO: Support parallel execution without pre-deconstructed cfgs.
-        auto& callees = m_async_caller_callees.at(caller);
-        caller_inline(caller, callees);
-        decrement_delayed_shrinking_callee_wait_counts(callees);
-        async_postprocess_method(caller);
-      } else {
-        // We can process inlining concurrently!
-        async_prioritized_method_execute(caller, [caller, this]() {
-          auto& callees = m_async_caller_callees.at(caller);
-          caller_inline(caller, callees);
-          decrement_delayed_shrinking_callee_wait_counts(callees);
-          if (m_shrinking_enabled ||
-              m_async_callee_priorities.count(caller) != 0) {
-            postprocess_method(caller);
-          }
-        });
-      }
-    }
+    m_async_method_executor.signal(m_async_caller_work_items.at(caller).get());
+  }
+}
+
+void MultiMethodInliner::async_caller_inline(DexMethod* caller) {
+  auto& callees = m_async_caller_callees.at(caller);
+  if (inline_inlinables_need_deconstruct(caller)) {
+    // TODO: Support parallel execution without pre-deconstructed cfgs.
+    caller_inline(caller, callees);
+    decrement_delayed_shrinking_callee_wait_counts(callees);
+    async_postprocess_method(caller);
+    return;
+  }
+  // We can process inlining concurrently!
+  caller_inline(caller, callees);
+  decrement_delayed_shrinking_callee_wait_counts(callees);
+  if (m_shrinking_enabled || m_async_callee_priorities.count(caller) != 0) {
+    postprocess_method(caller);
   }
 }
 
@@ -1395,18 +1408,12 @@ size_t MultiMethodInliner::get_inlined_cost(const DexMethod* callee) {
     if (callee_constant_arguments.size() > 1 &&
         callee_constant_arguments.size() * inlined_cost >=
             MIN_COST_FOR_PARALLELIZATION) {
-      // TODO: This parallelization happens independently (in addition to) the
-      // parallelization via m_async_method_executor. This should be combined,
-      // using a single thread pool.
+      // This may run within a work item of m_async_method_executor; the
+      // current thread then takes part in the work.
       inlined_cost = 0;
-      auto num_threads = std::min(redex_parallel::default_num_threads(),
-                                  callee_constant_arguments.size());
-      auto wq = workqueue_foreach<ConstantArgumentsOccurrences>(process_key,
-                                                                num_threads);
-      for (auto& p : callee_constant_arguments) {
-        wq.add_item(p);
-      }
-      wq.run_all();
+      m_async_method_executor.parallel_for(
+          callee_constant_arguments.size(),
+          [&](size_t i) { process_key(callee_constant_arguments[i]); });
     } else {
       inlined_cost = 0;
       for (auto& p : callee_constant_arguments) {
@@ -1980,12 +1987,13 @@ bool MultiMethodInliner::cross_store_reference(const DexMethod* caller,
 }
 
 void MultiMethodInliner::delayed_change_visibilities() {
-  walk::parallel::code(m_scope, [&](DexMethod* method, IRCode& code) {
-    auto it = m_delayed_change_visibilities->find(method);
-    if (it == m_delayed_change_visibilities->end()) {
-      return;
-    }
-    auto& scopes = it->second;
+  std::vector<DexMethod*> methods;
+  for (auto& p : *m_delayed_change_visibilities) {
+    methods.push_back(p.first);
+  }
+  m_async_method_executor.parallel_for(methods.size(), [&](size_t i) {
+    auto method = methods[i];
+    auto& scopes = m_delayed_change_visibilities->at_unsafe(method);
     for (auto scope : scopes) {
       TRACE(MMINL, 6, "checking visibility usage of members in %s",
             SHOW(method));
@@ -423,6 +423,12 @@ class MultiMethodInliner {
    */
   void decrement_caller_wait_counts(const std::vector<DexMethod*>& callers);
 
+  /**
+   * Inline all callees into a caller whose callees are all ready, and then
+   * postprocess the caller.
+   */
+  void async_caller_inline(DexMethod* caller);
+
   /**
    * If a callee has been registered for delayed shrinking, decrement the wait
    * counter, and if zero, initiate shrinking asynchronously.
@@ -509,7 +515,8 @@ class MultiMethodInliner {
 
   // Priority thread pool to handle parallel processing of methods, either
   // shrinking initially / after inlining into them, or even to inline in
-  // parallel. By default, parallelism is disabled num_threads = 0).
+  // parallel. All other parallel work of the inliner runs on it as well. By
+  // default, parallelism is disabled num_threads = 0).
   PriorityThreadPool m_async_method_executor{0};
 
   // For parallel execution, priorities for methods, to minimize waiting.
@@ -525,9 +532,11 @@ class MultiMethodInliner {
   std::unordered_map<const DexMethod*, std::vector<DexMethod*>>
       m_async_caller_callees;
 
-  // For parallel execution, number of remaining callees any given caller is
-  // still waiting for.
-  ConcurrentMap<const DexMethod*, size_t> m_async_caller_wait_counts;
+  // For parallel execution, the inlining work item of any given caller, which
+  // is waiting for the remaining callees. Populated before any work starts.
+  std::unordered_map<const DexMethod*,
+                     std::unique_ptr<PriorityThreadPool::DependentWorkItem>>
+      m_async_caller_work_items;
 
   // For parallel execution, number of remaining callers any given delayed
   // shrinking callee is still waiting for.
@@ -589,6 +598,7 @@ class MultiMethodInliner {
     size_t recursive{0};
     size_t max_call_stack_depth{0};
     size_t waited_seconds{0};
+    size_t stolen_work_items{0};
     int critical_path_length{0};
 
     // statistics that may be incremented concurrently
@@ -656,7 +666,7 @@ class MultiMethodInliner {
     return m_dedup_blocks_stats;
   }
   size_t get_methods_shrunk() { return m_methods_shrunk; }
-  size_t get_callers() { return m_async_caller_wait_counts.size(); }
+  size_t get_callers() { return m_async_caller_work_items.size(); }
   size_t get_delayed_shrinking_callees() {
     return m_async_delayed_shrinking_callee_wait_counts.size();
   }
@@ -446,6 +446,7 @@ void run_inliner(DexStoresVector& stores,
       inliner.get_info().constant_invoke_callees_unreachable_blocks);
   mgr.incr_metric("critical_path_length",
                   inliner.get_info().critical_path_length);
+  mgr.incr_metric("stolen_work_items", inliner.get_info().stolen_work_items);
   mgr.incr_metric("methods_shrunk", inliner.get_methods_shrunk());
   mgr.incr_metric("callers", inliner.get_callers());
   mgr.incr_metric("delayed_shrinking_callees",
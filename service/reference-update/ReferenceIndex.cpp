@@ -0,0 +1,258 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "ReferenceIndex.h"
+
+#include <algorithm>
+#include <atomic>
+
+#include "ConcurrentContainers.h"
+#include "Debug.h"
+#include "IRCode.h"
+#include "Resolver.h"
+#include "Show.h"
+#include "Trace.h"
+#include "TypeUtil.h"
+#include "Walkers.h"
+#include "WorkQueue.h"
+
+namespace {
+
+template <typename Key, typename Value>
+void append(ConcurrentMap<Key, std::vector<Value>>& map,
+            Key key,
+            Value value) {
+  map.update(key, [&](Key, std::vector<Value>& values, bool) {
+    values.push_back(std::move(value));
+  });
+}
+
+template <typename Key, typename Value>
+void move_into(ConcurrentMap<Key, std::vector<Value>>& from,
+               std::unordered_map<Key, std::vector<Value>>* to) {
+  to->reserve(from.size());
+  for (auto& pair : from) {
+    to->emplace(pair.first, std::move(pair.second));
+  }
+}
+
+template <typename Key, typename Value>
+const std::vector<Value>& find_or_empty(
+    const std::unordered_map<Key, std::vector<Value>>& map, const Key& key) {
+  static const std::vector<Value> empty;
+  auto it = map.find(key);
+  return it == map.end() ? empty : it->second;
+}
+
+/*
+ * Apply `rewrite` to the entries of all old keys in parallel, then re-index
+ * the entries under their new keys. Entries of different old keys are
+ * disjoint, so the rewrites don't interfere with each other. Returns the
+ * number of rewritten entries.
+ */
+template <typename Key, typename NewKey, typename Value, typename RewriteFn>
+size_t rewrite_entries(std::unordered_map<Key, std::vector<Value>>* index,
+                       const std::unordered_map<Key, NewKey>& old_to_new,
+                       const RewriteFn& rewrite) {
+  std::vector<std::pair<NewKey, std::vector<Value>>> affected;
+  for (const auto& pair : old_to_new) {
+    auto it = index->find(pair.first);
+    if (it == index->end() || it->second.empty()) {
+      continue;
+    }
+    affected.emplace_back(pair.second, std::move(it->second));
+    index->erase(it);
+  }
+  std::atomic<size_t> rewritten{0};
+  auto wq = workqueue_foreach<size_t>([&](size_t i) {
+    auto& entries = affected[i];
+    for (auto& value : entries.second) {
+      rewrite(entries.first, value);
+    }
+    rewritten += entries.second.size();
+  });
+  for (size_t i = 0; i < affected.size(); i++) {
+    wq.add_item(i);
+  }
+  wq.run_all();
+  for (auto& entries : affected) {
+    auto& values = (*index)[entries.first];
+    values.insert(values.end(),
+                  std::make_move_iterator(entries.second.begin()),
+                  std::make_move_iterator(entries.second.end()));
+  }
+  return rewritten;
+}
+
+} // namespace
+
+namespace reference_index {
+
+Index::Index(const Scope& scope, unsigned kinds) : m_kinds(kinds) {
+  ConcurrentMap<const DexMethod*, Uses> callers;
+  ConcurrentMap<const DexFieldRef*, Uses> field_uses;
+  ConcurrentMap<const DexType*, Uses> type_uses;
+  if (m_kinds & (CALLERS | FIELD_USES | TYPE_USES)) {
+    walk::parallel::code(scope, [&](DexMethod* meth, IRCode& code) {
+      for (auto& mie : InstructionIterable(code)) {
+        auto insn = mie.insn;
+        if (insn->has_method()) {
+          if (!(m_kinds & CALLERS)) {
+            continue;
+          }
+          const DexMethod* callee = resolve_method(
+              insn->get_method(), opcode_to_search(insn), meth);
+          if (callee != nullptr) {
+            append(callers, callee, Use(meth, insn));
+          }
+        } else if (insn->has_field()) {
+          if (m_kinds & FIELD_USES) {
+            const DexFieldRef* field = insn->get_field();
+            append(field_uses, field, Use(meth, insn));
+          }
+        } else if (insn->has_type()) {
+          if (m_kinds & TYPE_USES) {
+            const DexType* type =
+                type::get_element_type_if_array(insn->get_type());
+            append(type_uses, type, Use(meth, insn));
+          }
+        }
+      }
+    });
+  }
+
+  ConcurrentMap<const DexType*, std::vector<DexField*>> fields_of_type;
+  if (m_kinds & FIELDS_OF_TYPE) {
+    walk::parallel::fields(scope, [&](DexField* field) {
+      const DexType* type =
+          type::get_element_type_if_array(field->get_type());
+      append(fields_of_type, type, field);
+    });
+  }
+
+  ConcurrentMap<const DexType*, std::vector<DexMethod*>> methods_mentioning;
+  if (m_kinds & METHODS_MENTIONING) {
+    walk::parallel::methods(scope, [&](DexMethod* method) {
+      auto proto = method->get_proto();
+      std::vector<const DexType*> types;
+      types.push_back(type::get_element_type_if_array(proto->get_rtype()));
+      for (const auto arg : proto->get_args()->get_type_list()) {
+        types.push_back(type::get_element_type_if_array(arg));
+      }
+      std::sort(types.begin(), types.end());
+      types.erase(std::unique(types.begin(), types.end()), types.end());
+      for (auto type : types) {
+        append(methods_mentioning, type, method);
+      }
+    });
+  }
+
+  move_into(callers, &m_callers);
+  move_into(field_uses, &m_field_uses);
+  move_into(type_uses, &m_type_uses);
+  move_into(fields_of_type, &m_fields_of_type);
+  move_into(methods_mentioning, &m_methods_mentioning);
+  TRACE(REFU, 2,
+        "Reference index: %zu callees, %zu fields, %zu types, %zu field "
+        "types, %zu proto types",
+        m_callers.size(), m_field_uses.size(), m_type_uses.size(),
+        m_fields_of_type.size(), m_methods_mentioning.size());
+}
+
+void Index::assert_indexed(Kind kind) const {
+  always_assert_log(m_kinds & kind, "Reference kind %u is not indexed", kind);
+}
+
+const Uses& Index::callers_of(const DexMethod* callee) const {
+  assert_indexed(CALLERS);
+  return find_or_empty(m_callers, callee);
+}
+
+const Uses& Index::field_uses(const DexFieldRef* field) const {
+  assert_indexed(FIELD_USES);
+  return find_or_empty(m_field_uses, field);
+}
+
+const Uses& Index::type_uses(const DexType* type) const {
+  assert_indexed(TYPE_USES);
+  return find_or_empty(m_type_uses, type);
+}
+
+const std::vector<DexField*>& Index::fields_of_type(
+    const DexType* type) const {
+  assert_indexed(FIELDS_OF_TYPE);
+  return find_or_empty(m_fields_of_type, type);
+}
+
+const std::vector<DexMethod*>& Index::methods_mentioning(
+    const DexType* type) const {
+  assert_indexed(METHODS_MENTIONING);
+  return find_or_empty(m_methods_mentioning, type);
+}
+
+size_t Index::update_call_refs(
+    const std::unordered_map<DexMethod*, DexMethod*>& old_to_new_callee) {
+  assert_indexed(CALLERS);
+  std::unordered_map<const DexMethod*, DexMethod*> old_to_new(
+      old_to_new_callee.begin(), old_to_new_callee.end());
+  return rewrite_entries(
+      &m_callers, old_to_new, [](DexMethod* new_callee, Use& use) {
+        auto insn = use.insn;
+        // At this point, a non static private should not exist.
+        always_assert_log(!is_private(new_callee) || is_static(new_callee),
+                          "%s\n",
+                          vshow(new_callee).c_str());
+        TRACE(REFU, 9, " Updated call %s to %s", SHOW(insn), SHOW(new_callee));
+        insn->set_method(new_callee);
+        if (new_callee->is_virtual()) {
+          always_assert_log(opcode::is_invoke_virtual(insn->opcode()),
+                            "invalid callsite %s\n",
+                            SHOW(insn));
+        } else if (is_static(new_callee)) {
+          always_assert_log(opcode::is_invoke_static(insn->opcode()),
+                            "invalid callsite %s\n",
+                            SHOW(insn));
+        }
+      });
+}
+
+size_t Index::update_field_refs(
+    const std::unordered_map<DexFieldRef*, DexFieldRef*>& old_to_new) {
+  assert_indexed(FIELD_USES);
+  std::unordered_map<const DexFieldRef*, DexFieldRef*> old_to_new_fields(
+      old_to_new.begin(), old_to_new.end());
+  return rewrite_entries(&m_field_uses, old_to_new_fields,
+                         [](DexFieldRef* new_field, Use& use) {
+                           use.insn->set_field(new_field);
+                         });
+}
+
+size_t Index::update_type_refs(
+    const std::unordered_map<const DexType*, DexType*>& old_to_new) {
+  assert_indexed(TYPE_USES);
+  return rewrite_entries(
+      &m_type_uses, old_to_new, [](DexType* new_type, Use& use) {
+        auto level = type::get_array_level(use.insn->get_type());
+        use.insn->set_type(type::make_array_type(new_type, level));
+      });
+}
+
+size_t Index::update_field_type_references(
+    const std::unordered_map<const DexType*, DexType*>& old_to_new) {
+  assert_indexed(FIELDS_OF_TYPE);
+  TRACE(REFU, 4, " updating field refs");
+  return rewrite_entries(
+      &m_fields_of_type, old_to_new, [](DexType* new_type, DexField* field) {
+        auto level = type::get_array_level(field->get_type());
+        DexFieldSpec spec;
+        spec.type = type::make_array_type(new_type, level);
+        field->change(spec);
+        TRACE(REFU, 9, " updating field ref to %s", SHOW(new_type));
+      });
+}
+
+} // namespace reference_index
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "DexClass.h"
+#include "IRInstruction.h"
+
+namespace reference_index {
+
+// An instruction of a method that mentions an indexed method, field or type.
+struct Use {
+  DexMethod* method;
+  IRInstruction* insn;
+  Use(DexMethod* method, IRInstruction* insn) : method(method), insn(insn) {}
+};
+
+using Uses = std::vector<Use>;
+
+/**
+ * A reverse index from methods, fields and types to the instructions and
+ * signatures in a scope that mention them. Building it walks all code once, in
+ * parallel; afterwards, the bulk rewrites below only touch the affected
+ * references instead of walking the whole scope again for every batch.
+ *
+ * The index reflects the scope at construction time, and the rewrites keep it
+ * up to date. Any other change to the code in the scope invalidates it.
+ *
+ * Only the kinds of references passed at construction are indexed, so that
+ * clients pay only for what they query. Querying or rewriting a kind that was
+ * not indexed is an error.
+ *
+ * Uses are kept in no particular order.
+ */
+class Index {
+ public:
+  enum Kind : unsigned {
+    CALLERS = 1 << 0,
+    FIELD_USES = 1 << 1,
+    TYPE_USES = 1 << 2,
+    FIELDS_OF_TYPE = 1 << 3,
+    METHODS_MENTIONING = 1 << 4,
+    ALL = (1 << 5) - 1,
+  };
+
+  explicit Index(const Scope& scope, unsigned kinds = ALL);
+
+  // Method-bearing instructions whose method resolves to the given definition,
+  // with the same resolution as method_reference::update_call_refs_simple.
+  const Uses& callers_of(const DexMethod* callee) const;
+
+  // Field-bearing instructions referencing exactly the given field ref.
+  const Uses& field_uses(const DexFieldRef* field) const;
+
+  // Type-bearing instructions whose type is the given type, or an array of it.
+  const Uses& type_uses(const DexType* type) const;
+
+  // Field definitions in the scope whose type is the given type, or an array
+  // of it.
+  const std::vector<DexField*>& fields_of_type(const DexType* type) const;
+
+  // Method definitions in the scope whose proto mentions the given type, or
+  // an array of it, as return or argument type.
+  const std::vector<DexMethod*>& methods_mentioning(const DexType* type) const;
+
+  /**
+   * Same as method_reference::update_call_refs_simple, but only visits the
+   * callers of the old callees, in parallel. Returns the number of updated
+   * instructions.
+   */
+  size_t update_call_refs(
+      const std::unordered_map<DexMethod*, DexMethod*>& old_to_new_callee);
+
+  /**
+   * Point all instructions referencing an old field ref to the new one.
+   * Returns the number of updated instructions.
+   */
+  size_t update_field_refs(
+      const std::unordered_map<DexFieldRef*, DexFieldRef*>& old_to_new);
+
+  /**
+   * Replace old types by new ones in the type operands of all instructions,
+   * keeping array levels: LOld; => LNew; [LOld; => [LNew; ...
+   * Returns the number of updated instructions.
+   */
+  size_t update_type_refs(
+      const std::unordered_map<const DexType*, DexType*>& old_to_new);
+
+  /**
+   * Same as the field definition update of
+   * type_reference::update_field_type_references, but only visits the fields
+   * of the old types, in parallel. Returns the number of updated fields.
+   */
+  size_t update_field_type_references(
+      const std::unordered_map<const DexType*, DexType*>& old_to_new);
+
+ private:
+  void assert_indexed(Kind kind) const;
+
+  unsigned m_kinds;
+  std::unordered_map<const DexMethod*, Uses> m_callers;
+  std::unordered_map<const DexFieldRef*, Uses> m_field_uses;
+  std::unordered_map<const DexType*, Uses> m_type_uses;
+  std::unordered_map<const DexType*, std::vector<DexField*>> m_fields_of_type;
+  std::unordered_map<const DexType*, std::vector<DexMethod*>>
+      m_methods_mentioning;
+};
+
+} // namespace reference_index
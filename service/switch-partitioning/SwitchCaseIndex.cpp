@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "SwitchCaseIndex.h"
+
+#include <algorithm>
+#include <boost/functional/hash.hpp>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "Debug.h"
+#include "IRInstruction.h"
+#include "IROpcode.h"
+
+namespace {
+
+// Stands in for the fingerprint of a block that is still being hashed, i.e.
+// for the target of an edge that closes a cycle.
+constexpr size_t CYCLE_MARKER = 0x9e3779b97f4a7c15ULL;
+
+// Hashes the subgraph reachable from a block, bottom-up: the fingerprint of a
+// block combines its instructions with the fingerprints of its successors.
+// Blocks are visited once and iteratively, so deep chains of blocks can't
+// overflow the stack.
+class Fingerprinter {
+ public:
+  size_t get(cfg::Block* root) {
+    auto it = m_fingerprints.find(root);
+    if (it != m_fingerprints.end()) {
+      return it->second;
+    }
+    struct Frame {
+      cfg::Block* block;
+      size_t next_succ;
+    };
+    std::vector<Frame> stack;
+    stack.push_back({root, 0});
+    m_on_stack.insert(root);
+    while (!stack.empty()) {
+      auto& frame = stack.back();
+      const auto& succs = frame.block->succs();
+      if (frame.next_succ < succs.size()) {
+        auto next = succs[frame.next_succ++]->target();
+        if (!m_fingerprints.count(next) && !m_on_stack.count(next)) {
+          m_on_stack.insert(next);
+          stack.push_back({next, 0});
+        }
+        continue;
+      }
+      m_fingerprints.emplace(frame.block, hash_block(frame.block));
+      m_on_stack.erase(frame.block);
+      stack.pop_back();
+    }
+    return m_fingerprints.at(root);
+  }
+
+ private:
+  size_t hash_block(cfg::Block* block) const {
+    size_t seed = 0;
+    for (const auto& mie : InstructionIterable(block)) {
+      boost::hash_combine(seed, mie.insn->hash());
+    }
+    for (const auto* edge : block->succs()) {
+      boost::hash_combine(seed, static_cast<size_t>(edge->type()));
+      if (edge->type() == cfg::EDGE_THROW) {
+        boost::hash_combine(seed, edge->throw_info()->catch_type);
+      } else if (edge->case_key()) {
+        boost::hash_combine(seed, *edge->case_key());
+      }
+      auto it = m_fingerprints.find(edge->target());
+      boost::hash_combine(
+          seed, it == m_fingerprints.end() ? CYCLE_MARKER : it->second);
+    }
+    return seed;
+  }
+
+  std::unordered_map<cfg::Block*, size_t> m_fingerprints;
+  std::unordered_set<cfg::Block*> m_on_stack;
+};
+
+} // namespace
+
+SwitchCaseIndex::SwitchCaseIndex(cfg::Block* switch_block) {
+  always_assert(
+      opcode::is_switch(switch_block->get_last_insn()->insn->opcode()));
+  std::vector<std::pair<int32_t, cfg::Block*>> cases;
+  cases.reserve(switch_block->succs().size());
+  for (const auto* edge : switch_block->succs()) {
+    if (edge->type() != cfg::EDGE_BRANCH) {
+      if (edge->type() == cfg::EDGE_GOTO) {
+        m_default_target = edge->target();
+      }
+      continue;
+    }
+    cases.emplace_back(*edge->case_key(), edge->target());
+  }
+  std::sort(cases.begin(), cases.end(), [](const auto& a, const auto& b) {
+    return a.first < b.first;
+  });
+
+  m_keys.reserve(cases.size());
+  m_targets.reserve(cases.size());
+  for (const auto& p : cases) {
+    m_keys.push_back(p.first);
+    m_targets.push_back(p.second);
+  }
+}
+
+void SwitchCaseIndex::compute_classes() const {
+  if (m_classes.size() == m_targets.size()) {
+    return;
+  }
+  m_classes.reserve(m_targets.size());
+  Fingerprinter fingerprinter;
+  std::unordered_map<size_t, size_t> fingerprint_to_class;
+  for (auto* target : m_targets) {
+    auto fingerprint = fingerprinter.get(target);
+    auto it = fingerprint_to_class.emplace(fingerprint, m_num_classes).first;
+    if (it->second == m_num_classes) {
+      ++m_num_classes;
+    }
+    m_classes.push_back(it->second);
+  }
+}
+
+std::vector<int32_t> SwitchCaseIndex::split_points(size_t n) const {
+  std::vector<int32_t> points;
+  size_t size = m_keys.size();
+  if (size == 0 || size <= n) {
+    return points;
+  }
+  // Every range gets its share of the cases, rounded down. The split count is
+  // chosen from the method size, so moving the split points, e.g. to keep runs
+  // of equivalent cases together, could push a split over the size limit.
+  for (size_t i = 1; i < n; ++i) {
+    points.push_back(m_keys[(i * size) / n - 1]);
+  }
+  points.push_back(m_keys.back());
+  return points;
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "ControlFlow.h"
+
+/*
+ * An index over the cases of a switch block: the case keys in ascending order,
+ * each with the block it jumps to.
+ *
+ * Every case target can also get a fingerprint of the subgraph reachable from
+ * it. Fingerprints are computed bottom-up and memoized per block, so each block
+ * is hashed once no matter how many cases reach it. Cases with equal
+ * fingerprints form an equivalence class: they jump to the same block, or to
+ * code that very likely does the same thing. The classes only guide
+ * heuristics; a hash collision can make two classes merge but never makes a
+ * transformation unsound.
+ *
+ * Building the index takes time linear in the number of cases, plus a sort of
+ * the keys. The fingerprints are only computed on the first query of the
+ * equivalence classes, in time linear in the size of the code reachable from
+ * the cases. The index keeps a constant amount of memory per case.
+ */
+class SwitchCaseIndex final {
+ public:
+  explicit SwitchCaseIndex(cfg::Block* switch_block);
+
+  size_t size() const { return m_keys.size(); }
+  bool empty() const { return m_keys.empty(); }
+
+  // The case keys, in ascending order.
+  const std::vector<int32_t>& keys() const { return m_keys; }
+  cfg::Block* target(size_t i) const { return m_targets[i]; }
+  // The target of the non-case (GOTO) edge, or nullptr.
+  cfg::Block* default_target() const { return m_default_target; }
+
+  // Ids of the equivalence classes of the cases, numbered in the order in
+  // which they first appear in `keys()`. The first query computes the
+  // fingerprints, so it must not race with other queries.
+  size_t equivalence_class(size_t i) const {
+    compute_classes();
+    return m_classes[i];
+  }
+  size_t num_equivalence_classes() const {
+    compute_classes();
+    return m_num_classes;
+  }
+
+  // The keys to split the cases at, so that the cases fall into `n` ranges of
+  // the same size, up to rounding: range `i` holds the keys in
+  // (split[i-1], split[i]]. The last element is always the largest key. Empty
+  // if there are no more than `n` cases.
+  std::vector<int32_t> split_points(size_t n) const;
+
+ private:
+  void compute_classes() const;
+
+  std::vector<int32_t> m_keys;
+  std::vector<cfg::Block*> m_targets;
+  // Filled in by compute_classes().
+  mutable std::vector<size_t> m_classes;
+  mutable size_t m_num_classes{0};
+  cfg::Block* m_default_target{nullptr};
+};
@@ -7,6 +7,7 @@
 
 #include "SwitchEquivFinder.h"
 
+#include <algorithm>
 #include <queue>
 #include <vector>
 
@@ -338,6 +339,13 @@ void SwitchEquivFinder::normalize_extra_loads(
     }
   }
 
+  if (extra_loads.empty()) {
+    // Nothing to prune, so skip the fixpoint over the whole method. That's
+    // the common case for a plain switch with many cases.
+    m_extra_loads.clear();
+    return;
+  }
+
   // Use ReachingDefinitions to find the loads that are used outside the if-else
   // chain blocks
   std::unordered_set<IRInstruction*> used_defs;
@@ -383,6 +391,20 @@ void SwitchEquivFinder::normalize_extra_loads(
 // Use a sparta analysis to find the value of reg at the beginning of each leaf
 // block
 void SwitchEquivFinder::find_case_keys(const std::vector<cfg::Edge*>& leaves) {
+  if (opcode::is_switch(m_root_branch->insn->opcode()) &&
+      std::all_of(leaves.begin(), leaves.end(), [this](cfg::Edge* e) {
+        return e->src() == m_root_branch.block();
+      })) {
+    // A plain switch: the case keys are on the edges already. Don't run a
+    // constant propagation over the whole method, which for a switch with
+    // thousands of cases costs far more than the switch itself.
+    for (cfg::Edge* edge_to_leaf : leaves) {
+      m_key_to_case.emplace(edge_to_leaf->case_key(), edge_to_leaf->target());
+    }
+    m_success = true;
+    return;
+  }
+
   // We use the fixpoint iterator to infer the values of registers at different
   // points in the program. Especially `m_switching_reg`.
   cp::intraprocedural::FixpointIterator fixpoint(
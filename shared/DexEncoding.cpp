@@ -23,3 +23,258 @@ void throw_invalid(const char* msg) { throw std::invalid_argument(msg); }
 
 } // namespace details
 } // namespace dex_encoding
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define MUTF8_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace mutf8 {
+
+namespace {
+
+inline bool is_continuation(uint8_t c) { return (c & 0xc0) == 0x80; }
+
+// Number of bytes in the sequence started by the lead byte `c`, or 0 if `c`
+// cannot start a MUTF-8 sequence.
+inline size_t sequence_length(uint8_t c) {
+  if (c < 0x80) {
+    return c == 0 ? 0 : 1;
+  } else if ((c & 0xe0) == 0xc0) {
+    return 2;
+  } else if ((c & 0xf0) == 0xe0) {
+    return 3;
+  }
+  return 0;
+}
+
+// Validates and counts the code points in [begin, end) of `s`, starting at a
+// code point boundary. Returns the position of the next code point boundary,
+// which may lie past `end` if the last sequence straddles it, or `size_t(-1)`
+// if the input is malformed.
+size_t validate_scalar(const uint8_t* s,
+                       size_t begin,
+                       size_t end,
+                       size_t size,
+                       uint32_t* len) {
+  size_t i = begin;
+  while (i < end) {
+    size_t n = sequence_length(s[i]);
+    if (n == 0 || i + n > size) {
+      return size_t(-1);
+    }
+    for (size_t k = 1; k < n; ++k) {
+      if (!is_continuation(s[i + k])) {
+        return size_t(-1);
+      }
+    }
+    i += n;
+    ++*len;
+  }
+  return i;
+}
+
+size_t count_continuations_scalar(const uint8_t* s, size_t begin, size_t end) {
+  size_t count = 0;
+  for (size_t i = begin; i < end; ++i) {
+    count += is_continuation(s[i]);
+  }
+  return count;
+}
+
+size_t mismatch_scalar(const uint8_t* a,
+                       const uint8_t* b,
+                       size_t begin,
+                       size_t size) {
+  size_t i = begin;
+  while (i < size && a[i] == b[i]) {
+    ++i;
+  }
+  return i;
+}
+
+#ifdef MUTF8_X86_KERNELS
+
+uint32_t utf16_length_sse2(const uint8_t* s, size_t size) {
+  // Continuation bytes 0x80..0xbf are exactly the signed bytes below -64.
+  const __m128i limit = _mm_set1_epi8(-64);
+  size_t continuations = 0;
+  size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(s + i));
+    continuations +=
+        __builtin_popcount(_mm_movemask_epi8(_mm_cmplt_epi8(v, limit)));
+  }
+  continuations += count_continuations_scalar(s, i, size);
+  return (uint32_t)(size - continuations);
+}
+
+__attribute__((target("avx2"))) uint32_t utf16_length_avx2(const uint8_t* s,
+                                                           size_t size) {
+  const __m256i limit = _mm256_set1_epi8(-64);
+  size_t continuations = 0;
+  size_t i = 0;
+  for (; i + 32 <= size; i += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i*)(s + i));
+    continuations += __builtin_popcount(
+        (uint32_t)_mm256_movemask_epi8(_mm256_cmpgt_epi8(limit, v)));
+  }
+  continuations += count_continuations_scalar(s, i, size);
+  return (uint32_t)(size - continuations);
+}
+
+// A block is pure ASCII without NULs iff no byte has its top bit set and no
+// byte is zero, i.e. every signed byte is strictly positive.
+bool validate_sse2(const uint8_t* s, size_t size, uint32_t* len) {
+  const __m128i zero = _mm_setzero_si128();
+  size_t i = 0;
+  while (i + 16 <= size) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(s + i));
+    if (_mm_movemask_epi8(_mm_cmpgt_epi8(v, zero)) == 0xffff) {
+      i += 16;
+      *len += 16;
+      continue;
+    }
+    i = validate_scalar(s, i, i + 16, size, len);
+    if (i == size_t(-1)) {
+      return false;
+    }
+  }
+  return validate_scalar(s, i, size, size, len) != size_t(-1);
+}
+
+__attribute__((target("avx2"))) bool validate_avx2(const uint8_t* s,
+                                                   size_t size,
+                                                   uint32_t* len) {
+  const __m256i zero = _mm256_setzero_si256();
+  size_t i = 0;
+  while (i + 32 <= size) {
+    __m256i v = _mm256_loadu_si256((const __m256i*)(s + i));
+    if ((uint32_t)_mm256_movemask_epi8(_mm256_cmpgt_epi8(v, zero)) ==
+        0xffffffff) {
+      i += 32;
+      *len += 32;
+      continue;
+    }
+    i = validate_scalar(s, i, i + 32, size, len);
+    if (i == size_t(-1)) {
+      return false;
+    }
+  }
+  return validate_scalar(s, i, size, size, len) != size_t(-1);
+}
+
+size_t mismatch_sse2(const uint8_t* a, const uint8_t* b, size_t size) {
+  size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    __m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+    __m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+    uint32_t eq = _mm_movemask_epi8(_mm_cmpeq_epi8(va, vb));
+    if (eq != 0xffff) {
+      return i + __builtin_ctz(~eq);
+    }
+  }
+  return mismatch_scalar(a, b, i, size);
+}
+
+__attribute__((target("avx2"))) size_t mismatch_avx2(const uint8_t* a,
+                                                     const uint8_t* b,
+                                                     size_t size) {
+  size_t i = 0;
+  for (; i + 32 <= size; i += 32) {
+    __m256i va = _mm256_loadu_si256((const __m256i*)(a + i));
+    __m256i vb = _mm256_loadu_si256((const __m256i*)(b + i));
+    uint32_t eq = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb));
+    if (eq != 0xffffffff) {
+      return i + __builtin_ctz(~eq);
+    }
+  }
+  return mismatch_scalar(a, b, i, size);
+}
+
+bool has_avx2() {
+  static const bool supported = [] {
+    // Strings may be created from static initializers, before libgcc had a
+    // chance to initialize its CPU model.
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+  }();
+  return supported;
+}
+
+#endif // MUTF8_X86_KERNELS
+
+} // namespace
+
+uint32_t utf16_length(const char* s, size_t size) {
+  auto us = (const uint8_t*)s;
+#ifdef MUTF8_X86_KERNELS
+  return has_avx2() ? utf16_length_avx2(us, size) : utf16_length_sse2(us, size);
+#else
+  return (uint32_t)(size - count_continuations_scalar(us, 0, size));
+#endif
+}
+
+bool validate(const char* s, size_t size, uint32_t* utf16_length) {
+  auto us = (const uint8_t*)s;
+  uint32_t len = 0;
+#ifdef MUTF8_X86_KERNELS
+  bool valid = has_avx2() ? validate_avx2(us, size, &len)
+                          : validate_sse2(us, size, &len);
+#else
+  bool valid = validate_scalar(us, 0, size, size, &len) != size_t(-1);
+#endif
+  if (valid && utf16_length != nullptr) {
+    *utf16_length = len;
+  }
+  return valid;
+}
+
+size_t mismatch(const char* a, const char* b, size_t size) {
+  auto ua = (const uint8_t*)a;
+  auto ub = (const uint8_t*)b;
+#ifdef MUTF8_X86_KERNELS
+  return has_avx2() ? mismatch_avx2(ua, ub, size)
+                    : mismatch_sse2(ua, ub, size);
+#else
+  return mismatch_scalar(ua, ub, 0, size);
+#endif
+}
+
+int compare(const char* a, size_t a_size, const char* b, size_t b_size) {
+  size_t common = a_size < b_size ? a_size : b_size;
+  size_t i = mismatch(a, b, common);
+  if (i == common) {
+    return a_size == b_size ? 0 : (a_size < b_size ? -1 : 1);
+  }
+  // The strings agree on [0, i). If the last lead byte of that prefix starts a
+  // sequence that extends to i, the mismatch is inside that code point.
+  auto ua = (const uint8_t*)a;
+  size_t start = i;
+  for (size_t k = i; k > 0 && i - k < 3;) {
+    --k;
+    if (!is_continuation(ua[k])) {
+      if (k + sequence_length(ua[k]) > i) {
+        start = k;
+      }
+      break;
+    }
+  }
+  const char* sa = a + start;
+  const char* sb = b + start;
+  while (true) {
+    if (*sa == '\0') {
+      return *sb == '\0' ? 0 : -1;
+    }
+    if (*sb == '\0') {
+      return 1;
+    }
+    uint32_t cpa = mutf8_next_code_point(sa);
+    uint32_t cpb = mutf8_next_code_point(sb);
+    if (cpa != cpb) {
+      return cpa < cpb ? -1 : 1;
+    }
+  }
+}
+
+} // namespace mutf8
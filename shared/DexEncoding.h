@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <cstring>
 #include <stdint.h>
 #include <string>
 
@@ -187,11 +188,58 @@ inline uint32_t mutf8_next_code_point(const char*& s) {
   dex_encoding::details::throw_invalid("Invalid size encoding mutf8 string");
 }
 
+/*
+ * Vectorized MUTF-8 kernels. On x86-64 they process 16 bytes at a time with
+ * SSE2 and 32 bytes at a time when the CPU supports AVX2 (selected at
+ * runtime); other targets use the scalar code. The common case in dex files is
+ * long runs of ASCII, which never leave the vector loops.
+ *
+ * All of them take an explicit byte size and never read past it.
+ */
+namespace mutf8 {
+
+/*
+ * Number of UTF-16 code units in the first `size` bytes of a well-formed
+ * MUTF-8 string, i.e. the number of bytes that are not continuation bytes.
+ * The input is not validated.
+ */
+uint32_t utf16_length(const char* s, size_t size);
+
+/*
+ * Returns true if the `size` bytes at `s` are well-formed MUTF-8: no NUL
+ * bytes, no four-byte forms and every lead byte followed by the right number
+ * of continuation bytes. If so and `utf16_length` is non-null, it receives the
+ * number of UTF-16 code units.
+ */
+bool validate(const char* s, size_t size, uint32_t* utf16_length = nullptr);
+
+/*
+ * Three-way comparison of two well-formed, NUL-terminated MUTF-8 strings by
+ * UTF-16 code unit, which is the order the dex format mandates for the string
+ * table. Byte order only differs from it for the two-byte encoding of U+0000,
+ * so the kernel finds the first differing byte and decodes from the start of
+ * the enclosing code point.
+ */
+int compare(const char* a, size_t a_size, const char* b, size_t b_size);
+
+/*
+ * Index of the first differing byte among the first `size` bytes of `a` and
+ * `b`, or `size` if they are equal.
+ */
+size_t mismatch(const char* a, const char* b, size_t size);
+
+} // namespace mutf8
+
 inline uint32_t length_of_utf8_string(const char* s) {
   if (s == nullptr) {
     return 0;
   }
   uint32_t len = 0;
+  if (mutf8::validate(s, strlen(s), &len)) {
+    return len;
+  }
+  // Malformed; decode one code point at a time to report the error.
+  len = 0;
   while (*s != '\0') {
     ++len;
     mutf8_next_code_point(s);
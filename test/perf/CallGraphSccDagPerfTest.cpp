@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include <boost/functional/hash.hpp>
+#include <random>
+#include <string>
+#include <sys/time.h>
+#include <vector>
+
+#include "CallGraph.h"
+#include "ConcurrentContainers.h"
+#include "IRAssembler.h"
+#include "PatriciaTreeSet.h"
+#include "RedexTest.h"
+#include "Walkers.h"
+
+namespace {
+
+unsigned long long get_time_in_ms() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  unsigned long long microsec = tv.tv_usec;
+  unsigned long long sec = tv.tv_sec;
+  return microsec / 1000 + sec * 1000;
+}
+
+using SummaryMap = ConcurrentMap<const DexMethod*, size_t>;
+
+// Stands in for the analysis of a method: combines the summaries of the
+// callees that are known, and burns some time.
+size_t summarize(const DexMethod* method,
+                 const call_graph::Graph& graph,
+                 const SummaryMap& summaries) {
+  size_t seed = 0;
+  for (const auto& edge : graph.node(method)->callees()) {
+    auto callee = edge->callee()->method();
+    if (summaries.count(callee) != 0) {
+      boost::hash_combine(seed, summaries.at(callee));
+    }
+  }
+  for (size_t i = 0; i < 2000; ++i) {
+    boost::hash_combine(seed, i);
+  }
+  return seed;
+}
+
+// The ordering that side_effects::analyze_scope used before SccDag: every
+// thread starts a DFS from each of its methods, and analyzes the callees it
+// reaches first. Within a cycle, the callee that is being visited is skipped.
+void analyze_recursive(const DexMethod* method,
+                       const call_graph::Graph& graph,
+                       sparta::PatriciaTreeSet<const DexMethodRef*> visiting,
+                       SummaryMap* summaries) {
+  if (summaries->count(method) != 0 || visiting.contains(method)) {
+    return;
+  }
+  visiting.insert(method);
+  for (const auto& edge : graph.node(method)->callees()) {
+    analyze_recursive(edge->callee()->method(), graph, visiting, summaries);
+  }
+  summaries->emplace(method, summarize(method, graph, *summaries));
+}
+
+} // namespace
+
+class CallGraphSccDagPerfTest : public RedexTest {};
+
+// The methods form components of kSccSize methods. Each method calls the next
+// one in its component, which closes a cycle, a random member of its own
+// component and a random method of a lower component.
+TEST_F(CallGraphSccDagPerfTest, LargeComponents) {
+  constexpr size_t kNumSccs = 40;
+  constexpr size_t kSccSize = 250;
+  constexpr size_t kNumMethods = kNumSccs * kSccSize;
+  std::mt19937 rng(0);
+  auto name = [](size_t i) { return "m" + std::to_string(i); };
+  auto invoke = [&](size_t i) {
+    return "(invoke-static () \"LFoo;." + name(i) + ":()V\")\n";
+  };
+  std::vector<DexMethod*> all;
+  for (size_t i = 0; i < kNumMethods; ++i) {
+    size_t scc = i / kSccSize;
+    size_t first = scc * kSccSize;
+    std::string body = invoke(first + (i + 1 - first) % kSccSize);
+    body += invoke(first + rng() % kSccSize);
+    if (scc > 0) {
+      body += invoke(rng() % first);
+    }
+    all.push_back(assembler::method_from_string(
+        "(method (public static) \"LFoo;." + name(i) + ":()V\" (" + body +
+        "(return-void)))"));
+  }
+  Scope scope{assembler::class_with_methods("LFoo;", all)};
+  for (auto method : all) {
+    method->rstate.set_root();
+  }
+  auto graph = call_graph::single_callee_graph(scope);
+  std::vector<const DexMethod*> methods(all.begin(), all.end());
+
+  SummaryMap dfs_summaries;
+  unsigned long long ts1 = get_time_in_ms();
+  walk::parallel::methods(scope, [&](DexMethod* method) {
+    analyze_recursive(method, graph, {}, &dfs_summaries);
+  });
+  unsigned long long ts2 = get_time_in_ms();
+  SummaryMap dag_summaries;
+  call_graph::SccDag dag(graph, methods);
+  unsigned long long ts3 = get_time_in_ms();
+  dag.run_bottom_up([&](const std::vector<const DexMethod*>& members) {
+    for (auto method : members) {
+      dag_summaries.emplace(method, summarize(method, graph, dag_summaries));
+    }
+  });
+  unsigned long long ts4 = get_time_in_ms();
+  printf("Execution time (ms) per-thread DFS: %llu SccDag construction: %llu "
+         "run_bottom_up: %llu\n",
+         ts2 - ts1, ts3 - ts2, ts4 - ts3);
+  EXPECT_EQ(dag.size(), kNumSccs);
+  EXPECT_EQ(dag.largest_scc_size(), kSccSize);
+  EXPECT_EQ(dfs_summaries.size(), kNumMethods);
+  EXPECT_EQ(dag_summaries.size(), kNumMethods);
+}
@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <stdlib.h>
+#include <string>
+#include <sys/time.h>
+#include <vector>
+
+#include "DexEncoding.h"
+
+namespace {
+
+unsigned long long get_time_in_ms() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  unsigned long long microsec = tv.tv_usec;
+  unsigned long long sec = tv.tv_sec;
+  return microsec / 1000 + sec * 1000;
+}
+
+uint32_t length_scalar(const char* s) {
+  uint32_t len = 0;
+  while (*s != '\0') {
+    ++len;
+    mutf8_next_code_point(s);
+  }
+  return len;
+}
+
+int compare_scalar(const char* sa, const char* sb) {
+  while (*sa != '\0' && *sb != '\0') {
+    uint32_t cpa = mutf8_next_code_point(sa);
+    uint32_t cpb = mutf8_next_code_point(sb);
+    if (cpa != cpb) {
+      return cpa < cpb ? -1 : 1;
+    }
+  }
+  return *sa == '\0' ? (*sb == '\0' ? 0 : -1) : 1;
+}
+
+std::vector<std::string> make_strings() {
+  std::vector<std::string> strs = {
+      "Lcom/some/class/name;",
+      "Lcom/some/class/name;.methodname:(Ljava/lang/String;I)V",
+      "this string is very long very long very long very long",
+      "caf\303\251 au lait, \342\202\254 3.50, caf\303\251 au lait",
+      "Lcom/facebook/\303\251l\303\251ment/Cl\303\251;",
+      "\300\200 starts with a NUL code point"};
+  std::vector<std::string> result;
+  for (const auto& s : strs) {
+    result.push_back(s);
+    result.push_back(s + "x");
+    result.push_back(s + s);
+  }
+  return result;
+}
+
+} // namespace
+
+TEST(Mutf8PerfTest, Length) {
+  const int iter = 2000000;
+  auto strs = make_strings();
+  unsigned long long result1 = 0;
+  unsigned long long result2 = 0;
+  unsigned long long ts1 = get_time_in_ms();
+  for (int i = 0; i < iter; i++) {
+    for (const auto& s : strs) {
+      result1 += length_scalar(s.c_str());
+    }
+  }
+  unsigned long long ts2 = get_time_in_ms();
+  for (int i = 0; i < iter; i++) {
+    for (const auto& s : strs) {
+      result2 += mutf8::utf16_length(s.c_str(), s.size());
+    }
+  }
+  unsigned long long ts3 = get_time_in_ms();
+  printf("Execution time (ms) scalar length: %llu mutf8::utf16_length: %llu\n",
+         ts2 - ts1, ts3 - ts2);
+  EXPECT_EQ(result1, result2);
+}
+
+TEST(Mutf8PerfTest, Validate) {
+  const int iter = 2000000;
+  auto strs = make_strings();
+  unsigned long long result1 = 0;
+  unsigned long long result2 = 0;
+  unsigned long long ts1 = get_time_in_ms();
+  for (int i = 0; i < iter; i++) {
+    for (const auto& s : strs) {
+      // The scalar decoder throws on malformed input, so this validates too.
+      result1 += length_scalar(s.c_str());
+    }
+  }
+  unsigned long long ts2 = get_time_in_ms();
+  for (int i = 0; i < iter; i++) {
+    for (const auto& s : strs) {
+      uint32_t len = 0;
+      EXPECT_TRUE(mutf8::validate(s.c_str(), s.size(), &len));
+      result2 += len;
+    }
+  }
+  unsigned long long ts3 = get_time_in_ms();
+  printf("Execution time (ms) scalar decode: %llu mutf8::validate: %llu\n",
+         ts2 - ts1, ts3 - ts2);
+  EXPECT_EQ(result1, result2);
+}
+
+TEST(Mutf8PerfTest, Compare) {
+  const int iter = 200000;
+  auto strs = make_strings();
+  long long result1 = 0;
+  long long result2 = 0;
+  unsigned long long ts1 = get_time_in_ms();
+  for (int i = 0; i < iter; i++) {
+    for (const auto& a : strs) {
+      for (const auto& b : strs) {
+        result1 += compare_scalar(a.c_str(), b.c_str());
+      }
+    }
+  }
+  unsigned long long ts2 = get_time_in_ms();
+  for (int i = 0; i < iter; i++) {
+    for (const auto& a : strs) {
+      for (const auto& b : strs) {
+        result2 += mutf8::compare(a.c_str(), a.size(), b.c_str(), b.size());
+      }
+    }
+  }
+  unsigned long long ts3 = get_time_in_ms();
+  printf("Execution time (ms) scalar compare: %llu mutf8::compare: %llu\n",
+         ts2 - ts1, ts3 - ts2);
+  EXPECT_EQ(result1, result2);
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <mutex>
+
+#include "CallGraph.h"
+#include "IRAssembler.h"
+#include "RedexTest.h"
+
+class CallGraphSccDagTest : public RedexTest {
+ public:
+  DexMethod* make_method(const std::string& name,
+                         const std::vector<std::string>& callees) {
+    std::string body;
+    for (const auto& callee : callees) {
+      body += "(invoke-static () \"LFoo;." + callee + ":()V\")\n";
+    }
+    return assembler::method_from_string("(method (public static) \"LFoo;." +
+                                         name + ":()V\" (" + body +
+                                         "(return-void)))");
+  }
+};
+
+TEST_F(CallGraphSccDagTest, componentsAreBottomUp) {
+  // a -> b <-> c -> d, and e on its own.
+  auto a = make_method("a", {"b"});
+  auto b = make_method("b", {"c"});
+  auto c = make_method("c", {"b", "d"});
+  auto d = make_method("d", {});
+  auto e = make_method("e", {});
+  std::vector<DexMethod*> all{a, b, c, d, e};
+  Scope scope{assembler::class_with_methods("LFoo;", all)};
+  for (auto method : all) {
+    method->rstate.set_root();
+  }
+  auto graph = call_graph::single_callee_graph(scope);
+
+  call_graph::SccDag dag(graph, {a, b, c, d, e});
+  ASSERT_EQ(dag.size(), 4);
+  EXPECT_EQ(dag.largest_scc_size(), 2);
+  std::unordered_map<const DexMethod*, size_t> scc_of;
+  for (size_t scc = 0; scc < dag.size(); ++scc) {
+    for (auto method : dag.members(scc)) {
+      scc_of[method] = scc;
+    }
+  }
+  EXPECT_EQ(dag.members(scc_of.at(b)),
+            std::vector<const DexMethod*>({b, c}));
+  EXPECT_LT(scc_of.at(d), scc_of.at(b));
+  EXPECT_LT(scc_of.at(b), scc_of.at(a));
+  EXPECT_EQ(dag.num_callees(scc_of.at(a)), 1);
+  EXPECT_EQ(dag.num_callees(scc_of.at(b)), 1);
+  EXPECT_EQ(dag.num_callees(scc_of.at(d)), 0);
+  EXPECT_EQ(dag.callers(scc_of.at(d)),
+            std::vector<size_t>({scc_of.at(b)}));
+  EXPECT_TRUE(dag.callers(scc_of.at(e)).empty());
+
+  std::mutex mutex;
+  std::vector<const DexMethod*> order;
+  dag.run_bottom_up(
+      [&](const std::vector<const DexMethod*>& members) {
+        std::lock_guard<std::mutex> lock(mutex);
+        order.insert(order.end(), members.begin(), members.end());
+      },
+      /* num_threads */ 4);
+  ASSERT_EQ(order.size(), 5);
+  auto position = [&](const DexMethod* method) {
+    return std::find(order.begin(), order.end(), method) - order.begin();
+  };
+  EXPECT_LT(position(d), position(b));
+  EXPECT_LT(position(d), position(c));
+  EXPECT_LT(position(b), position(a));
+  EXPECT_LT(position(c), position(a));
+}
+
+TEST_F(CallGraphSccDagTest, ignoredCalleesAreNotWaitedFor) {
+  auto a = make_method("a", {"b"});
+  auto b = make_method("b", {"a"});
+  std::vector<DexMethod*> all{a, b};
+  Scope scope{assembler::class_with_methods("LFoo;", all)};
+  for (auto method : all) {
+    method->rstate.set_root();
+  }
+  auto graph = call_graph::single_callee_graph(scope);
+
+  call_graph::SccDag dag(graph, {a, b}, [&](const DexMethod* method) {
+    return method != b;
+  });
+  ASSERT_EQ(dag.size(), 2);
+  EXPECT_EQ(dag.members(0), std::vector<const DexMethod*>({a}));
+  EXPECT_EQ(dag.members(1), std::vector<const DexMethod*>({b}));
+  EXPECT_EQ(dag.num_callees(0), 0);
+  EXPECT_EQ(dag.num_callees(1), 1);
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "ChunkedOutput.h"
+
+#include <gtest/gtest.h>
+#include <sstream>
+
+namespace {
+
+std::string format_sequentially(size_t num_items) {
+  std::ostringstream os;
+  for (size_t i = 0; i < num_items; ++i) {
+    os << "item " << i << '\n';
+  }
+  return os.str();
+}
+
+void format_items(size_t begin, size_t end, std::ostream& os) {
+  for (auto i = begin; i < end; ++i) {
+    os << "item " << i << '\n';
+  }
+}
+
+} // namespace
+
+TEST(ChunkedOutput, preservesItemOrder) {
+  for (size_t num_items : {0, 1, 7, 256, 257, 10000}) {
+    for (size_t items_per_chunk : {1, 3, 256}) {
+      std::ostringstream os;
+      chunked_output::write(os, num_items, format_items, items_per_chunk);
+      EXPECT_EQ(os.str(), format_sequentially(num_items))
+          << num_items << " items, " << items_per_chunk << " per chunk";
+    }
+  }
+}
+
+TEST(ChunkedOutput, chunksCoverAllItems) {
+  std::vector<size_t> seen(1000, 0);
+  std::string written;
+  chunked_output::write(
+      seen.size(),
+      [&](size_t begin, size_t end, std::ostream& os) {
+        for (auto i = begin; i < end; ++i) {
+          seen[i]++;
+        }
+        format_items(begin, end, os);
+      },
+      [&](const std::string& chunk) { written += chunk; },
+      10);
+  for (auto count : seen) {
+    EXPECT_EQ(count, 1);
+  }
+  EXPECT_EQ(written, format_sequentially(seen.size()));
+}
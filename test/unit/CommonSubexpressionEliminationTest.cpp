@@ -1492,6 +1492,65 @@ TEST_F(CommonSubexpressionEliminationTest, recursion_is_benign) {
        code_str, expected_str, 1);
 }
 
+TEST_F(CommonSubexpressionEliminationTest, refreshed_method_barriers) {
+  DexField::make_field("LFoo;.a:I")->make_concrete(ACC_PUBLIC);
+
+  ClassCreator a_creator(DexType::make_type("LA;"));
+  a_creator.set_super(type::java_lang_Object());
+
+  auto method = static_cast<DexMethod*>(DexMethod::make_method("LA;.m:()V"));
+  method->make_concrete(ACC_PUBLIC | ACC_STATIC, false);
+  method->set_code(assembler::ircode_from_string(R"(
+     (
+       (const v0 0)
+       (const v1 1)
+       (iput v1 v0 "LFoo;.a:I")
+       (return-void)
+     )
+   )"));
+  a_creator.add_method(method);
+  Scope scope{type_class(type::java_lang_Object()), a_creator.create()};
+  walk::code(scope, [&](DexMethod*, IRCode& code) {
+    code.build_cfg(/* editable */ true);
+  });
+
+  cse_impl::SharedState shared_state(get_pure_methods());
+  shared_state.init_scope(scope);
+  auto run_cse = [&]() {
+    auto code = assembler::ircode_from_string(R"(
+      (
+        (const v0 0)
+        (iget v0 "LFoo;.a:I")
+        (move-result-pseudo v1)
+        (invoke-static () "LA;.m:()V")
+        (iget v0 "LFoo;.a:I")
+        (move-result-pseudo v2)
+      )
+    )");
+    code->build_cfg(/* editable */ true);
+    cse_impl::CommonSubexpressionElimination cse(
+        &shared_state, code->cfg(), /* is_static */ true,
+        /* is_init_or_clinit */ false, /* declaring_type */ nullptr,
+        DexTypeList::make_type_list({}));
+    cse.patch();
+    return cse.get_stats().instructions_eliminated;
+  };
+  EXPECT_EQ(run_cse(), 0);
+
+  // The write goes away, but the old summary stays in effect until refreshed.
+  method->set_code(assembler::ircode_from_string("((return-void))"));
+  method->get_code()->build_cfg(/* editable */ true);
+  shared_state.invalidate_method(method);
+  EXPECT_EQ(run_cse(), 0);
+
+  EXPECT_EQ(shared_state.refresh_invalidated_methods(), 1);
+  EXPECT_EQ(shared_state.get_stats().refreshed_method_barriers, 1);
+  EXPECT_EQ(run_cse(), 1);
+  EXPECT_EQ(shared_state.refresh_invalidated_methods(), 0);
+
+  walk::code(scope, [&](DexMethod*, IRCode& code) { code.clear_cfg(); });
+}
+
 TEST_F(CommonSubexpressionEliminationTest,
        invoked_static_method_with_somewhat_relevant_s_barrier) {
   ClassCreator creator(DexType::make_type("LTest7;"));
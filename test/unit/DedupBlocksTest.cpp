@@ -1143,3 +1143,57 @@ TEST_F(DedupBlocksTest, conditional_hashed_not_alike) {
 
   EXPECT_CODE_EQ(expected_code.get(), code);
 }
+
+TEST_F(DedupBlocksTest, batchKeepsCfgStateAndReusesScratch) {
+  auto input_str = R"(
+    (
+      (const v0 0)
+      (if-eqz v0 :D)
+      (mul-int v0 v0 v0)
+      (goto :C)
+
+      (:E)
+      (return-void)
+
+      (:C)
+      (add-int v0 v0 v0)
+      (goto :E)
+
+      (:D)
+      (add-int v0 v0 v0)
+      (goto :E)
+    )
+  )";
+  auto expected_str = R"(
+    (
+      (const v0 0)
+      (if-eqz v0 :C)
+      (mul-int v0 v0 v0)
+
+      (:C)
+      (add-int v0 v0 v0)
+      (return-void)
+    )
+  )";
+
+  std::vector<DexMethod*> methods;
+  for (const auto& name : {"batchA", "batchB", "batchC"}) {
+    auto method = get_fresh_method(name);
+    method->set_code(assembler::ircode_from_string(input_str));
+    methods.push_back(method);
+  }
+  methods[1]->get_code()->build_cfg(/* editable */ true);
+
+  dedup_blocks_impl::Config config;
+  auto stats = dedup_blocks_impl::dedup_methods(&config, methods,
+                                                /* num_threads */ 1);
+  EXPECT_EQ(stats.blocks_removed, 3);
+
+  EXPECT_FALSE(methods[0]->get_code()->editable_cfg_built());
+  EXPECT_TRUE(methods[1]->get_code()->editable_cfg_built());
+  methods[1]->get_code()->clear_cfg();
+  auto expected_code = assembler::ircode_from_string(expected_str);
+  for (auto method : methods) {
+    EXPECT_CODE_EQ(expected_code.get(), method->get_code());
+  }
+}
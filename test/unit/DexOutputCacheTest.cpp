@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "DexOutputCache.h"
+
+#include <fstream>
+#include <gtest/gtest.h>
+
+#include "DexOutput.h"
+#include "IRAssembler.h"
+#include "RedexTest.h"
+#include "RedexTestUtils.h"
+
+namespace {
+
+std::string make_cache_path(const redex::TempDir& tmp_dir) {
+  return tmp_dir.path + "/dex-output.cache";
+}
+
+DexOutputCache::Key make_key(uint8_t first, uint8_t last) {
+  DexOutputCache::Key key{};
+  key.digest.front() = first;
+  key.digest.back() = last;
+  return key;
+}
+
+} // namespace
+
+TEST(DexOutputCache, roundTrip) {
+  auto tmp_dir = redex::make_tmp_dir("redex_dex_output_cache_test_%%%%%%%%");
+  const uint8_t bytes[] = {0x01, 0x00, 0x02, 0x00, 0xff};
+  auto key = make_key(42, 7);
+  {
+    DexOutputCache cache(make_cache_path(tmp_dir));
+    cache.load();
+    EXPECT_EQ(cache.size(), 0);
+    EXPECT_EQ(cache.get(key), nullptr);
+    cache.put(key, bytes, sizeof(bytes));
+    cache.save();
+  }
+
+  DexOutputCache cache(make_cache_path(tmp_dir));
+  cache.load();
+  EXPECT_EQ(cache.size(), 1);
+  // Keys that agree on the bytes that the hash table looks at must not hit.
+  EXPECT_EQ(cache.get(make_key(42, 8)), nullptr);
+  auto cached = cache.get(key);
+  ASSERT_NE(cached, nullptr);
+  EXPECT_EQ(*cached, std::string((const char*)bytes, sizeof(bytes)));
+  EXPECT_EQ(cache.hits(), 1);
+  EXPECT_EQ(cache.misses(), 1);
+}
+
+TEST(DexOutputCache, unusedEntriesAreEvicted) {
+  auto tmp_dir = redex::make_tmp_dir("redex_dex_output_cache_test_%%%%%%%%");
+  const uint8_t bytes[] = {0x0e, 0x00};
+  {
+    DexOutputCache cache(make_cache_path(tmp_dir));
+    cache.put(make_key(1, 1), bytes, sizeof(bytes));
+    cache.put(make_key(2, 2), bytes, sizeof(bytes));
+    cache.save();
+  }
+  {
+    DexOutputCache cache(make_cache_path(tmp_dir));
+    cache.load();
+    EXPECT_EQ(cache.size(), 2);
+    EXPECT_NE(cache.get(make_key(1, 1)), nullptr);
+    cache.save();
+  }
+
+  DexOutputCache cache(make_cache_path(tmp_dir));
+  cache.load();
+  EXPECT_EQ(cache.size(), 1);
+  EXPECT_EQ(cache.get(make_key(2, 2)), nullptr);
+}
+
+TEST(DexOutputCache, ignoresCorruptFile) {
+  auto tmp_dir = redex::make_tmp_dir("redex_dex_output_cache_test_%%%%%%%%");
+  {
+    std::ofstream os(make_cache_path(tmp_dir));
+    os << "not a cache";
+  }
+  DexOutputCache cache(make_cache_path(tmp_dir));
+  cache.load();
+  EXPECT_EQ(cache.size(), 0);
+}
+
+class DexOutputCacheTest : public RedexTest {};
+
+TEST_F(DexOutputCacheTest, keysDependOnOutputIndices) {
+  auto foo = assembler::method_from_string(R"(
+    (method (public static) "LFoo;.foo:()Ljava/lang/String;"
+      (
+        (const-string "foo")
+        (move-result-pseudo-object v0)
+        (return-object v0)
+      )
+    )
+  )");
+  auto bar = assembler::method_from_string(R"(
+    (method (public static) "LFoo;.bar:()Ljava/lang/String;"
+      (
+        (const-string "bar")
+        (move-result-pseudo-object v0)
+        (return-object v0)
+      )
+    )
+  )");
+  auto make_dodx = [&](uint32_t foo_idx, uint32_t bar_idx) {
+    auto strings = new dexstring_to_idx{
+        {DexString::make_string("foo"), foo_idx},
+        {DexString::make_string("bar"), bar_idx}};
+    auto protos = new dexproto_to_idx{{foo->get_proto(), 0}};
+    return std::make_unique<DexOutputIdx>(
+        strings, new dextype_to_idx(), protos, new dexfield_to_idx(),
+        new dexmethod_to_idx(), new std::vector<DexTypeList*>(),
+        new dexcallsite_to_idx(), new dexmethodhandle_to_idx(), nullptr);
+  };
+
+  auto dodx = make_dodx(0, 1);
+  auto foo_key = DexOutputCache::make_key(foo, dodx.get());
+  EXPECT_FALSE(foo_key == DexOutputCache::make_key(bar, dodx.get()));
+
+  // The key only sees the indices, which is all the encoding sees as well.
+  auto swapped_dodx = make_dodx(1, 0);
+  EXPECT_TRUE(foo_key == DexOutputCache::make_key(bar, swapped_dodx.get()));
+  EXPECT_FALSE(foo_key == DexOutputCache::make_key(foo, swapped_dodx.get()));
+}
@@ -9,6 +9,32 @@
 #include <gtest/gtest.h>
 #include <json/json.h>
 
+#include "Creators.h"
+#include "RedexTest.h"
+
+namespace {
+
+/*
+ * Check that the index assigned to each item is its position in the order
+ * defined by the given comparator.
+ */
+template <class T, class IdxMap, class Compare>
+void expect_sorted_by_index(const IdxMap& idx_map, const Compare& cmp) {
+  std::vector<T*> by_index(idx_map.size(), nullptr);
+  for (const auto& p : idx_map) {
+    ASSERT_LT(p.second, by_index.size());
+    ASSERT_EQ(by_index[p.second], nullptr);
+    by_index[p.second] = p.first;
+  }
+  for (size_t i = 1; i < by_index.size(); ++i) {
+    EXPECT_TRUE(cmp(by_index[i - 1], by_index[i])) << i;
+  }
+}
+
+} // namespace
+
+class DexOutputIdxTest : public RedexTest {};
+
 TEST(DexOutput, checkMethodInstructionSizeLimit) {
 
   Json::Value json_cfg;
@@ -24,3 +50,50 @@ TEST(DexOutput, checkMethodInstructionSizeLimit) {
       DexOutput::check_method_instruction_size_limit(conf, 65537, "method"),
       RedexException);
 }
+
+TEST_F(DexOutputIdxTest, tablesFollowDexOrder) {
+  // Enough references for the sorts to be split across threads, with names
+  // that share prefixes, differ only in multi-byte characters, and use a
+  // few protos that only differ in their arguments.
+  std::vector<DexType*> arg_types{type::_int(), type::_long(),
+                                  type::java_lang_Object(),
+                                  DexType::make_type("L\xc3\xa9;")};
+  DexClasses classes;
+  for (int i = 199; i >= 0; --i) {
+    auto type = DexType::make_type(
+        ("Lcom/x/C" + std::to_string(i * 7 % 200) + ";").c_str());
+    ClassCreator cc(type);
+    cc.set_super(type::java_lang_Object());
+    for (int j = 0; j < 50; ++j) {
+      auto suffix = std::to_string(i) + (j % 2 ? "\xc3\xa9" : "_") +
+                    std::to_string(j);
+      cc.add_field(DexField::make_field(type,
+                                        DexString::make_string("f" + suffix),
+                                        arg_types[j % arg_types.size()])
+                       ->make_concrete(ACC_PUBLIC));
+      std::deque<DexType*> args;
+      for (int k = 0; k < j % 5; ++k) {
+        args.push_back(arg_types[(j + k) % arg_types.size()]);
+      }
+      auto proto = DexProto::make_proto(arg_types[j % arg_types.size()],
+                                        DexTypeList::make_type_list(
+                                            std::move(args)));
+      cc.add_method(
+          DexMethod::make_method(type, DexString::make_string("m" + suffix),
+                                 proto)
+              ->make_concrete(ACC_PUBLIC | ACC_STATIC, false));
+    }
+    classes.push_back(cc.create());
+  }
+
+  GatheredTypes gtypes(&classes);
+  std::unique_ptr<DexOutputIdx> dodx(gtypes.get_dodx(nullptr));
+  EXPECT_EQ(dodx->field_to_idx().size(), 200 * 50);
+  EXPECT_EQ(dodx->method_to_idx().size(), 200 * 50);
+  expect_sorted_by_index<DexString>(dodx->string_to_idx(), compare_dexstrings);
+  expect_sorted_by_index<DexType>(dodx->type_to_idx(), compare_dextypes);
+  expect_sorted_by_index<DexProto>(dodx->proto_to_idx(), compare_dexprotos);
+  expect_sorted_by_index<DexFieldRef>(dodx->field_to_idx(), compare_dexfields);
+  expect_sorted_by_index<DexMethodRef>(dodx->method_to_idx(),
+                                       compare_dexmethods);
+}
@@ -398,3 +398,87 @@ TEST_F(LocalPointersTest, returnEscapedValue) {
     EXPECT_TRUE(exit_env.may_have_escaped(invoke_insn));
   }
 }
+
+TEST_F(LocalPointersTest, computeSummaries) {
+  auto escape = assembler::method_from_string(R"(
+    (method (public static) "LFoo;.escape:(LFoo;)V"
+     (
+      (load-param-object v0)
+      (sput-object v0 "LFoo;.f:LFoo;")
+      (return-void)
+     )
+    )
+  )");
+  auto forward = assembler::method_from_string(R"(
+    (method (public static) "LFoo;.forward:(LFoo;)V"
+     (
+      (load-param-object v0)
+      (invoke-static (v0) "LFoo;.escape:(LFoo;)V")
+      (return-void)
+     )
+    )
+  )");
+  auto ping = assembler::method_from_string(R"(
+    (method (public static) "LFoo;.ping:(LFoo;)V"
+     (
+      (load-param-object v0)
+      (invoke-static (v0) "LFoo;.pong:(LFoo;)V")
+      (return-void)
+     )
+    )
+  )");
+  auto pong = assembler::method_from_string(R"(
+    (method (public static) "LFoo;.pong:(LFoo;)V"
+     (
+      (load-param-object v0)
+      (invoke-static (v0) "LFoo;.ping:(LFoo;)V")
+      (return-void)
+     )
+    )
+  )");
+  std::vector<DexMethod*> methods{escape, forward, ping, pong};
+  Scope scope{assembler::class_with_methods("LFoo;", methods)};
+  for (auto method : methods) {
+    method->rstate.set_root();
+    method->get_code()->build_cfg(/* editable */ false);
+    method->get_code()->cfg().calculate_exit_block();
+  }
+  auto graph = call_graph::single_callee_graph(scope);
+
+  ptrs::SummaryCMap expected;
+  ptrs::analyze_scope(scope, graph, &expected);
+  EXPECT_THAT(expected.at(escape).escaping_parameters,
+              UnorderedElementsAre(0));
+  EXPECT_THAT(expected.at(forward).escaping_parameters,
+              UnorderedElementsAre(0));
+
+  ptrs::SummaryCMap summaries;
+  auto stats = ptrs::compute_summaries(scope, graph, &summaries);
+  EXPECT_EQ(stats.sccs, 3);
+  EXPECT_EQ(stats.analyzed_methods, 4);
+  for (auto method : methods) {
+    EXPECT_EQ(to_s_expr(summaries.at(method)),
+              to_s_expr(expected.at(method)));
+  }
+
+  // Methods that already have a summary keep it.
+  stats = ptrs::compute_summaries(scope, graph, &summaries);
+  EXPECT_EQ(stats.analyzed_methods, 0);
+
+  // Once `escape` stops escaping its parameter, neither does its caller.
+  escape->set_code(assembler::ircode_from_string(R"(
+    (
+     (load-param-object v0)
+     (return-void)
+    )
+  )"));
+  escape->get_code()->build_cfg(/* editable */ false);
+  escape->get_code()->cfg().calculate_exit_block();
+  graph = call_graph::single_callee_graph(scope);
+  summaries.clear();
+  stats = ptrs::compute_summaries(scope, graph, &summaries);
+  EXPECT_EQ(stats.analyzed_methods, 4);
+  EXPECT_THAT(summaries.at(escape).escaping_parameters, UnorderedElementsAre());
+  EXPECT_THAT(summaries.at(forward).escaping_parameters,
+              UnorderedElementsAre());
+}
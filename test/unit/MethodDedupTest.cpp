@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "MethodDedup.h"
+
+#include "IRAssembler.h"
+#include "RedexTest.h"
+
+class MethodDedupTest : public RedexTest {
+ public:
+  DexMethod* make_method(const std::string& name, const std::string& code) {
+    auto method = DexMethod::make_method("LFoo;." + name + ":(I)I")
+                      ->make_concrete(ACC_PUBLIC | ACC_STATIC, false);
+    method->set_code(assembler::ircode_from_string(code));
+    return method;
+  }
+};
+
+TEST_F(MethodDedupTest, groupsIdenticalMethods) {
+  auto code = R"(
+    (
+      (load-param v0)
+      (add-int/lit8 v1 v0 1)
+      (return v1)
+    )
+  )";
+  auto renamed_code = R"(
+    (
+      (load-param v3)
+      (add-int/lit8 v2 v3 1)
+      (return v2)
+    )
+  )";
+  auto a = make_method("a", code);
+  auto b = make_method("b", code);
+  auto c = make_method("c", renamed_code);
+  auto d = make_method("d", R"(
+    (
+      (load-param v0)
+      (add-int/lit8 v1 v0 2)
+      (return v1)
+    )
+  )");
+
+  method_dedup::Stats stats;
+  auto groups = method_dedup::group_identical_methods({d, c, b, a}, &stats);
+  ASSERT_EQ(groups.size(), 3);
+  EXPECT_EQ(groups[0], MethodOrderedSet({a, b}));
+  EXPECT_EQ(groups[1], MethodOrderedSet({c}));
+  EXPECT_EQ(groups[2], MethodOrderedSet({d}));
+
+  // Register names don't matter for the fingerprint, so the renamed copy is
+  // only told apart by the exact comparison.
+  EXPECT_EQ(stats.fingerprinted_methods, 4);
+  EXPECT_EQ(stats.fingerprint_buckets, 2);
+  EXPECT_EQ(stats.exact_compares, 2);
+}
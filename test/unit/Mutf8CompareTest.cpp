@@ -7,6 +7,8 @@
 
 #include <gtest/gtest.h>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "DexClass.h"
 #include "RedexTest.h"
@@ -19,3 +21,95 @@ TEST_F(Mutf8CompareTest, empty) {
   EXPECT_TRUE(compare_dexstrings(s1, s2));
   EXPECT_FALSE(compare_dexstrings(s2, s1));
 }
+
+namespace {
+
+// Reference implementation: decode one code point at a time.
+int compare_by_code_point(const std::string& a, const std::string& b) {
+  const char* sa = a.c_str();
+  const char* sb = b.c_str();
+  while (*sa != '\0' && *sb != '\0') {
+    uint32_t cpa = mutf8_next_code_point(sa);
+    uint32_t cpb = mutf8_next_code_point(sb);
+    if (cpa != cpb) {
+      return cpa < cpb ? -1 : 1;
+    }
+  }
+  return *sa == '\0' ? (*sb == '\0' ? 0 : -1) : 1;
+}
+
+int sign(int v) { return v < 0 ? -1 : (v > 0 ? 1 : 0); }
+
+// Long enough to exercise both the 16- and 32-byte vector loops.
+const std::string kPrefix = "Lcom/facebook/some/long/package/name/Foo;";
+
+} // namespace
+
+TEST_F(Mutf8CompareTest, kernelsOnAscii) {
+  for (size_t n = 0; n <= kPrefix.size(); ++n) {
+    auto s = kPrefix.substr(0, n);
+    uint32_t len = 0;
+    EXPECT_TRUE(mutf8::validate(s.c_str(), s.size(), &len));
+    EXPECT_EQ(len, n);
+    EXPECT_EQ(mutf8::utf16_length(s.c_str(), s.size()), n);
+    EXPECT_EQ(mutf8::mismatch(s.c_str(), kPrefix.c_str(), n), n);
+  }
+  auto other = kPrefix;
+  other[37] = 'G';
+  EXPECT_EQ(mutf8::mismatch(kPrefix.c_str(), other.c_str(), kPrefix.size()),
+            37);
+  EXPECT_EQ(mutf8::compare(kPrefix.c_str(), kPrefix.size(), other.c_str(),
+                           other.size()),
+            -1);
+}
+
+TEST_F(Mutf8CompareTest, kernelsOnMultiByte) {
+  // U+00E9 (2 bytes), U+20AC (3 bytes) and U+0000 (2 bytes in MUTF-8).
+  std::vector<std::string> chars = {"a", "\303\251", "\342\202\254",
+                                    "\300\200", "z"};
+  for (size_t pos = 0; pos <= kPrefix.size(); pos += 5) {
+    std::vector<std::string> strings;
+    for (const auto& c : chars) {
+      for (const auto& d : chars) {
+        strings.push_back(kPrefix.substr(0, pos) + c + kPrefix.substr(pos) +
+                          d);
+      }
+    }
+    for (const auto& s : strings) {
+      uint32_t len = 0;
+      ASSERT_TRUE(mutf8::validate(s.c_str(), s.size(), &len)) << s;
+      EXPECT_EQ(len, kPrefix.size() + 2);
+      EXPECT_EQ(mutf8::utf16_length(s.c_str(), s.size()), len);
+      for (const auto& t : strings) {
+        EXPECT_EQ(
+            mutf8::compare(s.c_str(), s.size(), t.c_str(), t.size()),
+            compare_by_code_point(s, t))
+            << s << " vs " << t;
+      }
+    }
+  }
+}
+
+TEST_F(Mutf8CompareTest, validateRejectsMalformed) {
+  for (const std::string bad :
+       {"\200", "\303", "\342\202", "\342(\254", "\370\210\200\200\200"}) {
+    for (size_t pos = 0; pos <= kPrefix.size(); pos += 7) {
+      auto s = kPrefix.substr(0, pos) + bad + kPrefix.substr(pos);
+      EXPECT_FALSE(mutf8::validate(s.c_str(), s.size())) << pos;
+    }
+  }
+  std::string with_nul = kPrefix;
+  with_nul[20] = '\0';
+  EXPECT_FALSE(mutf8::validate(with_nul.data(), with_nul.size()));
+}
+
+TEST_F(Mutf8CompareTest, nulSortsFirst) {
+  // The two-byte NUL sorts before every other code point even though its lead
+  // byte does not.
+  DexString* nul = DexString::make_string(kPrefix + "\300\200");
+  DexString* one = DexString::make_string(kPrefix + "\001");
+  EXPECT_FALSE(nul->is_simple());
+  EXPECT_TRUE(compare_dexstrings(nul, one));
+  EXPECT_FALSE(compare_dexstrings(one, nul));
+  EXPECT_EQ(nul->length(), kPrefix.size() + 1);
+}
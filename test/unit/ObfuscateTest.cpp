@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include "Creators.h"
+#include "DexClass.h"
+#include "Obfuscate.h"
+#include "RedexTest.h"
+
+class ObfuscateTest : public RedexTest {};
+
+namespace {
+
+constexpr size_t NUM_CLASSES = 32;
+constexpr size_t NUM_IFIELDS = 5;
+constexpr size_t NUM_SFIELDS = 3;
+
+DexClass* create_class(const std::string& name, DexType* super) {
+  auto type = DexType::make_type(name.c_str());
+  ClassCreator creator(type);
+  creator.set_super(super);
+  auto add_fields = [&](size_t count, const char* prefix, DexAccessFlags acc) {
+    for (size_t i = 0; i < count; ++i) {
+      auto name = DexString::make_string(prefix + std::to_string(i));
+      auto field = DexField::make_field(type, name, type::_int())
+                       ->make_concrete(acc);
+      creator.add_field(field);
+    }
+  };
+  add_fields(NUM_IFIELDS, "instanceField", ACC_PUBLIC);
+  add_fields(NUM_SFIELDS, "staticField", ACC_PUBLIC | ACC_STATIC);
+  return creator.create();
+}
+
+// Creates a fresh set of classes under `package`, half of them extending the
+// other half, obfuscates them and returns the new field names class by class.
+std::vector<std::vector<std::string>> obfuscate_field_names(
+    const std::string& package) {
+  Scope scope;
+  for (size_t i = 0; i < NUM_CLASSES; ++i) {
+    auto super =
+        i % 2 == 0 ? type::java_lang_Object() : scope.back()->get_type();
+    scope.push_back(
+        create_class("L" + package + "/Cls" + std::to_string(i) + ";", super));
+  }
+
+  RenameStats stats;
+  obfuscate(scope, stats, /* avoid_colliding_debug_name */ false);
+  EXPECT_EQ(stats.fields_total, NUM_CLASSES * (NUM_IFIELDS + NUM_SFIELDS));
+
+  std::vector<std::vector<std::string>> names;
+  for (auto* cls : scope) {
+    names.emplace_back();
+    for (auto* field : cls->get_ifields()) {
+      names.back().push_back(field->get_name()->str());
+    }
+    for (auto* field : cls->get_sfields()) {
+      names.back().push_back(field->get_name()->str());
+    }
+  }
+  return names;
+}
+
+} // namespace
+
+TEST_F(ObfuscateTest, fieldNamesAreDeterministic) {
+  // The classes pick their field names in parallel, so the names must not
+  // depend on the order in which the classes get processed.
+  auto expected = obfuscate_field_names("first");
+  for (const auto& field_names : expected) {
+    for (const auto& name : field_names) {
+      EXPECT_EQ(name.find("Field"), std::string::npos) << name;
+    }
+  }
+  for (size_t run = 0; run < 10; ++run) {
+    EXPECT_EQ(obfuscate_field_names("run" + std::to_string(run)), expected);
+  }
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+
+#include "SuffixArray.h"
+
+using namespace outliner_impl;
+
+namespace {
+
+uint32_t naive_repeat_length(const std::vector<uint32_t>& s, uint32_t i) {
+  uint32_t best = 0;
+  for (uint32_t j = 0; j < s.size(); j++) {
+    if (j == i) {
+      continue;
+    }
+    uint32_t h = 0;
+    while (i + h < s.size() && j + h < s.size() && s[i + h] == s[j + h]) {
+      h++;
+    }
+    best = std::max(best, h);
+  }
+  return best;
+}
+
+} // namespace
+
+TEST(OutlinerSuffixArrayTest, empty) {
+  std::vector<uint32_t> s;
+  EXPECT_TRUE(build_suffix_array(s).empty());
+  EXPECT_TRUE(get_repeat_lengths(s).empty());
+}
+
+TEST(OutlinerSuffixArrayTest, banana) {
+  // b a n a n a
+  std::vector<uint32_t> s = {1, 0, 2, 0, 2, 0};
+  auto sa = build_suffix_array(s);
+  EXPECT_EQ(sa, std::vector<uint32_t>({5, 3, 1, 0, 4, 2}));
+  auto lcp = build_lcp_array(s, sa);
+  EXPECT_EQ(lcp, std::vector<uint32_t>({0, 1, 3, 0, 0, 2}));
+  EXPECT_EQ(get_repeat_lengths(s),
+            std::vector<uint32_t>({0, 3, 2, 3, 2, 1}));
+}
+
+TEST(OutlinerSuffixArrayTest, separators) {
+  // Two occurrences of 7 8 9, with unique separators in between.
+  std::vector<uint32_t> s = {7, 8, 9, 100, 7, 8, 9, 101, 8, 9, 102};
+  EXPECT_EQ(get_repeat_lengths(s),
+            std::vector<uint32_t>({3, 2, 1, 0, 3, 2, 1, 0, 2, 1, 0}));
+}
+
+TEST(OutlinerSuffixArrayTest, matchesNaive) {
+  std::mt19937 gen(42);
+  for (uint32_t alphabet : {1, 2, 3, 8}) {
+    std::uniform_int_distribution<uint32_t> dist(0, alphabet - 1);
+    for (size_t n : {1, 2, 7, 64, 300}) {
+      std::vector<uint32_t> s(n);
+      std::generate(s.begin(), s.end(), [&] { return dist(gen) * 1000; });
+      auto sa = build_suffix_array(s);
+      for (size_t i = 1; i < n; i++) {
+        EXPECT_TRUE(std::lexicographical_compare(s.begin() + sa[i - 1], s.end(),
+                                                 s.begin() + sa[i], s.end()));
+      }
+      auto repeat_lengths = get_repeat_lengths(s);
+      for (uint32_t i = 0; i < n; i++) {
+        EXPECT_EQ(repeat_lengths[i], naive_repeat_length(s, i));
+      }
+    }
+  }
+}
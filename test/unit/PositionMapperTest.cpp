@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "DexPosition.h"
+
+#include <fstream>
+#include <gtest/gtest.h>
+#include <sstream>
+#include <zlib.h>
+
+#include "DexClass.h"
+#include "RedexTest.h"
+#include "RedexTestUtils.h"
+
+class PositionMapperTest : public RedexTest {};
+
+namespace {
+
+std::string read_file(const std::string& path) {
+  std::ifstream is(path, std::ios::binary);
+  std::ostringstream ss;
+  ss << is.rdbuf();
+  return ss.str();
+}
+
+std::string write_map(const std::string& path,
+                      bool compress,
+                      const std::vector<DexPosition*>& positions) {
+  RealPositionMapper mapper(path, compress);
+  for (auto* pos : positions) {
+    mapper.register_position(pos);
+  }
+  for (auto* pos : positions) {
+    mapper.position_to_line(pos);
+  }
+  mapper.write_map();
+  return read_file(path);
+}
+
+} // namespace
+
+TEST_F(PositionMapperTest, compressedMapHasSamePayload) {
+  auto tmp_dir = redex::make_tmp_dir("redex_position_mapper_test_%%%%%%%%");
+  auto file = DexString::make_string("Foo.java");
+  std::vector<std::unique_ptr<DexPosition>> owned;
+  std::vector<DexPosition*> positions;
+  for (int i = 0; i < 5000; ++i) {
+    auto method = DexString::make_string("Lcom/foo/Bar" + std::to_string(i % 7) +
+                                         ";.m" + std::to_string(i % 13) +
+                                         ":()V");
+    owned.push_back(std::make_unique<DexPosition>(method, file, i));
+    if (i % 3 == 0 && i > 0) {
+      owned.back()->parent = owned[i - 1].get();
+    }
+    positions.push_back(owned.back().get());
+  }
+
+  auto plain = write_map(tmp_dir.path + "/plain", false, positions);
+  auto compressed = write_map(tmp_dir.path + "/compressed", true, positions);
+
+  const size_t header_size = 2 * sizeof(uint32_t);
+  ASSERT_GT(plain.size(), header_size);
+  ASSERT_GT(compressed.size(), header_size + sizeof(uint64_t));
+  EXPECT_EQ(plain.compare(0, sizeof(uint32_t), compressed, 0, sizeof(uint32_t)),
+            0);
+  EXPECT_EQ(*(const uint32_t*)(plain.data() + sizeof(uint32_t)), 2);
+  EXPECT_EQ(*(const uint32_t*)(compressed.data() + sizeof(uint32_t)), 3);
+  EXPECT_LT(compressed.size(), plain.size());
+
+  uint64_t payload_size = *(const uint64_t*)(compressed.data() + header_size);
+  EXPECT_EQ(payload_size, plain.size() - header_size);
+  std::string payload(payload_size, '\0');
+  uLongf size = payload_size;
+  auto offset = header_size + sizeof(uint64_t);
+  ASSERT_EQ(uncompress((Bytef*)&payload[0], &size,
+                       (const Bytef*)compressed.data() + offset,
+                       compressed.size() - offset),
+            Z_OK);
+  EXPECT_EQ(payload, plain.substr(header_size));
+}
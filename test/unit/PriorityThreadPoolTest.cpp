@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "PriorityThreadPool.h"
+
+#include <atomic>
+#include <gtest/gtest.h>
+#include <memory>
+#include <vector>
+
+TEST(PriorityThreadPoolTest, postAndJoin) {
+  std::atomic<size_t> count{0};
+  PriorityThreadPool pool(4);
+  for (int i = 0; i < 1000; i++) {
+    pool.post(i % 7, [&]() { count++; });
+  }
+  pool.join();
+  EXPECT_EQ(count, 1000);
+}
+
+TEST(PriorityThreadPoolTest, singleThreadRespectsPriorities) {
+  std::vector<int> order;
+  PriorityThreadPool pool(1);
+  std::atomic<bool> started{false};
+  std::atomic<bool> release{false};
+  // Block the only thread until all other work items have been posted.
+  pool.post(100, [&]() {
+    started = true;
+    while (!release) {
+      std::this_thread::yield();
+    }
+  });
+  while (!started) {
+    std::this_thread::yield();
+  }
+  for (int priority : {1, 5, -3, 2}) {
+    pool.post(priority, [&order, priority]() { order.push_back(priority); });
+  }
+  release = true;
+  pool.join();
+  EXPECT_EQ(order, std::vector<int>({5, 2, 1, -3}));
+}
+
+TEST(PriorityThreadPoolTest, nestedPostsAreProcessed) {
+  std::atomic<size_t> count{0};
+  PriorityThreadPool pool(3);
+  for (int i = 0; i < 10; i++) {
+    pool.post(0, [&]() {
+      for (int j = 0; j < 10; j++) {
+        pool.post(j, [&]() { count++; });
+      }
+    });
+  }
+  pool.join();
+  EXPECT_EQ(count, 100);
+}
+
+TEST(PriorityThreadPoolTest, dependentWorkItemsRunAfterDependencies) {
+  // A chain of diamonds: each item depends on the two items of the previous
+  // level, and must only run after both of them.
+  constexpr size_t levels = 200;
+  std::vector<std::atomic<size_t>> finished(levels);
+  std::atomic<bool> ok{true};
+  PriorityThreadPool pool(4);
+  std::vector<std::unique_ptr<PriorityThreadPool::DependentWorkItem>> items;
+  for (size_t level = 0; level < levels; level++) {
+    items.push_back(std::make_unique<PriorityThreadPool::DependentWorkItem>(
+        2, 0, [&, level]() {
+          if (level > 0 && finished[level - 1] != 2) {
+            ok = false;
+          }
+          finished[level] += 2;
+          if (level + 1 < levels) {
+            pool.signal(items[level + 1].get());
+            pool.signal(items[level + 1].get());
+          }
+        }));
+  }
+  EXPECT_FALSE(pool.signal(items[0].get()));
+  EXPECT_TRUE(pool.signal(items[0].get()));
+  pool.join();
+  EXPECT_TRUE(ok);
+  EXPECT_EQ(finished[levels - 1], 2);
+}
+
+TEST(PriorityThreadPoolTest, parallelForWithinWorkItems) {
+  constexpr size_t n = 1000;
+  std::vector<std::atomic<size_t>> counts(n);
+  PriorityThreadPool pool(4);
+  for (int i = 0; i < 8; i++) {
+    pool.post(0, [&]() {
+      pool.parallel_for(n, [&](size_t j) { counts[j]++; });
+    });
+  }
+  pool.parallel_for(n, [&](size_t j) { counts[j]++; });
+  pool.join();
+  for (size_t j = 0; j < n; j++) {
+    EXPECT_EQ(counts[j], 9);
+  }
+}
+
+TEST(PriorityThreadPoolTest, parallelForWithoutThreads) {
+  size_t sum = 0;
+  PriorityThreadPool pool(0);
+  pool.parallel_for(10, [&](size_t i) { sum += i; });
+  EXPECT_EQ(sum, 45);
+}
@@ -8,6 +8,8 @@
 #include <gtest/gtest.h>
 
 #include <boost/regex.hpp>
+#include <string>
+#include <vector>
 
 #include "ProguardRegex.h"
 
@@ -270,3 +272,44 @@ TEST(ProguardRegexTest, types) {
     EXPECT_EQ("Lalpha/**/beta;", descriptor);
   }
 }
+
+TEST(ProguardRegexTest, wildcardMatcherAgreesWithRegex) {
+  std::vector<std::string> patterns = {
+      "Lcom/foo/Bar;", "Lcom/foo/*;", "Lcom/**;", "L*;",
+      "Lcom/*/Bar;", "Lcom/**/Bar;", "Lcom/foo/B?r;", "L**$*;",
+      "[Lcom/**;", "Lcom/foo/*$Inner*;", "**", "*",
+  };
+  std::vector<std::string> names = {
+      "Lcom/foo/Bar;", "Lcom/foo/Baz;", "Lcom/foo/bar/Baz;",
+      "Lcom/Bar;", "Lcom/x/y/Bar;", "Lcom/x/Bar;",
+      "[Lcom/foo/Bar;", "Lcom/foo/Bar$Inner;", "Lcom/foo/Bar$Inner1;",
+      "Lorg/Quux;", "I", "",
+      "Lcom/foo/B/r;", "Lcom/foo/B[r;", "Lcom/foo/Bar;x",
+  };
+  for (const auto& pattern : patterns) {
+    auto matcher = proguard_parser::TypeWildcardMatcher::compile(pattern);
+    ASSERT_TRUE(matcher) << pattern;
+    boost::regex rx(proguard_parser::form_type_regex(pattern));
+    auto prefix = proguard_parser::get_literal_type_prefix(pattern);
+    for (const auto& name : names) {
+      bool expected = boost::regex_match(name, rx);
+      EXPECT_EQ(expected, matcher->match(name)) << pattern << " " << name;
+      if (expected) {
+        EXPECT_EQ(0, name.compare(0, prefix.size(), prefix))
+            << pattern << " " << name;
+      }
+    }
+  }
+}
+
+TEST(ProguardRegexTest, wildcardMatcherFallsBack) {
+  for (const auto* pattern : {"%", "***", "Lcom/foo/Bar;...", "Lcom/(a|b);"}) {
+    EXPECT_FALSE(proguard_parser::TypeWildcardMatcher::compile(pattern))
+        << pattern;
+  }
+  using proguard_parser::get_literal_type_prefix;
+  EXPECT_EQ("Lcom/foo/", get_literal_type_prefix("Lcom/foo/*;"));
+  EXPECT_EQ("L", get_literal_type_prefix("L*;"));
+  EXPECT_EQ("", get_literal_type_prefix("Lcom/(a|b);"));
+  EXPECT_EQ("Lcom/fo", get_literal_type_prefix("Lcom/foo+;"));
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "Purity.h"
+
+#include "IRAssembler.h"
+#include "RedexTest.h"
+
+class PurityTest : public RedexTest {
+ public:
+  DexMethod* m_caller;
+  DexMethod* m_callee;
+  Scope m_scope;
+
+  PurityTest() {
+    ClassCreator cc(DexType::make_type("LFoo;"));
+    cc.set_super(type::java_lang_Object());
+
+    auto field = static_cast<DexField*>(DexField::make_field("LFoo;.f:I"));
+    field->make_concrete(ACC_PUBLIC | ACC_STATIC);
+    cc.add_field(field);
+
+    m_callee = DexMethod::make_method("LFoo;.callee:()I")
+                   ->make_concrete(ACC_PUBLIC | ACC_STATIC, false);
+    m_callee->set_code(assembler::ircode_from_string(R"(
+      (
+        (sget "LFoo;.f:I")
+        (move-result-pseudo v0)
+        (return v0)
+      )
+    )"));
+    cc.add_method(m_callee);
+
+    m_caller = DexMethod::make_method("LFoo;.caller:()I")
+                   ->make_concrete(ACC_PUBLIC | ACC_STATIC, false);
+    m_caller->set_code(assembler::ircode_from_string(R"(
+      (
+        (invoke-static () "LFoo;.callee:()I")
+        (move-result v0)
+        (return v0)
+      )
+    )"));
+    cc.add_method(m_caller);
+
+    m_scope.push_back(cc.create());
+  }
+
+  size_t compute(std::unordered_set<const DexMethod*>* result) {
+    auto override_graph = method_override_graph::build_graph(m_scope);
+    return compute_no_side_effects_methods(m_scope, override_graph.get(),
+                                           /* pure_methods */ {}, result);
+  }
+};
+
+TEST_F(PurityTest, noSideEffectsFollowCallees) {
+  std::unordered_set<const DexMethod*> expected{m_caller, m_callee};
+
+  std::unordered_set<const DexMethod*> result;
+  EXPECT_GT(compute(&result), 0);
+  EXPECT_EQ(result, expected);
+
+  // Writing a field gives the callee, and thus the caller, side effects.
+  m_callee->set_code(assembler::ircode_from_string(R"(
+    (
+      (const v0 0)
+      (sput v0 "LFoo;.f:I")
+      (return v0)
+    )
+  )"));
+  std::unordered_set<const DexMethod*> new_result;
+  compute(&new_result);
+  EXPECT_TRUE(new_result.empty());
+}
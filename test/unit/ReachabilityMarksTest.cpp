@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include "Creators.h"
+#include "Reachability.h"
+#include "RedexTest.h"
+
+using namespace reachability;
+
+class ReachabilityMarksTest : public RedexTest {};
+
+TEST_F(ReachabilityMarksTest, atomicBitset) {
+  AtomicBitset bits(130);
+  EXPECT_EQ(bits.count(), 0);
+  EXPECT_TRUE(bits.set(0));
+  EXPECT_TRUE(bits.set(129));
+  EXPECT_FALSE(bits.set(129));
+  EXPECT_TRUE(bits.test(0));
+  EXPECT_FALSE(bits.test(64));
+  EXPECT_TRUE(bits.test(129));
+  EXPECT_EQ(bits.count(), 2);
+}
+
+TEST_F(ReachabilityMarksTest, marksInAndOutOfScope) {
+  ClassCreator cc(DexType::make_type("LFoo;"));
+  cc.set_super(type::java_lang_Object());
+  auto field = static_cast<DexField*>(DexField::make_field("LFoo;.f:I"));
+  field->make_concrete(ACC_PUBLIC);
+  cc.add_field(field);
+  auto method = DexMethod::make_method("LFoo;.m:()V")
+                    ->make_concrete(ACC_PUBLIC | ACC_STATIC, false);
+  cc.add_method(method);
+  auto cls = cc.create();
+  Scope scope{cls};
+
+  ReachableObjects reachable_objects(scope);
+  EXPECT_EQ(reachable_objects.ids().num_classes(), 1);
+  EXPECT_EQ(reachable_objects.ids().num_fields(), 1);
+  EXPECT_EQ(reachable_objects.ids().num_methods(), 1);
+
+  // An unresolved ref has no id, and gets marked all the same.
+  auto ref = DexMethod::make_method("LBar;.m:()V");
+  EXPECT_EQ(reachable_objects.ids().get(ref), DenseIds::NONE);
+
+  EXPECT_TRUE(reachable_objects.mark(cls));
+  EXPECT_FALSE(reachable_objects.mark(cls));
+  EXPECT_TRUE(reachable_objects.mark(method));
+  EXPECT_TRUE(reachable_objects.mark(ref));
+  EXPECT_FALSE(reachable_objects.mark(ref));
+  EXPECT_TRUE(reachable_objects.marked(cls));
+  EXPECT_TRUE(reachable_objects.marked(ref));
+  EXPECT_FALSE(reachable_objects.marked(field));
+  EXPECT_EQ(reachable_objects.num_marked_classes(), 1);
+  EXPECT_EQ(reachable_objects.num_marked_methods(), 2);
+  EXPECT_EQ(reachable_objects.num_marked_fields(), 0);
+}
+
+TEST_F(ReachabilityMarksTest, conditionalMarksAreCountedPerClass) {
+  ClassCreator foo_creator(DexType::make_type("LFoo;"));
+  foo_creator.set_super(type::java_lang_Object());
+  auto field = static_cast<DexField*>(DexField::make_field("LFoo;.f:I"));
+  field->make_concrete(ACC_PUBLIC);
+  foo_creator.add_field(field);
+  auto foo = foo_creator.create();
+  ClassCreator bar_creator(DexType::make_type("LBar;"));
+  bar_creator.set_super(type::java_lang_Object());
+  auto bar = bar_creator.create();
+  Scope scope{foo, bar};
+
+  ReachableObjects reachable_objects(scope);
+  ConditionallyMarked cond_marked(reachable_objects.ids());
+  EXPECT_FALSE(cond_marked.has_marked_members(foo));
+  EXPECT_TRUE(cond_marked.mark(field));
+  EXPECT_FALSE(cond_marked.mark(field));
+  EXPECT_TRUE(cond_marked.marked(field));
+  EXPECT_TRUE(cond_marked.has_marked_members(foo));
+  EXPECT_FALSE(cond_marked.has_marked_members(bar));
+}
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "ReferenceIndex.h"
+
+#include "IRAssembler.h"
+#include "RedexTest.h"
+
+using namespace reference_index;
+
+class ReferenceIndexTest : public RedexTest {
+ public:
+  DexClass* m_foo;
+  DexMethod* m_a;
+  DexMethod* m_b;
+  DexMethod* m_caller;
+  DexField* m_field;
+  Scope m_scope;
+
+  ReferenceIndexTest() {
+    ClassCreator cc(DexType::make_type("LFoo;"));
+    cc.set_super(type::java_lang_Object());
+
+    m_a = DexMethod::make_method("LFoo;.a:(LBar;)V")
+              ->make_concrete(ACC_PUBLIC | ACC_STATIC, false);
+    m_a->set_code(assembler::ircode_from_string("((return-void))"));
+    cc.add_method(m_a);
+    m_b = DexMethod::make_method("LFoo;.b:(LBar;)V")
+              ->make_concrete(ACC_PUBLIC | ACC_STATIC, false);
+    m_b->set_code(assembler::ircode_from_string("((return-void))"));
+    cc.add_method(m_b);
+
+    m_field = static_cast<DexField*>(
+        DexField::make_field("LFoo;.f:[LBar;"));
+    m_field->make_concrete(ACC_PUBLIC | ACC_STATIC);
+    cc.add_field(m_field);
+
+    m_caller = DexMethod::make_method("LFoo;.caller:()V")
+                   ->make_concrete(ACC_PUBLIC | ACC_STATIC, false);
+    m_caller->set_code(assembler::ircode_from_string(R"(
+      (
+        (const v0 0)
+        (invoke-static (v0) "LFoo;.a:(LBar;)V")
+        (invoke-static (v0) "LFoo;.a:(LBar;)V")
+        (invoke-static (v0) "LFoo;.b:(LBar;)V")
+        (const-class "LBar;")
+        (move-result-pseudo-object v1)
+        (const v2 1)
+        (new-array v2 "[LBar;")
+        (move-result-pseudo-object v1)
+        (sget-object "LFoo;.f:[LBar;")
+        (move-result-pseudo-object v1)
+        (return-void)
+      )
+    )"));
+    cc.add_method(m_caller);
+
+    m_foo = cc.create();
+    m_scope.push_back(m_foo);
+  }
+};
+
+TEST_F(ReferenceIndexTest, indexesReferences) {
+  Index index(m_scope);
+  EXPECT_EQ(index.callers_of(m_a).size(), 2);
+  EXPECT_EQ(index.callers_of(m_b).size(), 1);
+  EXPECT_EQ(index.callers_of(m_caller).size(), 0);
+  EXPECT_EQ(index.field_uses(m_field).size(), 1);
+
+  auto bar = DexType::make_type("LBar;");
+  EXPECT_EQ(index.type_uses(bar).size(), 2);
+  EXPECT_EQ(index.fields_of_type(bar), std::vector<DexField*>({m_field}));
+  auto methods = index.methods_mentioning(bar);
+  std::sort(methods.begin(), methods.end(), compare_dexmethods);
+  EXPECT_EQ(methods, std::vector<DexMethod*>({m_a, m_b}));
+}
+
+TEST_F(ReferenceIndexTest, indexesOnlyRequestedKinds) {
+  Index index(m_scope, Index::CALLERS);
+  EXPECT_EQ(index.callers_of(m_a).size(), 2);
+  EXPECT_EQ(index.update_call_refs({{m_a, m_b}}), 2);
+  EXPECT_EQ(index.callers_of(m_b).size(), 3);
+  EXPECT_THROW(index.field_uses(m_field), RedexException);
+}
+
+TEST_F(ReferenceIndexTest, bulkRewritesKeepIndexUpToDate) {
+  Index index(m_scope);
+  auto bar = DexType::make_type("LBar;");
+  auto baz = DexType::make_type("LBaz;");
+
+  EXPECT_EQ(index.update_call_refs({{m_a, m_b}}), 2);
+  EXPECT_EQ(index.callers_of(m_a).size(), 0);
+  EXPECT_EQ(index.callers_of(m_b).size(), 3);
+
+  EXPECT_EQ(index.update_type_refs({{bar, baz}}), 2);
+  EXPECT_EQ(index.type_uses(bar).size(), 0);
+  EXPECT_EQ(index.type_uses(baz).size(), 2);
+
+  EXPECT_EQ(index.update_field_type_references({{bar, baz}}), 1);
+  EXPECT_EQ(m_field->get_type(), DexType::make_type("[LBaz;"));
+  EXPECT_EQ(index.fields_of_type(baz), std::vector<DexField*>({m_field}));
+
+  auto expected = assembler::ircode_from_string(R"(
+    (
+      (const v0 0)
+      (invoke-static (v0) "LFoo;.b:(LBar;)V")
+      (invoke-static (v0) "LFoo;.b:(LBar;)V")
+      (invoke-static (v0) "LFoo;.b:(LBar;)V")
+      (const-class "LBaz;")
+      (move-result-pseudo-object v1)
+      (const v2 1)
+      (new-array v2 "[LBaz;")
+      (move-result-pseudo-object v1)
+      (sget-object "LFoo;.f:[LBaz;")
+      (move-result-pseudo-object v1)
+      (return-void)
+    )
+  )");
+  EXPECT_CODE_EQ(m_caller->get_code(), expected.get());
+}
@@ -906,3 +906,174 @@ TEST_F(RegAllocTest, NoOverwriteThis) {
 )");
   EXPECT_CODE_EQ(expected_code.get(), method->get_code());
 }
+
+TEST_F(RegAllocTest, LinearScan) {
+  auto method = assembler::method_from_string(R"(
+    (method (public static) "LFoo;.bar:(I)I"
+     (
+      (load-param v0)
+      (const v1 1)
+      (add-int v2 v0 v1)
+      (const v3 2)
+      (mul-int v4 v2 v3)
+      (return v4)
+     )
+    )
+)");
+  method->get_code()->set_registers_size(5);
+
+  graph_coloring::Allocator::Config config;
+  config.linear_scan_max_registers = 16;
+  auto stats = RegAllocPass::allocate(config, method);
+  EXPECT_EQ(stats.linear_scan_allocations, 1);
+  EXPECT_EQ(stats.linear_scan_fallbacks, 0);
+  EXPECT_EQ(stats.graph_coloring_allocations, 0);
+
+  auto expected_code = assembler::ircode_from_string(R"(
+    (
+     (load-param v1)
+     (const v0 1)
+     (add-int v1 v1 v0)
+     (const v0 2)
+     (mul-int v1 v1 v0)
+     (return v1)
+    )
+)");
+  EXPECT_CODE_EQ(expected_code.get(), method->get_code());
+  EXPECT_EQ(method->get_code()->get_registers_size(), 2);
+}
+
+TEST_F(RegAllocTest, LinearScanSkippedForLargerMethods) {
+  auto method = assembler::method_from_string(R"(
+    (method (public static) "LFoo;.bar:()Z"
+     (
+      (const-wide v0 0)
+      (const-wide v2 0)
+      (cmp-long v1 v0 v2)
+      (return v1)
+     )
+    )
+)");
+  method->get_code()->set_registers_size(4);
+
+  graph_coloring::Allocator::Config config;
+  config.linear_scan_max_registers = 2;
+  auto stats = RegAllocPass::allocate(config, method);
+  EXPECT_EQ(stats.linear_scan_allocations, 0);
+  EXPECT_EQ(stats.linear_scan_fallbacks, 0);
+  EXPECT_EQ(stats.graph_coloring_allocations, 1);
+}
+
+TEST_F(RegAllocTest, LinearScanFallsBackToGraphColoring) {
+  // v16 is defined while v0-v15 are live, so it gets v16 in definition order,
+  // which int-to-long can't address.
+  std::ostringstream ss;
+  ss << "(method (public static) \"LFoo;.bar:()J\"\n (\n";
+  for (size_t i = 0; i <= 16; ++i) {
+    ss << "  (const v" << i << " " << i << ")\n";
+  }
+  ss << "  (int-to-long v17 v16)\n";
+  ss << "  (move v19 v0)\n";
+  for (size_t i = 1; i < 16; ++i) {
+    ss << "  (add-int v19 v19 v" << i << ")\n";
+  }
+  ss << "  (int-to-long v20 v19)\n";
+  ss << "  (add-long v17 v17 v20)\n";
+  ss << "  (return-wide v17)\n";
+  ss << " )\n)\n";
+  auto method = assembler::method_from_string(ss.str());
+  method->get_code()->set_registers_size(22);
+
+  graph_coloring::Allocator::Config config;
+  config.linear_scan_max_registers = 64;
+  auto stats = RegAllocPass::allocate(config, method);
+  EXPECT_EQ(stats.linear_scan_allocations, 0);
+  EXPECT_EQ(stats.linear_scan_fallbacks, 1);
+  EXPECT_EQ(stats.graph_coloring_allocations, 1);
+}
+
+namespace {
+
+// A method with enough simultaneously live registers to span several words of
+// the interference bit matrices, including moves, wide values and a
+// check-cast.
+std::string make_high_pressure_method(const std::string& name) {
+  constexpr size_t n = 150;
+  std::ostringstream ss;
+  ss << "(method (public static) \"LFoo;." << name
+     << ":(Ljava/lang/Object;)J\"\n (\n";
+  ss << "  (load-param-object v" << n + 4 << ")\n";
+  for (size_t i = 0; i < n; ++i) {
+    ss << "  (const v" << i << " " << i << ")\n";
+  }
+  ss << "  (move v" << n << " v0)\n";
+  ss << "  (check-cast v" << n + 4 << " \"LFoo;\")\n";
+  ss << "  (move-result-pseudo-object v" << n + 5 << ")\n";
+  for (size_t i = 1; i < n; ++i) {
+    ss << "  (add-int v" << n << " v" << n << " v" << i << ")\n";
+  }
+  ss << "  (int-to-long v" << n + 1 << " v" << n << ")\n";
+  ss << "  (const-wide v" << n + 6 << " 1)\n";
+  ss << "  (add-long v" << n + 1 << " v" << n + 1 << " v" << n + 6 << ")\n";
+  ss << "  (return-wide v" << n + 1 << ")\n";
+  ss << " )\n)\n";
+  return ss.str();
+}
+
+} // namespace
+
+TEST_F(RegAllocTest, BitMatrixInterferenceGraph) {
+  auto method =
+      assembler::method_from_string(make_high_pressure_method("bar"));
+  auto code = method->get_code();
+  code->set_registers_size(158);
+  code->build_cfg(/* editable */ false);
+  auto& cfg = code->cfg();
+  cfg.calculate_exit_block();
+  LivenessFixpointIterator fixpoint_iter(cfg);
+  fixpoint_iter.run(LivenessDomain());
+
+  RangeSet range_set;
+  auto sparse_ig = interference::build_graph(
+      fixpoint_iter, code, code->get_registers_size(), range_set,
+      /* use_bit_matrix */ false);
+  auto dense_ig = interference::build_graph(
+      fixpoint_iter, code, code->get_registers_size(), range_set,
+      /* use_bit_matrix */ true);
+
+  ASSERT_EQ(sparse_ig.nodes().size(), dense_ig.nodes().size());
+  size_t edges = 0;
+  for (const auto& u : sparse_ig.nodes()) {
+    const auto& dense_node = dense_ig.get_node(u.first);
+    EXPECT_EQ(u.second.weight(), dense_node.weight());
+    EXPECT_EQ(u.second.max_vreg(), dense_node.max_vreg());
+    EXPECT_THAT(dense_node.adjacent(),
+                ::testing::UnorderedElementsAreArray(u.second.adjacent()));
+    for (const auto& v : sparse_ig.nodes()) {
+      EXPECT_EQ(sparse_ig.is_adjacent(u.first, v.first),
+                dense_ig.is_adjacent(u.first, v.first));
+      EXPECT_EQ(sparse_ig.is_coalesceable(u.first, v.first),
+                dense_ig.is_coalesceable(u.first, v.first));
+      EXPECT_EQ(sparse_ig.has_containment_edge(u.first, v.first),
+                dense_ig.has_containment_edge(u.first, v.first));
+      edges += sparse_ig.is_adjacent(u.first, v.first);
+    }
+  }
+  EXPECT_GT(edges, 150 * 149);
+}
+
+TEST_F(RegAllocTest, BitMatrixAllocation) {
+  auto sparse_method =
+      assembler::method_from_string(make_high_pressure_method("bar"));
+  sparse_method->get_code()->set_registers_size(158);
+  auto dense_method =
+      assembler::method_from_string(make_high_pressure_method("baz"));
+  dense_method->get_code()->set_registers_size(158);
+
+  graph_coloring::Allocator::Config config;
+  RegAllocPass::allocate(config, sparse_method);
+  config.use_interference_bit_matrix = true;
+  RegAllocPass::allocate(config, dense_method);
+
+  EXPECT_CODE_EQ(sparse_method->get_code(), dense_method->get_code());
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include "IRAssembler.h"
+#include "RedexTest.h"
+#include "SwitchCaseIndex.h"
+
+class SwitchCaseIndexTest : public RedexTest {};
+
+namespace {
+
+cfg::Block* find_switch_block(cfg::ControlFlowGraph& cfg) {
+  for (auto* block : cfg.blocks()) {
+    auto last = block->get_last_insn();
+    if (last != block->end() && opcode::is_switch(last->insn->opcode())) {
+      return block;
+    }
+  }
+  return nullptr;
+}
+
+} // namespace
+
+TEST_F(SwitchCaseIndexTest, keysClassesAndSplitPoints) {
+  auto code = assembler::ircode_from_string(R"(
+    (
+      (load-param v0)
+
+      (switch v0 (:x :y :z2 :z3 :z4 :w :v6 :v7))
+      (:end)
+      (return-void)
+
+      (:v7 7)
+      (const v1 6)
+      (goto :end)
+
+      (:z2 2)
+      (:z3 3)
+      (:z4 4)
+      (const v1 2)
+      (goto :end)
+
+      (:x 0)
+      (const v1 0)
+      (goto :end)
+
+      (:v6 6)
+      (const v1 6)
+      (goto :end)
+
+      (:y 1)
+      (const v1 1)
+      (goto :end)
+
+      (:w 5)
+      (const v1 5)
+      (goto :end)
+    )
+  )");
+  code->build_cfg(/* editable */ true);
+  auto switch_block = find_switch_block(code->cfg());
+  ASSERT_NE(switch_block, nullptr);
+
+  SwitchCaseIndex index(switch_block);
+  ASSERT_EQ(index.size(), 8);
+  EXPECT_EQ(index.keys(), std::vector<int32_t>({0, 1, 2, 3, 4, 5, 6, 7}));
+  EXPECT_NE(index.default_target(), nullptr);
+  EXPECT_EQ(index.target(2), index.target(4));
+  EXPECT_NE(index.target(6), index.target(7));
+
+  // The cases 2, 3 and 4 share their target, and the cases 6 and 7 jump to
+  // identical code.
+  EXPECT_EQ(index.num_equivalence_classes(), 5);
+  std::vector<size_t> classes;
+  for (size_t i = 0; i < index.size(); ++i) {
+    classes.push_back(index.equivalence_class(i));
+  }
+  EXPECT_EQ(classes, std::vector<size_t>({0, 1, 2, 2, 2, 3, 4, 4}));
+
+  EXPECT_EQ(index.split_points(2), std::vector<int32_t>({3, 7}));
+  EXPECT_EQ(index.split_points(4), std::vector<int32_t>({1, 3, 5, 7}));
+  EXPECT_TRUE(index.split_points(8).empty());
+
+  code->clear_cfg();
+}
+
+TEST_F(SwitchCaseIndexTest, splitPointsIgnoreRunsOfEquivalentCases) {
+  auto code = assembler::ircode_from_string(R"(
+    (
+      (load-param v0)
+
+      (switch v0 (:a0 :a1 :a2 :a3 :a4 :a5 :b :c))
+      (:end)
+      (return-void)
+
+      (:a0 0)
+      (:a1 1)
+      (:a2 2)
+      (:a3 3)
+      (:a4 4)
+      (:a5 5)
+      (const v1 0)
+      (goto :end)
+
+      (:b 6)
+      (const v1 6)
+      (goto :end)
+
+      (:c 7)
+      (const v1 6)
+      (goto :end)
+    )
+  )");
+  code->build_cfg(/* editable */ true);
+  auto switch_block = find_switch_block(code->cfg());
+  ASSERT_NE(switch_block, nullptr);
+
+  SwitchCaseIndex index(switch_block);
+  ASSERT_EQ(index.size(), 8);
+  EXPECT_EQ(index.num_equivalence_classes(), 2);
+
+  // The split count is derived from the size limit, so every range keeps its
+  // share of the cases even when that splits a run of equivalent cases.
+  EXPECT_EQ(index.split_points(2), std::vector<int32_t>({3, 7}));
+  EXPECT_EQ(index.split_points(3), std::vector<int32_t>({1, 4, 7}));
+  EXPECT_EQ(index.split_points(4), std::vector<int32_t>({1, 3, 5, 7}));
+
+  code->clear_cfg();
+}
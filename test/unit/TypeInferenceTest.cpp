@@ -9,6 +9,7 @@
 
 #include "IRAssembler.h"
 #include "RedexTest.h"
+#include "Show.h"
 #include "TypeInference.h"
 
 using namespace testing;
@@ -45,3 +46,105 @@ TEST_F(TypeInferenceTest, const0) {
     }
   }
 }
+
+TEST_F(TypeInferenceTest, runWithoutMerges) {
+  auto method = assembler::method_from_string(R"(
+    (method (public static) "LFoo;.baz:(ILBar;)LBar;"
+     (
+      (load-param v0)
+      (load-param-object v1)
+      (if-eqz v0 :L1)
+      (const v2 1)
+      (add-int v0 v0 v2)
+      (return-object v1)
+      (:L1)
+      (const-wide v2 0)
+      (const v1 0)
+      (return-object v1)
+     )
+    )
+  )");
+  auto code = method->get_code();
+  code->build_cfg(/* editable */ false);
+  auto& cfg = code->cfg();
+  type_inference::TypeInference fixpoint_inference(cfg);
+  fixpoint_inference.run(method);
+  type_inference::TypeInference inference(cfg);
+  EXPECT_TRUE(inference.run_without_merges(method));
+
+  auto& fixpoint_envs = fixpoint_inference.get_type_environments();
+  auto& envs = inference.get_type_environments();
+  EXPECT_EQ(envs.size(), fixpoint_envs.size());
+  for (auto& mie : InstructionIterable(*code)) {
+    EXPECT_TRUE(envs.at(mie.insn).equals(fixpoint_envs.at(mie.insn)))
+        << SHOW(mie.insn);
+  }
+}
+
+TEST_F(TypeInferenceTest, runWithoutMergesRejectsMerges) {
+  auto method = assembler::method_from_string(R"(
+    (method (public static) "LFoo;.qux:(I)I"
+     (
+      (load-param v0)
+      (if-eqz v0 :L1)
+      (const v0 1)
+      (:L1)
+      (return v0)
+     )
+    )
+  )");
+  auto code = method->get_code();
+  code->build_cfg(/* editable */ false);
+  type_inference::TypeInference inference(code->cfg());
+  EXPECT_FALSE(inference.run_without_merges(method));
+  EXPECT_TRUE(inference.get_type_environments().empty());
+}
+
+TEST_F(TypeInferenceTest, denseEnvironmentMatchesSparseEnvironment) {
+  using namespace type_inference;
+  BasicTypeEnvironment env1;
+  BasicTypeEnvironment env2;
+  EXPECT_TRUE(env1.is_top());
+  env1.set(0, TypeDomain(INT));
+  env1.set(1, TypeDomain(ZERO));
+  env1.set(100, TypeDomain(REFERENCE));
+  env1.set(RESULT_REGISTER, TypeDomain(FLOAT));
+  env2.set(0, TypeDomain(FLOAT));
+  env2.set(1, TypeDomain(REFERENCE));
+  env2.set(100, TypeDomain(ZERO));
+
+  auto sparse1 = env1.to_sparse();
+  auto sparse2 = env2.to_sparse();
+  EXPECT_EQ(sparse1.size(), 4);
+  EXPECT_EQ(env1.get(1), TypeDomain(ZERO));
+  EXPECT_EQ(env1.get(2), TypeDomain::top());
+  EXPECT_EQ(env1.get(RESULT_REGISTER), TypeDomain(FLOAT));
+
+  auto joined = env1.join(env2);
+  EXPECT_TRUE(joined.to_sparse().equals(sparse1.join(sparse2)));
+  EXPECT_EQ(joined.get(0), TypeDomain(SCALAR));
+  EXPECT_TRUE(env1.leq(joined));
+  EXPECT_FALSE(joined.leq(env1));
+
+  auto met = env1.meet(env2);
+  EXPECT_TRUE(met.to_sparse().equals(sparse1.meet(sparse2)));
+  EXPECT_EQ(met.get(0), TypeDomain(CONST));
+  BasicTypeEnvironment env4;
+  env4.set(0, TypeDomain(LONG1));
+  EXPECT_TRUE(env1.meet(env4).is_bottom());
+
+  BasicTypeEnvironment env3 = env1;
+  EXPECT_TRUE(env3.equals(env1));
+  env3.set(1, TypeDomain(REFERENCE));
+  EXPECT_FALSE(env3.equals(env1));
+  EXPECT_TRUE(env1.leq(env3));
+  env3.set(2, TypeDomain::bottom());
+  EXPECT_TRUE(env3.is_bottom());
+  EXPECT_EQ(env3.get(0), TypeDomain::bottom());
+
+  std::ostringstream dense_out;
+  std::ostringstream sparse_out;
+  dense_out << env1;
+  sparse_out << sparse1;
+  EXPECT_EQ(dense_out.str(), sparse_out.str());
+}
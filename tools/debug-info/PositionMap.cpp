@@ -6,15 +6,43 @@
  */
 
 #include <boost/scope_exit.hpp>
+#include <cstring>
 #include <fcntl.h>
 #include <iostream>
 #include <memory>
 #include <string>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
 
 #include "PositionMap.h"
 
+namespace {
+
+// Parses the part of the map that follows the version, which is the same for
+// versions 2 and 3.
+std::unique_ptr<PositionMap> read_map_v2(const uint8_t* mapping) {
+  std::unique_ptr<PositionMap> map(new PositionMap());
+  uint32_t spool_count = *(uint32_t*)mapping;
+  mapping += sizeof(uint32_t);
+  map->string_pool.reserve(spool_count);
+  for (uint32_t i = 0; i < spool_count; ++i) {
+    uint32_t ssize = *(uint32_t*)mapping;
+    mapping += sizeof(uint32_t);
+    map->string_pool.emplace_back((const char*)mapping, ssize);
+    mapping += ssize;
+  }
+  uint32_t pos_count = *(uint32_t*)mapping;
+  mapping += sizeof(uint32_t);
+  map->positions.reset(new PositionItem[pos_count]);
+  map->positions_size = pos_count;
+  memcpy(map->positions.get(), mapping, pos_count * sizeof(PositionItem));
+  return map;
+}
+
+} // namespace
+
 std::unique_ptr<PositionMap> read_map(const char* filename) {
   int fd = open(filename, O_RDONLY);
   if (fd == -1) {
@@ -22,6 +50,7 @@ std::unique_ptr<PositionMap> read_map(const char* filename) {
               << ") with error: " << strerror(errno) << std::endl;
     return nullptr;
   }
+  BOOST_SCOPE_EXIT_ALL(=) { close(fd); };
   struct stat buf;
   if (fstat(fd, &buf)) {
     std::cerr << "Cannot fstat file (" << filename
@@ -30,41 +59,41 @@ std::unique_ptr<PositionMap> read_map(const char* filename) {
   }
   uint8_t* mapping = (uint8_t*)mmap(
       nullptr, buf.st_size, PROT_READ, MAP_FILE | MAP_SHARED, fd, 0);
-  uint32_t magic = *(uint32_t*)mapping;
-  mapping += sizeof(uint32_t);
   if (mapping == MAP_FAILED) {
     std::cerr << "mmap failed for file (" << filename
               << ") with error: " << strerror(errno) << std::endl;
     return nullptr;
   }
   BOOST_SCOPE_EXIT_ALL(=, &buf) { munmap(mapping, buf.st_size); };
+  const uint8_t* cur = mapping;
+  uint32_t magic = *(uint32_t*)cur;
+  cur += sizeof(uint32_t);
   if (magic != 0xfaceb000) {
     std::cerr << "Magic number mismatch\n";
     return nullptr;
   }
-  uint32_t version = *(uint32_t*)mapping;
-  mapping += sizeof(uint32_t);
-  if (version != 2) {
+  uint32_t version = *(uint32_t*)cur;
+  cur += sizeof(uint32_t);
+  if (version == 2) {
+    return read_map_v2(cur);
+  }
+  if (version != 3) {
     std::cerr << "Version mismatch\n";
     return nullptr;
   }
 
-  std::unique_ptr<PositionMap> map(new PositionMap());
-  std::vector<std::string> string_pool;
-  uint32_t spool_count = *(uint32_t*)mapping;
-  mapping += sizeof(uint32_t);
-  for (uint32_t i = 0; i < spool_count; ++i) {
-    uint32_t ssize = *(uint32_t*)mapping;
-    mapping += sizeof(uint32_t);
-    map->string_pool.emplace_back((const char*)mapping, ssize);
-    mapping += ssize;
+  // Version 3 is the version 2 payload, zlib-compressed.
+  uint64_t payload_size = *(uint64_t*)cur;
+  cur += sizeof(uint64_t);
+  std::unique_ptr<uint8_t[]> payload(new uint8_t[payload_size]);
+  uLongf size = payload_size;
+  auto res =
+      uncompress(payload.get(), &size, cur, buf.st_size - (cur - mapping));
+  if (res != Z_OK || size != payload_size) {
+    std::cerr << "Cannot decompress line map (" << res << ")\n";
+    return nullptr;
   }
-  uint32_t pos_count = *(uint32_t*)mapping;
-  mapping += sizeof(uint32_t);
-  map->positions.reset(new PositionItem[pos_count]);
-  map->positions_size = pos_count;
-  memcpy(map->positions.get(), mapping, pos_count * sizeof(PositionItem));
-  return map;
+  return read_map_v2(payload.get());
 }
 
 std::vector<Position> get_stack(const PositionMap& map, int64_t idx) {
@@ -11,9 +11,12 @@
 #include "DexOpcodeDefs.h"
 #include "file-utils.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cstdio>
 #include <memory>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -54,6 +57,33 @@ static void foreach_pair(const T1& t1, const T2& t2, const L& fn) {
   }
 }
 
+// Calls fn(i) for every i in [0, n), spread over up to one thread per core.
+// fn must be safe to call concurrently for different indices.
+template <typename L>
+void parallel_for(size_t n, const L& fn) {
+  size_t num_threads =
+      std::min<size_t>(n, std::max(1u, std::thread::hardware_concurrency()));
+  if (num_threads <= 1) {
+    for (size_t i = 0; i < n; i++) {
+      fn(i);
+    }
+    return;
+  }
+  std::atomic<size_t> next{0};
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads);
+  for (size_t t = 0; t < num_threads; t++) {
+    threads.emplace_back([&]() {
+      for (size_t i = next++; i < n; i = next++) {
+        fn(i);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
 template <uint32_t Width>
 uint32_t align(uint32_t in) {
   return (in + (Width - 1)) & -Width;
@@ -669,18 +669,18 @@ void quicken_dex(const char* location,
   }
 }
 
-void print_dex_opcodes(const uint8_t* begin, const size_t size) {
+void print_dex_opcodes(const uint8_t* begin, const size_t size, FILE* out) {
   stream::stream_dex(
       begin,
       size,
-      [](DexOpcode opcode, const uint16_t* const insn) {
+      [out](DexOpcode opcode, const uint16_t* const insn) {
         // clang-format off
         switch (opcode) {
         case DOPCODE_NOP:
         SWITCH_FORMAT_10
         SWITCH_FORMAT_RETURN_VOID_NO_BARRIER {
-          printf("OPCODE: %02x :: %s :: %04x\n", opcode,
-                 ::print(opcode).c_str(), *insn);
+          fprintf(out, "OPCODE: %02x :: %s :: %04x\n", opcode,
+                  ::print(opcode).c_str(), *insn);
           break;
         }
 
@@ -689,8 +689,8 @@ void print_dex_opcodes(const uint8_t* begin, const size_t size) {
         SWITCH_FORMAT_QUICK_FIELD_REF
         SWITCH_FORMAT_CONST_STRING
         SWITCH_FORMAT_TYPE_REF {
-          printf("OPCODE: %02x :: %s :: %04x%04x\n", opcode,
-                 ::print(opcode).c_str(), *insn, *(insn + 1));
+          fprintf(out, "OPCODE: %02x :: %s :: %04x%04x\n", opcode,
+                  ::print(opcode).c_str(), *insn, *(insn + 1));
           break;
         }
 
@@ -699,15 +699,15 @@ void print_dex_opcodes(const uint8_t* begin, const size_t size) {
         SWITCH_FORMAT_QUICK_METHOD_REF
         SWITCH_FORMAT_CONST_STRING_JUMBO
         SWITCH_FORMAT_FILL_ARRAY {
-          printf("OPCODE: %02x :: %s :: %04x%04x%04x\n", opcode,
-                 ::print(opcode).c_str(), *insn, *(insn + 1), *(insn + 2));
+          fprintf(out, "OPCODE: %02x :: %s :: %04x%04x%04x\n", opcode,
+                  ::print(opcode).c_str(), *insn, *(insn + 1), *(insn + 2));
           break;
         }
 
         SWITCH_FORMAT_50 {
-          printf("OPCODE: %02x :: %s :: %04x%04x%04x%04x%04x\n", opcode,
-                 ::print(opcode).c_str(), *insn, *(insn + 1), *(insn + 2),
-                 *(insn + 3), *(insn + 4));
+          fprintf(out, "OPCODE: %02x :: %s :: %04x%04x%04x%04x%04x\n", opcode,
+                  ::print(opcode).c_str(), *insn, *(insn + 1), *(insn + 2),
+                  *(insn + 3), *(insn + 4));
           break;
         }
 
@@ -720,6 +720,29 @@ void print_dex_opcodes(const uint8_t* begin, const size_t size) {
       [](const uint8_t* const insn) {});
 }
 
+void print_dex_opcodes(const std::vector<ConstBuffer>& dexes) {
+  // Format a batch of dexes in parallel into memory, then print them in order,
+  // so that only one batch of output is buffered at a time.
+  size_t batch_size = std::max(1u, std::thread::hardware_concurrency());
+  for (size_t batch = 0; batch < dexes.size(); batch += batch_size) {
+    size_t batch_end = std::min(dexes.size(), batch + batch_size);
+    std::vector<char*> outputs(batch_end - batch, nullptr);
+    std::vector<size_t> output_sizes(batch_end - batch, 0);
+    parallel_for(batch_end - batch, [&](size_t i) {
+      FILE* out = open_memstream(&outputs[i], &output_sizes[i]);
+      CHECK(out != nullptr, "open_memstream failed: %s", std::strerror(errno));
+      const auto& dex = dexes[batch + i];
+      print_dex_opcodes(
+          reinterpret_cast<const uint8_t*>(dex.ptr), dex.len, out);
+      fclose(out);
+    });
+    for (size_t i = 0; i < outputs.size(); i++) {
+      fwrite(outputs[i], 1, output_sizes[i], stdout);
+      free(outputs[i]);
+    }
+  }
+}
+
 void stream::stream_dex(const uint8_t* begin,
                         const size_t size,
                         InsnWalkerFn insn_walker,
@@ -101,4 +101,9 @@ class stream {
                              [](const uint8_t* const insn) {});
 };
 
-void print_dex_opcodes(const uint8_t* begin, const size_t size);
+void print_dex_opcodes(const uint8_t* begin,
+                       const size_t size,
+                       FILE* out = stdout);
+
+// Prints the opcodes of each dex in order, formatting them in parallel.
+void print_dex_opcodes(const std::vector<ConstBuffer>& dexes);
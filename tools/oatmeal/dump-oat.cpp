@@ -1265,12 +1265,7 @@ class DexFiles {
           e.class_defs_size,
           e.class_defs_size);
     }
-    size_t index = 0;
-    for (const auto& e : dexes_) {
-      print_dex_opcodes(reinterpret_cast<const uint8_t*>(e.ptr),
-                        headers_[index].file_size);
-      index++;
-    }
+    print_dex_opcodes(dexes_);
   }
 
   const std::vector<DexFileHeader>& headers() const { return headers_; }
@@ -1321,38 +1316,40 @@ OatClasses_124::OatClasses_124(const DexFileListing_079& dex_file_listing,
                                const DexFiles& dex_files,
                                ConstBuffer oat_buf,
                                ConstBuffer dex_buf) {
-  foreach_pair(dex_file_listing.dex_files(),
-               dex_files.headers(),
-               [&](const DexFileListing_079::DexFile_079& listing,
-                   const DexFileHeader& header) {
-                 auto classes_offset = listing.classes_offset;
-
-                 DexClasses dex_classes;
-                 dex_classes.dex_file = listing.location;
-
-                 DexIdBufs id_bufs(dex_buf, listing.file_offset, header);
-
-                 // classes_offset points to an array of pointers (offsets) to
-                 // ClassInfo
-                 for (unsigned int i = 0; i < header.class_defs_size; i++) {
-
-                   ClassInfo info;
-                   uint32_t info_offset;
-                   cur_ma()->memcpyAndMark(
-                       &info_offset,
-                       oat_buf.slice(classes_offset + i * sizeof(uint32_t)).ptr,
-                       sizeof(uint32_t));
-                   cur_ma()->memcpyAndMark(&info,
-                                           oat_buf.slice(info_offset).ptr,
-                                           sizeof(ClassInfo));
-
-                   // TODO: Handle compiled classes. Need to read method bitmap
-                   // size, and method bitmap.
-                   dex_classes.class_info.push_back(info);
-                   dex_classes.class_names.push_back(id_bufs.get_class_name(i));
-                 }
-                 classes_.push_back(dex_classes);
-               });
+  const auto& listings = dex_file_listing.dex_files();
+  const auto& headers = dex_files.headers();
+  CHECK(listings.size() == headers.size());
+  // Each dex is independent, so parse them in parallel.
+  classes_.resize(listings.size());
+  parallel_for(listings.size(), [&](size_t dex_index) {
+    const auto& listing = listings[dex_index];
+    const auto& header = headers[dex_index];
+    auto classes_offset = listing.classes_offset;
+
+    DexClasses& dex_classes = classes_[dex_index];
+    dex_classes.dex_file = listing.location;
+
+    DexIdBufs id_bufs(dex_buf, listing.file_offset, header);
+
+    // classes_offset points to an array of pointers (offsets) to
+    // ClassInfo
+    for (unsigned int i = 0; i < header.class_defs_size; i++) {
+
+      ClassInfo info;
+      uint32_t info_offset;
+      cur_ma()->memcpyAndMark(
+          &info_offset,
+          oat_buf.slice(classes_offset + i * sizeof(uint32_t)).ptr,
+          sizeof(uint32_t));
+      cur_ma()->memcpyAndMark(
+          &info, oat_buf.slice(info_offset).ptr, sizeof(ClassInfo));
+
+      // TODO: Handle compiled classes. Need to read method bitmap
+      // size, and method bitmap.
+      dex_classes.class_info.push_back(info);
+      dex_classes.class_names.push_back(id_bufs.get_class_name(i));
+    }
+  });
 }
 
 class OatClasses_064 : public OatClasses {
@@ -1376,41 +1373,43 @@ class OatClasses_064 : public OatClasses {
 OatClasses_079::OatClasses_079(const DexFileListing_079& dex_file_listing,
                                const DexFiles& dex_files,
                                ConstBuffer oat_buf) {
-  foreach_pair(
-      dex_file_listing.dex_files(),
-      dex_files.headers(),
-      [&](const DexFileListing_079::DexFile_079& listing,
-          const DexFileHeader& header) {
-        auto classes_offset = listing.classes_offset;
-
-        DexClasses dex_classes;
-        dex_classes.dex_file = listing.location;
-
-        DexIdBufs id_bufs(oat_buf, listing.file_offset, header);
-
-        // classes_offset points to an array of pointers (offsets) to
-        // ClassInfo
-        for (unsigned int i = 0; i < header.class_defs_size; i++) {
-
-          ClassInfo info;
-          uint32_t info_offset;
-          cur_ma()->memcpyAndMark(
-              &info_offset,
-              oat_buf.slice(classes_offset + i * sizeof(uint32_t)).ptr,
-              sizeof(uint32_t));
-          cur_ma()->memcpyAndMark(
-              &info, oat_buf.slice(info_offset).ptr, sizeof(ClassInfo));
-
-          // TODO: Handle compiled classes. Need to read method bitmap size,
-          // and method bitmap.
-          CHECK(info.type == static_cast<uint16_t>(Type::kOatClassNoneCompiled),
-                "Parsing for compiled classes not implemented");
-
-          dex_classes.class_info.push_back(info);
-          dex_classes.class_names.push_back(id_bufs.get_class_name(i));
-        }
-        classes_.push_back(dex_classes);
-      });
+  const auto& listings = dex_file_listing.dex_files();
+  const auto& headers = dex_files.headers();
+  CHECK(listings.size() == headers.size());
+  // Each dex is independent, so parse them in parallel.
+  classes_.resize(listings.size());
+  parallel_for(listings.size(), [&](size_t dex_index) {
+    const auto& listing = listings[dex_index];
+    const auto& header = headers[dex_index];
+    auto classes_offset = listing.classes_offset;
+
+    DexClasses& dex_classes = classes_[dex_index];
+    dex_classes.dex_file = listing.location;
+
+    DexIdBufs id_bufs(oat_buf, listing.file_offset, header);
+
+    // classes_offset points to an array of pointers (offsets) to
+    // ClassInfo
+    for (unsigned int i = 0; i < header.class_defs_size; i++) {
+
+      ClassInfo info;
+      uint32_t info_offset;
+      cur_ma()->memcpyAndMark(
+          &info_offset,
+          oat_buf.slice(classes_offset + i * sizeof(uint32_t)).ptr,
+          sizeof(uint32_t));
+      cur_ma()->memcpyAndMark(
+          &info, oat_buf.slice(info_offset).ptr, sizeof(ClassInfo));
+
+      // TODO: Handle compiled classes. Need to read method bitmap size,
+      // and method bitmap.
+      CHECK(info.type == static_cast<uint16_t>(Type::kOatClassNoneCompiled),
+            "Parsing for compiled classes not implemented");
+
+      dex_classes.class_info.push_back(info);
+      dex_classes.class_names.push_back(id_bufs.get_class_name(i));
+    }
+  });
 }
 
 void OatClasses_079::print() {
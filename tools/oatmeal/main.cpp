@@ -8,9 +8,11 @@
 #include "OatmealUtil.h"
 #include "dump-oat.h"
 #include "memory-accounter.h"
+#include "mmap.h"
 #include "vdex.h"
 
 #include <getopt.h>
+#include <sys/mman.h>
 
 #ifndef ANDROID
 #include <wordexp.h>
@@ -49,6 +51,10 @@ struct Arguments {
   bool dump_tables = false;
   bool dump_memory_usage = false;
 
+  // Write a machine-readable summary of the memory accounting here.
+  std::string memory_usage_json;
+  std::string memory_usage_csv;
+
   bool print_unverified_classes = false;
 
   std::string arch;
@@ -101,6 +107,8 @@ Arguments parse_args(int argc, char* argv[]) {
       {"samsung-oatformat", no_argument, nullptr, 2},
       {"one-oat-per-dex", no_argument, nullptr, 3},
       {"quickening-data", required_argument, nullptr, 'q'},
+      {"memory-usage-json", required_argument, nullptr, 4},
+      {"memory-usage-csv", required_argument, nullptr, 5},
       {nullptr, 0, nullptr, 0}};
 
   Arguments ret;
@@ -191,6 +199,14 @@ Arguments parse_args(int argc, char* argv[]) {
       ret.quick_data_location = expand(optarg);
       break;
 
+    case 4:
+      ret.memory_usage_json = expand(optarg);
+      break;
+
+    case 5:
+      ret.memory_usage_csv = expand(optarg);
+      break;
+
     case ':':
       fprintf(stderr, "ERROR: %s requires an argument\n", argv[optind - 1]);
       exit(1);
@@ -209,6 +225,14 @@ Arguments parse_args(int argc, char* argv[]) {
     exit(1);
   }
 
+  if (ret.action != Action::DUMP &&
+      (!ret.memory_usage_json.empty() || !ret.memory_usage_csv.empty())) {
+    fprintf(stderr,
+            "--memory-usage-json/--memory-usage-csv can only be used with "
+            "-d/--dump\n");
+    exit(1);
+  }
+
   if (!dex_locations.empty()) {
     if (dex_locations.size() != dex_files.size()) {
       fprintf(
@@ -231,6 +255,30 @@ Arguments parse_args(int argc, char* argv[]) {
   return ret;
 }
 
+bool write_memory_summary(const std::string& filename,
+                          MemoryAccounter::SummaryFormat format) {
+  if (filename.empty()) {
+    return true;
+  }
+  auto out = FileHandle(fopen(filename.c_str(), "w"));
+  if (out.get() == nullptr) {
+    fprintf(stderr,
+            "failed to open file %s %s\n",
+            filename.c_str(),
+            std::strerror(errno));
+    return false;
+  }
+  cur_ma()->print_summary(out.get(), format);
+  return true;
+}
+
+bool write_memory_summaries(const Arguments& args) {
+  return write_memory_summary(args.memory_usage_json,
+                              MemoryAccounter::SummaryFormat::JSON) &&
+         write_memory_summary(args.memory_usage_csv,
+                              MemoryAccounter::SummaryFormat::CSV);
+}
+
 int dump(const Arguments& args) {
   if (args.oat_files.size() != 1) {
     fprintf(stderr, "-o/--oat required (exactly once)\n");
@@ -249,20 +297,22 @@ int dump(const Arguments& args) {
 
   auto oat_file_size = get_filesize(oat_file);
 
-  // We don't run dumping during install on device, so it is allowed to consume
-  // lots of memory.
-  auto oat_file_contents = std::make_unique<char[]>(oat_file_size);
-  auto oatFileBytesRead =
-      fread(oat_file_contents.get(), 1, oat_file_size, oat_file.get());
-  if (oatFileBytesRead != oat_file_size) {
-    fprintf(stderr,
-            "Failed to read file %s (%zd)\n",
-            std::strerror(errno),
-            oatFileBytesRead);
+  // Parse straight out of the mapped file rather than copying it into memory.
+  std::string error_msg;
+  std::unique_ptr<MappedFile> oat_file_map(
+      MappedFile::mmap_file(oat_file_size,
+                            PROT_READ,
+                            MAP_PRIVATE,
+                            fileno(oat_file.get()),
+                            oat_file_name.c_str(),
+                            &error_msg));
+  if (oat_file_map == nullptr) {
+    fprintf(stderr, "Failed to map file %s\n", error_msg.c_str());
     return 1;
   }
 
-  ConstBuffer oatfile_buffer{oat_file_contents.get(), oat_file_size};
+  ConstBuffer oatfile_buffer{
+      reinterpret_cast<const char*>(oat_file_map->begin()), oat_file_size};
   auto ma_scope = MemoryAccounter::NewScope(oatfile_buffer);
 
   CHECK(oatfile_buffer.len > 4);
@@ -270,7 +320,7 @@ int dump(const Arguments& args) {
       kVdexMagicNum) {
     auto vdexfile = VdexFile::parse(oatfile_buffer);
     vdexfile->print();
-    return 0;
+    return write_memory_summaries(args) ? 0 : 1;
   }
   auto oatfile =
       OatFile::parse(oatfile_buffer, args.dex_files, args.test_is_oatmeal);
@@ -290,6 +340,9 @@ int dump(const Arguments& args) {
   if (args.dump_memory_usage) {
     cur_ma()->print();
   }
+  if (!write_memory_summaries(args)) {
+    return 1;
+  }
 
   return oatfile->status() == OatFile::Status::PARSE_SUCCESS ? 0 : 1;
 }
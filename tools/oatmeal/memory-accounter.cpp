@@ -9,7 +9,10 @@
 #include "OatmealUtil.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstring>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 
 namespace {
@@ -27,6 +30,7 @@ namespace {
 class NilMemoryAccounterImpl : public MemoryAccounter {
  public:
   void print() override {}
+  void print_summary(FILE*, SummaryFormat) override {}
   void memcpyAndMark(void* dest, const char* src, size_t count) override {
     memcpy(dest, src, count);
   }
@@ -38,7 +42,10 @@ class NilMemoryAccounterImpl : public MemoryAccounter {
 
 class MultiBufferMemoryAccounter;
 
-class MemoryAccounterImpl : public MemoryAccounter {
+// The accounting of a single buffer. The marking itself goes through
+// MultiBufferMemoryAccounter, which logs the ranges of every thread
+// separately and merges them in here before printing.
+class MemoryAccounterImpl {
   friend class ::MemoryAccounterScope;
   friend class ::MultiBufferMemoryAccounter;
 
@@ -51,59 +58,15 @@ class MemoryAccounterImpl : public MemoryAccounter {
     consumed_ranges_.emplace_back(buf_.len, buf_.len);
   }
 
-  void print() override {
-
-    std::sort(consumed_ranges_.begin(),
-              consumed_ranges_.end(),
-              [](const Range& a, const Range& b) { return a.begin < b.begin; });
-
-    Range prev{0, 0};
+  void print() {
     printf("Memory accounting:\n");
     if (consumed_ranges_.empty()) {
       printf("  no unconsumed memory found\n");
     }
 
-    for (const auto& cur : consumed_ranges_) {
-      if (prev.end < cur.begin) {
-        printf("  unconsumed memory in range 0x%08x to 0x%08x\n",
-               prev.end,
-               cur.begin);
-      }
-      if (cur.begin < prev.end) {
-        printf("  double consumed memory in range 0x%08x to 0x%08x\n",
-               cur.begin,
-               prev.end);
-      }
-      prev = cur;
-    }
-  }
-
-  void addBuffer(ConstBuffer) override {
-    CHECK(false, "Shouldn't do this here");
-  }
-
-  void memcpyAndMark(void* dest, const char* src, size_t count) override {
-    CHECK(src >= buf_.ptr);
-    uint32_t begin = src - buf_.ptr;
-    uint32_t end = begin + count;
-
-    markRangeImpl(begin, end);
-    memcpy(dest, src, count);
-  }
-
-  void markRangeConsumed(const char* ptr, uint32_t count) override {
-    CHECK(buf_.ptr <= ptr);
-
-    uint32_t begin = ptr - buf_.ptr;
-    uint32_t end = begin + count;
-    markRangeImpl(begin, end);
-  }
-
-  void markBufferConsumed(ConstBuffer subBuffer) override {
-    CHECK(subBuffer.ptr >= buf_.ptr);
-    CHECK(subBuffer.ptr <= buf_.ptr + buf_.len);
-
-    markRangeConsumed(subBuffer.ptr, subBuffer.len);
+    for_each_gap([](const char* kind, uint32_t begin, uint32_t end) {
+      printf("  %s memory in range 0x%08x to 0x%08x\n", kind, begin, end);
+    });
   }
 
   static MemoryAccounter* Cur() {
@@ -120,16 +83,90 @@ class MemoryAccounterImpl : public MemoryAccounter {
     uint32_t end;
   };
 
+  static constexpr const char* kUnconsumed = "unconsumed";
+  static constexpr const char* kDoubleConsumed = "double consumed";
+
   ConstBuffer buf_;
   std::vector<Range> consumed_ranges_;
 
   static NilMemoryAccounterImpl nil_accounter_;
   static std::vector<std::unique_ptr<MemoryAccounter>> accounter_stack_;
 
-  void markRangeImpl(uint32_t begin, uint32_t end) {
+  // The offsets of [ptr, ptr + count) in the buffer.
+  Range range_of(const char* ptr, uint32_t count) const {
+    CHECK(buf_.ptr <= ptr);
+
+    uint32_t begin = ptr - buf_.ptr;
+    uint32_t end = begin + count;
     CHECK(begin <= end);
     CHECK(end <= buf_.len);
-    consumed_ranges_.emplace_back(begin, end);
+    return Range(begin, end);
+  }
+
+  // Calls fn(kind, begin, end) for every range of the buffer that was either
+  // never consumed or consumed more than once, in address order.
+  template <typename L>
+  void for_each_gap(const L& fn) {
+    std::sort(consumed_ranges_.begin(),
+              consumed_ranges_.end(),
+              [](const Range& a, const Range& b) { return a.begin < b.begin; });
+
+    Range prev{0, 0};
+    for (const auto& cur : consumed_ranges_) {
+      if (prev.end < cur.begin) {
+        fn(kUnconsumed, prev.end, cur.begin);
+      }
+      if (cur.begin < prev.end) {
+        fn(kDoubleConsumed, cur.begin, prev.end);
+      }
+      prev = cur;
+    }
+  }
+
+  // Writes this buffer's part of MultiBufferMemoryAccounter::print_summary.
+  // index identifies the buffer among those of the MultiBufferMemoryAccounter.
+  void write_summary(FILE* out,
+                     MemoryAccounter::SummaryFormat format,
+                     size_t index,
+                     bool first) {
+    size_t unconsumed = 0;
+    for_each_gap([&](const char* kind, uint32_t begin, uint32_t end) {
+      if (strcmp(kind, kUnconsumed) == 0) {
+        unconsumed += end - begin;
+      }
+    });
+
+    if (format == MemoryAccounter::SummaryFormat::CSV) {
+      fprintf(out, "%zu,buffer,0,%zu,%zu\n", index, buf_.len, buf_.len);
+      fprintf(out,
+              "%zu,consumed,,,%zu\n",
+              index,
+              buf_.len - std::min(unconsumed, buf_.len));
+      for_each_gap([&](const char* kind, uint32_t begin, uint32_t end) {
+        fprintf(out, "%zu,%s,%u,%u,%u\n", index, kind, begin, end, end - begin);
+      });
+      return;
+    }
+
+    fprintf(out,
+            "%s\n    {\"buffer\": %zu, \"size\": %zu, \"consumed\": %zu, "
+            "\"unconsumed\": %zu, \"ranges\": [",
+            first ? "" : ",",
+            index,
+            buf_.len,
+            buf_.len - std::min(unconsumed, buf_.len),
+            unconsumed);
+    bool first_range = true;
+    for_each_gap([&](const char* kind, uint32_t begin, uint32_t end) {
+      fprintf(out,
+              "%s\n      {\"kind\": \"%s\", \"begin\": %u, \"end\": %u}",
+              first_range ? "" : ",",
+              kind,
+              begin,
+              end);
+      first_range = false;
+    });
+    fprintf(out, "%s]}", first_range ? "" : "\n    ");
   }
 };
 
@@ -143,7 +180,10 @@ class MultiBufferMemoryAccounter : public MemoryAccounter {
     accounters_.emplace_back(buf);
   }
 
+  // print and print_summary must not run concurrently with the accounting
+  // functions.
   void print() override;
+  void print_summary(FILE* out, SummaryFormat format) override;
 
   void memcpyAndMark(void* dest, const char* src, size_t count) override;
 
@@ -154,17 +194,61 @@ class MultiBufferMemoryAccounter : public MemoryAccounter {
   ~MultiBufferMemoryAccounter() override = default;
 
  private:
+  struct LoggedRange {
+    LoggedRange(size_t i, MemoryAccounterImpl::Range r) : buffer(i), range(r) {}
+    size_t buffer;
+    MemoryAccounterImpl::Range range;
+  };
+  using RangeLog = std::vector<LoggedRange>;
+
+  // The ranges marked by the calling thread and not yet merged.
+  RangeLog& thread_log();
+  // Moves the logged ranges of all threads into accounters_.
+  void merge_thread_logs();
+
+  static std::atomic<uint64_t> next_id_;
+  // Keys the per-thread logs; unlike `this`, never reused.
+  const uint64_t id_{next_id_++};
+
   std::vector<MemoryAccounterImpl> accounters_;
+  // One log per thread that marked ranges, so that the per-dex parsing threads
+  // never wait on each other.
+  std::vector<std::unique_ptr<RangeLog>> thread_logs_;
+  // Guards thread_logs_ and the addition of buffers.
+  std::mutex mutex_;
 };
 
+MultiBufferMemoryAccounter::RangeLog& MultiBufferMemoryAccounter::thread_log() {
+  thread_local std::unordered_map<uint64_t, RangeLog*> logs;
+  auto& log = logs[id_];
+  if (log == nullptr) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    thread_logs_.emplace_back(new RangeLog());
+    log = thread_logs_.back().get();
+  }
+  return *log;
+}
+
+void MultiBufferMemoryAccounter::merge_thread_logs() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto& log : thread_logs_) {
+    for (const auto& logged : *log) {
+      accounters_[logged.buffer].consumed_ranges_.push_back(logged.range);
+    }
+    log->clear();
+  }
+}
+
 void MultiBufferMemoryAccounter::memcpyAndMark(void* dest,
                                                const char* src,
                                                size_t count) {
-  for (auto& a : accounters_) {
+  for (size_t i = 0; i < accounters_.size(); i++) {
+    const auto& a = accounters_[i];
     auto ptr = a.buf_.ptr;
     char* dst_ptr = reinterpret_cast<char*>(dest);
     if (ptr <= dest && dest <= dst_ptr + count) {
-      a.memcpyAndMark(dest, src, count);
+      thread_log().emplace_back(i, a.range_of(src, count));
+      memcpy(dest, src, count);
       return;
     }
   }
@@ -173,10 +257,11 @@ void MultiBufferMemoryAccounter::memcpyAndMark(void* dest,
 
 void MultiBufferMemoryAccounter::markRangeConsumed(const char* ptr,
                                                    uint32_t count) {
-  for (auto& a : accounters_) {
+  for (size_t i = 0; i < accounters_.size(); i++) {
+    const auto& a = accounters_[i];
     auto base_ptr = a.buf_.ptr;
     if (base_ptr <= ptr && ptr + count <= base_ptr + a.buf_.len) {
-      a.markRangeConsumed(ptr, count);
+      thread_log().emplace_back(i, a.range_of(ptr, count));
       return;
     }
   }
@@ -184,7 +269,8 @@ void MultiBufferMemoryAccounter::markRangeConsumed(const char* ptr,
 }
 
 void MultiBufferMemoryAccounter::markBufferConsumed(ConstBuffer subBuffer) {
-  for (auto& a : accounters_) {
+  for (size_t i = 0; i < accounters_.size(); i++) {
+    const auto& a = accounters_[i];
     auto base_ptr = a.buf_.ptr;
     auto base_len = a.buf_.len;
 
@@ -193,7 +279,7 @@ void MultiBufferMemoryAccounter::markBufferConsumed(ConstBuffer subBuffer) {
 
     if (base_ptr <= subbuf_ptr &&
         subbuf_ptr + subbuf_len <= base_ptr + base_len) {
-      a.markBufferConsumed(subBuffer);
+      thread_log().emplace_back(i, a.range_of(subbuf_ptr, subbuf_len));
       return;
     }
   }
@@ -201,12 +287,32 @@ void MultiBufferMemoryAccounter::markBufferConsumed(ConstBuffer subBuffer) {
 }
 
 void MultiBufferMemoryAccounter::print() {
+  merge_thread_logs();
   for (auto& a : accounters_) {
     a.print();
   }
 }
 
+void MultiBufferMemoryAccounter::print_summary(FILE* out,
+                                               SummaryFormat format) {
+  merge_thread_logs();
+  if (format == SummaryFormat::CSV) {
+    fprintf(out, "buffer,kind,begin,end,size\n");
+  } else {
+    fprintf(out, "{\"buffers\": [");
+  }
+  for (size_t i = 0; i < accounters_.size(); i++) {
+    accounters_[i].write_summary(out, format, i, i == 0);
+  }
+  if (format == SummaryFormat::JSON) {
+    fprintf(out, "\n]}\n");
+  }
+}
+
 void MultiBufferMemoryAccounter::addBuffer(ConstBuffer buf) {
+  // Buffers are added before any parallel parsing starts, but the lock keeps
+  // this from racing with the creation of a thread log.
+  std::lock_guard<std::mutex> lock(mutex_);
   // Make sure this is no-ones sub-buffer in the currently accounted set.
   for (const auto& a : accounters_) {
     auto a_end = a.buf_.ptr + a.buf_.len;
@@ -217,6 +323,7 @@ void MultiBufferMemoryAccounter::addBuffer(ConstBuffer buf) {
   accounters_.emplace_back(buf);
 }
 
+std::atomic<uint64_t> MultiBufferMemoryAccounter::next_id_{0};
 NilMemoryAccounterImpl MemoryAccounterImpl::nil_accounter_;
 std::vector<std::unique_ptr<MemoryAccounter>>
     MemoryAccounterImpl::accounter_stack_;
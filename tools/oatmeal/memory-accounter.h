@@ -9,6 +9,7 @@
 
 #include "OatmealUtil.h"
 
+#include <cstdio>
 #include <memory>
 
 class MemoryAccounter;
@@ -28,7 +29,7 @@ class MemoryAccounterScope {
 
 // Tracks which ranges of memory have been consumed during parsing,
 // so that we can easily identify sections that may have data we don't
-// yet understand.
+// yet understand. The accounting functions may be called concurrently.
 class MemoryAccounter {
  public:
   MemoryAccounter() = default;
@@ -40,10 +41,16 @@ class MemoryAccounter {
   static MemoryAccounter* Cur();
   static MemoryAccounterScope NewScope(ConstBuffer buf);
 
+  enum class SummaryFormat { JSON, CSV };
+
   // Print a report of any memory in buf_ that has either never
   // been consumed, or has been consumed more than once.
   virtual void print() = 0;
 
+  // Like print, but machine-readable: the size of every tracked buffer, the
+  // number of bytes consumed, and the unconsumed and double consumed ranges.
+  virtual void print_summary(FILE* out, SummaryFormat format) = 0;
+
   // Accounting functions - use these to mark portions of the tracked
   // buffer consumed.
 
@@ -40,3 +40,13 @@ TEST(OatmealUtil, empty) {
   EXPECT_EQ(0x200000000Lu, roundUpToPowerOfTwo(0x200000000Lu));
   EXPECT_EQ(0x400000000Lu, roundUpToPowerOfTwo(0x200000001Lu));
 }
+
+TEST(OatmealUtil, parallelFor) {
+  for (size_t n : {0u, 1u, 2u, 100u}) {
+    std::vector<std::atomic<int>> visits(n);
+    parallel_for(n, [&](size_t i) { visits[i]++; });
+    for (const auto& v : visits) {
+      EXPECT_EQ(1, v.load());
+    }
+  }
+}
@@ -53,10 +53,5 @@ void VdexFile::print() const {
         e.class_defs_size,
         e.class_defs_size);
   }
-  size_t index = 0;
-  for (const auto& e : dexes_) {
-    print_dex_opcodes(reinterpret_cast<const uint8_t*>(e.ptr),
-                      dex_headers_[index].file_size);
-    index++;
-  }
+  print_dex_opcodes(dexes_);
 }
@@ -5,9 +5,11 @@
 
 from __future__ import absolute_import, division, print_function
 
+import io
 import logging
 import mmap
 import struct
+import zlib
 from collections import namedtuple
 
 
@@ -28,8 +30,15 @@ class PositionMap(object):
             if magic != 0xFACEB000:
                 raise Exception("Magic number mismatch")
             version = struct.unpack("<L", mapping.read(4))[0]
-            if version not in [1, 2]:
+            if version not in [1, 2, 3]:
                 raise Exception("Version mismatch")
+            if version == 3:
+                # Same layout as version 2, zlib-compressed.
+                size = struct.unpack("<Q", mapping.read(8))[0]
+                mapping = io.BytesIO(zlib.decompress(mapping.read()))
+                if len(mapping.getvalue()) != size:
+                    raise Exception("Size mismatch")
+                version = 2
             spool_count = struct.unpack("<L", mapping.read(4))[0]
             pmap = PositionMap()
             for _ in range(0, spool_count):
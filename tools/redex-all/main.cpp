@@ -40,6 +40,7 @@
 #include "DexHasher.h"
 #include "DexLoader.h"
 #include "DexOutput.h"
+#include "DexOutputCache.h"
 #include "DexPosition.h"
 #include "DuplicateClasses.h"
 #include "GlobalConfig.h"
@@ -950,7 +951,8 @@ void redex_backend(const std::string& output_dir,
 
   std::unique_ptr<PositionMapper> pos_mapper(PositionMapper::make(
       dik == DebugInfoKind::NoCustomSymbolication ? ""
-                                                  : line_number_map_filename));
+                                                  : line_number_map_filename,
+      json_config.get("compress_line_number_map", false)));
   std::unordered_map<DexMethod*, uint64_t> method_to_id;
   std::unordered_map<DexCode*, std::vector<DebugLineItem>> code_debug_lines;
   IODIMetadata iodi_metadata;
@@ -966,6 +968,15 @@ void redex_backend(const std::string& output_dir,
     Timer t("Compute initial IODI metadata");
     iodi_metadata.mark_methods(stores);
   }
+
+  std::unique_ptr<DexOutputCache> output_cache;
+  auto output_cache_file =
+      json_config.get("dex_output_cache_file", std::string());
+  if (!output_cache_file.empty()) {
+    Timer t("Loading dex output cache");
+    output_cache = std::make_unique<DexOutputCache>(output_cache_file);
+    output_cache->load();
+  }
   for (size_t store_number = 0; store_number < stores.size(); ++store_number) {
     auto& store = stores[store_number];
     Timer t("Writing optimized dexes");
@@ -984,13 +995,19 @@ void redex_backend(const std::string& output_dir,
                                is_iodi(dik) ? &iodi_metadata : nullptr,
                                stores[0].get_dex_magic(),
                                post_lowering.get(),
-                               manager.get_redex_options().min_sdk);
+                               manager.get_redex_options().min_sdk,
+                               output_cache.get());
 
       output_totals += this_dex_stats;
       output_dexes_stats.push_back(this_dex_stats);
     }
   }
 
+  if (output_cache) {
+    Timer t("Saving dex output cache");
+    output_cache->save();
+  }
+
   if (post_lowering) {
     post_lowering->run(stores);
     post_lowering->finalize(manager.apk_manager());
@@ -1024,6 +1041,12 @@ void redex_backend(const std::string& output_dir,
     pos_mapper->write_map();
     stats["output_stats"] = get_output_stats(
         output_totals, output_dexes_stats, manager, instruction_lowering_stats);
+    if (output_cache) {
+      stats["output_stats"]["dex_output_cache_hits"] =
+          (Json::UInt64)output_cache->hits();
+      stats["output_stats"]["dex_output_cache_misses"] =
+          (Json::UInt64)output_cache->misses();
+    }
     print_warning_summary();
   }
 }